@@ -0,0 +1,251 @@
+// Copyright (c) embedded ocean GmbH
+
+// Checks the implementations of the base64url decoder against each other, and measures how long they take to decode
+// data of the size of typical tokens. With the argument --check, only the checks are run.
+
+#include "Base64Url.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace xentara::samples::webService;
+using namespace std::literals;
+
+namespace
+{
+	//  The implementations, with their names
+	constexpr std::array kImplementations {
+		std::pair { base64Url::Implementation::Scalar, "scalar"sv },
+		std::pair { base64Url::Implementation::Sse41, "sse4.1"sv },
+		std::pair { base64Url::Implementation::Avx2, "avx2"sv },
+	};
+
+	//  The base64url alphabet
+	constexpr std::string_view kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+	//  The number of bytes after the decoded data that are checked for being overwritten
+	constexpr std::size_t kGuardSize = 64;
+
+	//  The value of the bytes after the decoded data
+	constexpr char kGuard = '\x5a';
+
+	//  Encodes data without padding, independently of the decoder
+	auto encode(const std::string &data) -> std::string
+	{
+		std::string encoded;
+		std::size_t index = 0;
+		for (; index + 3 <= data.size(); index += 3)
+		{
+			const auto value = std::uint32_t(std::uint8_t(data[index])) << 16 |
+				std::uint32_t(std::uint8_t(data[index + 1])) << 8 | std::uint32_t(std::uint8_t(data[index + 2]));
+			encoded += kAlphabet[value >> 18];
+			encoded += kAlphabet[(value >> 12) & 0x3f];
+			encoded += kAlphabet[(value >> 6) & 0x3f];
+			encoded += kAlphabet[value & 0x3f];
+		}
+		if (const auto remaining = data.size() - index; remaining > 0)
+		{
+			auto value = std::uint32_t(std::uint8_t(data[index])) << 16;
+			if (remaining == 2)
+			{
+				value |= std::uint32_t(std::uint8_t(data[index + 1])) << 8;
+			}
+			encoded += kAlphabet[value >> 18];
+			encoded += kAlphabet[(value >> 12) & 0x3f];
+			if (remaining == 2)
+			{
+				encoded += kAlphabet[(value >> 6) & 0x3f];
+			}
+		}
+		return encoded;
+	}
+
+	//  Makes random data
+	auto randomData(std::mt19937_64 &random, std::size_t size) -> std::string
+	{
+		std::string data(size, '\0');
+		for (auto &&byte : data)
+		{
+			byte = char(random());
+		}
+		return data;
+	}
+
+	//  Decodes data with an implementation, and checks that no bytes after the decoded data were written
+	//  @return the decoded data, or std::nullopt if the data was rejected
+	auto decode(std::string_view encoded, base64Url::Implementation implementation, bool &overrun)
+		-> std::optional<std::string>
+	{
+		const auto size = base64Url::decodedSize(encoded);
+		std::vector<char> buffer(size + kGuardSize, kGuard);
+		const auto decoded = base64Url::decode(encoded, buffer.data(), implementation);
+		overrun = false;
+		for (auto index = size; index < buffer.size(); ++index)
+		{
+			overrun = overrun || buffer[index] != kGuard;
+		}
+		if (!decoded)
+		{
+			return std::nullopt;
+		}
+		return std::string(buffer.data(), *decoded);
+	}
+
+	//  Checks that all supported implementations decode data in the same way
+	//  expected the expected data, or std::nullopt if the data must be rejected
+	//  @return false if an implementation gave a different result
+	auto check(std::string_view encoded, const std::optional<std::string> &expected) -> bool
+	{
+		bool success = true;
+		for (auto &&[implementation, name] : kImplementations)
+		{
+			if (!base64Url::isSupported(implementation))
+			{
+				continue;
+			}
+
+			bool overrun = false;
+			const auto decoded = decode(encoded, implementation, overrun);
+			if (decoded != expected || overrun)
+			{
+				std::cerr << name << ": wrong result for input of size " << encoded.size()
+						  << (overrun ? " (wrote past the decoded data)" : "") << ": " << encoded.substr(0, 64)
+						  << (encoded.size() > 64 ? "...\n" : "\n");
+				success = false;
+			}
+		}
+		return success;
+	}
+
+	//  Runs the checks on random valid and invalid data
+	//  @return false if any of the checks failed
+	auto runChecks() -> bool
+	{
+		std::mt19937_64 random(4711);
+		bool success = true;
+
+		// The characters that are not part of the alphabet, including the padding character in the middle of the data
+		std::string invalidCharacters;
+		for (int character = 0; character < 256; ++character)
+		{
+			if (kAlphabet.find(char(character)) == std::string_view::npos)
+			{
+				invalidCharacters += char(character);
+			}
+		}
+
+		// Use all sizes up to a few vectors of the widest implementation, so that every size of the tail is covered,
+		// and some sizes of actual tokens
+		std::vector<std::size_t> sizes;
+		for (std::size_t size = 0; size <= 200; ++size)
+		{
+			sizes.push_back(size);
+		}
+		for (std::size_t size = 1100; size <= 1600; size += 37)
+		{
+			sizes.push_back(size);
+		}
+
+		for (auto size : sizes)
+		{
+			for (int round = 0; round < 20; ++round)
+			{
+				const auto data = randomData(random, size);
+				const auto encoded = encode(data);
+
+				// The data must decode the same with and without padding
+				success = check(encoded, data) && success;
+				const auto padding = (4 - encoded.size() % 4) % 4;
+				success = check(encoded + std::string(padding, '='), data) && success;
+
+				// Replace a random character by one that is not in the alphabet
+				if (!encoded.empty())
+				{
+					auto invalid = encoded;
+					invalid[random() % invalid.size()] = invalidCharacters[random() % invalidCharacters.size()];
+					const auto stripped = std::string_view(invalid).substr(0, invalid.find_last_not_of('=') + 1);
+					// Padding at the end is stripped, so replacing the last character by "=" may still be valid
+					if (stripped.size() == invalid.size() || stripped.size() % 4 == 1)
+					{
+						success = check(invalid, std::nullopt) && success;
+					}
+				}
+
+				// A single character in the last group is never valid
+				if (encoded.size() % 4 == 0)
+				{
+					success = check(encoded + "A", std::nullopt) && success;
+				}
+			}
+		}
+
+		return success;
+	}
+
+	//  Measures how long each implementation takes to decode data of a certain size
+	auto runBenchmark(std::size_t encodedSize) -> void
+	{
+		std::mt19937_64 random(815);
+		const auto encoded = encode(randomData(random, encodedSize / 4 * 3));
+		std::vector<char> buffer(base64Url::decodedSize(encoded));
+
+		constexpr int kIterations = 200'000;
+		std::cout << "decoding " << encoded.size() << " characters:\n";
+		double scalarTime = 0;
+		for (auto &&[implementation, name] : kImplementations)
+		{
+			if (!base64Url::isSupported(implementation))
+			{
+				std::cout << "  " << std::setw(8) << name << "  not supported\n";
+				continue;
+			}
+
+			std::size_t total = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (int iteration = 0; iteration < kIterations; ++iteration)
+			{
+				total += base64Url::decode(encoded, buffer.data(), implementation).value_or(0);
+			}
+			const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+			const auto time = elapsed.count() / kIterations;
+			if (implementation == base64Url::Implementation::Scalar)
+			{
+				scalarTime = time;
+			}
+			std::cout << "  " << std::setw(8) << name << std::fixed << std::setprecision(1) << std::setw(10) << time
+					  << " ns" << std::setw(8) << std::setprecision(2) << double(encoded.size()) / time << " GB/s"
+					  << std::setw(8) << scalarTime / time << "x scalar" << (total == 0 ? " (failed)" : "") << "\n";
+		}
+	}
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+	if (!runChecks())
+	{
+		return 1;
+	}
+	std::cout << "all supported implementations agree\n";
+
+	if (argc > 1 && argv[1] == "--check"sv)
+	{
+		return 0;
+	}
+
+	for (auto size : { 1536, 2048 })
+	{
+		runBenchmark(std::size_t(size));
+	}
+
+	return 0;
+}
@@ -0,0 +1,668 @@
+// Copyright (c) embedded ocean GmbH
+
+// Compares the encodings of attribute values in encode time and payload size, using a batch response with 1000
+// attributes of mixed types. The responses are decoded again and checked against the values they were made from. With
+// the argument --check, only the checks are run.
+
+#include "CborWriter.hpp"
+#include "Encoding.hpp"
+#include "JsonReader.hpp"
+#include "JsonWriter.hpp"
+#include "MessagePackWriter.hpp"
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+using namespace xentara::samples::webService;
+using namespace std::literals;
+
+namespace
+{
+	//  A value of an attribute, with std::monostate for a value that could not be read
+	using Value = std::variant<std::monostate, bool, std::int64_t, std::uint64_t, double, std::string,
+		std::chrono::system_clock::time_point>;
+
+	//  An attribute with its value
+	struct Attribute
+	{
+		//  The path of the attribute
+		std::string _path;
+
+		//  The value of the attribute
+		Value _value;
+	};
+
+	//  The encodings, with their names
+	constexpr std::array kEncodings {
+		std::pair { Encoding::Json, "JSON"sv },
+		std::pair { Encoding::Cbor, "CBOR"sv },
+		std::pair { Encoding::MessagePack, "MessagePack"sv },
+	};
+
+	//  The number of attributes in the response
+	constexpr std::size_t kAttributeCount = 1000;
+
+	//  Makes attributes with random values. Most values are numbers, as is typical for process data.
+	auto makeAttributes(std::mt19937_64 &random) -> std::vector<Attribute>
+	{
+		constexpr std::array kAttributeNames { "value"sv, "quality"sv, "updateTime"sv, "setpoint"sv, "state"sv };
+
+		std::vector<Attribute> attributes;
+		for (std::size_t index = 0; index < kAttributeCount; ++index)
+		{
+			Attribute attribute;
+			attribute._path = "Plant/Line " + std::to_string(index / 200 + 1) + "/Sensor " +
+				std::to_string(index / 5 % 40 + 1) + "/" + std::string(kAttributeNames[index % kAttributeNames.size()]);
+
+			const auto kind = random() % 20;
+			if (kind < 8)
+			{
+				attribute._value = std::uniform_real_distribution<double>(-1000.0, 1000.0)(random);
+			}
+			else if (kind < 12)
+			{
+				attribute._value = std::int64_t(random() % 2000001) - 1000000;
+			}
+			else if (kind < 14)
+			{
+				attribute._value = std::uint64_t(random() % 100000);
+			}
+			else if (kind < 16)
+			{
+				attribute._value = random() % 2 == 0;
+			}
+			else if (kind < 18)
+			{
+				// Times are whole microseconds, which is the precision of the JSON form, between 2000 and 2040
+				const auto microseconds = 946'684'800'000'000 + std::int64_t(random() % 1'262'304'000'000'000);
+				attribute._value = std::chrono::system_clock::time_point(
+					std::chrono::duration_cast<std::chrono::system_clock::duration>(
+						std::chrono::microseconds(microseconds)));
+			}
+			else if (kind < 19)
+			{
+				attribute._value = "running \"normally\"\n"s.substr(0, random() % 20);
+			}
+			attributes.push_back(std::move(attribute));
+		}
+
+		return attributes;
+	}
+
+	//  Appends a value in an encoding
+	template <Encoding kEncoding>
+	auto appendValue(std::string &data, const Value &value) -> void
+	{
+		std::visit(
+			[&](auto &&value) {
+				using Type = std::decay_t<decltype(value)>;
+				if constexpr (std::is_same_v<Type, std::monostate>)
+				{
+					kEncoding == Encoding::Json ? json::appendNull(data)
+						: kEncoding == Encoding::Cbor ? cbor::appendNull(data)
+													  : messagePack::appendNull(data);
+				}
+				else if constexpr (std::is_same_v<Type, bool>)
+				{
+					kEncoding == Encoding::Json ? json::appendBoolean(data, value)
+						: kEncoding == Encoding::Cbor ? cbor::appendBoolean(data, value)
+													  : messagePack::appendBoolean(data, value);
+				}
+				else if constexpr (std::is_same_v<Type, std::string>)
+				{
+					kEncoding == Encoding::Json ? json::appendString(data, value)
+						: kEncoding == Encoding::Cbor ? cbor::appendString(data, value)
+													  : messagePack::appendString(data, value);
+				}
+				else if constexpr (std::is_same_v<Type, std::chrono::system_clock::time_point>)
+				{
+					kEncoding == Encoding::Json ? json::appendTime(data, value)
+						: kEncoding == Encoding::Cbor ? cbor::appendTime(data, value)
+													  : messagePack::appendTime(data, value);
+				}
+				else
+				{
+					kEncoding == Encoding::Json ? json::appendNumber(data, value)
+						: kEncoding == Encoding::Cbor ? cbor::appendNumber(data, value)
+													  : messagePack::appendNumber(data, value);
+				}
+			},
+			value);
+	}
+
+	//  Encodes the values of all attributes into separate fragments, as the data snapshot does in every cycle
+	auto encodeValues(Encoding encoding, const std::vector<Attribute> &attributes, std::vector<std::string> &fragments)
+		-> void
+	{
+		fragments.resize(attributes.size());
+		for (std::size_t index = 0; index < attributes.size(); ++index)
+		{
+			auto &fragment = fragments[index];
+			fragment.clear();
+			switch (encoding)
+			{
+			case Encoding::Json:
+				appendValue<Encoding::Json>(fragment, attributes[index]._value);
+				break;
+			case Encoding::Cbor:
+				appendValue<Encoding::Cbor>(fragment, attributes[index]._value);
+				break;
+			case Encoding::MessagePack:
+				appendValue<Encoding::MessagePack>(fragment, attributes[index]._value);
+				break;
+			}
+		}
+	}
+
+	//  Encodes the paths of all attributes as member names or map keys, as the data snapshot does at startup
+	auto encodeKeys(Encoding encoding, const std::vector<Attribute> &attributes) -> std::vector<std::string>
+	{
+		std::vector<std::string> keys;
+		for (auto &&attribute : attributes)
+		{
+			std::string key;
+			switch (encoding)
+			{
+			case Encoding::Json:
+				json::appendString(key, attribute._path);
+				key.push_back(':');
+				break;
+			case Encoding::Cbor:
+				cbor::appendString(key, attribute._path);
+				break;
+			case Encoding::MessagePack:
+				messagePack::appendString(key, attribute._path);
+				break;
+			}
+			keys.push_back(std::move(key));
+		}
+		return keys;
+	}
+
+	//  Puts the keys and values together into the body of a batch response, as the server does
+	auto encodeResponse(Encoding encoding,
+		const std::vector<std::string> &keys,
+		const std::vector<std::string> &fragments,
+		std::string &body) -> void
+	{
+		body.clear();
+		switch (encoding)
+		{
+		case Encoding::Json:
+			body.push_back('{');
+			for (std::size_t index = 0; index < keys.size(); ++index)
+			{
+				if (index > 0)
+				{
+					body.push_back(',');
+				}
+				body.append(keys[index]);
+				body.append(fragments[index]);
+			}
+			body.push_back('}');
+			return;
+		case Encoding::Cbor:
+			cbor::appendMapHeader(body, keys.size());
+			break;
+		case Encoding::MessagePack:
+			messagePack::appendMapHeader(body, keys.size());
+			break;
+		}
+		for (std::size_t index = 0; index < keys.size(); ++index)
+		{
+			body.append(keys[index]);
+			body.append(fragments[index]);
+		}
+	}
+
+	//  Reads binary data, throwing an exception if it ends too early
+	class BinaryReader
+	{
+	public:
+		//  Constructor
+		explicit BinaryReader(std::string_view data) : _data(data)
+		{
+		}
+
+		//  Reads a byte
+		auto byte() -> std::uint8_t
+		{
+			return std::uint8_t(bytes(1).front());
+		}
+
+		//  Reads an unsigned integer in big endian byte order
+		auto bigEndian(std::size_t size) -> std::uint64_t
+		{
+			std::uint64_t value = 0;
+			for (auto byte : bytes(size))
+			{
+				value = (value << 8) | std::uint8_t(byte);
+			}
+			return value;
+		}
+
+		//  Reads a number of bytes
+		auto bytes(std::size_t size) -> std::string_view
+		{
+			if (_data.size() < size)
+			{
+				throw std::runtime_error("unexpected end of data");
+			}
+			const auto result = _data.substr(0, size);
+			_data.remove_prefix(size);
+			return result;
+		}
+
+		//  Checks whether all data was read
+		auto atEnd() const noexcept -> bool
+		{
+			return _data.empty();
+		}
+
+	private:
+		//  The data that has not been read yet
+		std::string_view _data;
+	};
+
+	//  Reads the head of a CBOR data item
+	//  @return the major type and the argument
+	auto readCborHead(BinaryReader &reader) -> std::pair<int, std::uint64_t>
+	{
+		const auto initial = reader.byte();
+		const auto additional = initial & 0x1f;
+		if (additional < 24)
+		{
+			return { initial >> 5, additional };
+		}
+		if (additional > 27)
+		{
+			throw std::runtime_error("unsupported CBOR argument");
+		}
+		return { initial >> 5, reader.bigEndian(std::size_t(1) << (additional - 24)) };
+	}
+
+	//  Reads a CBOR value
+	auto readCborValue(BinaryReader &reader) -> Value
+	{
+		const auto [type, argument] = readCborHead(reader);
+		switch (type)
+		{
+		case 0:
+			return argument;
+		case 1:
+			return std::int64_t(~argument);
+		case 3:
+			return std::string(reader.bytes(argument));
+		case 6:
+			// Only epoch-based date/time with a double precision number of seconds is used
+			if (argument == 1 && reader.byte() == 0xfb)
+			{
+				// A double only has a precision of about half a microsecond for current times, so the time is
+				// rounded to the microseconds the test values are made of
+				const auto seconds = std::chrono::duration<double>(std::bit_cast<double>(reader.bigEndian(8)));
+				const auto microseconds = std::chrono::round<std::chrono::microseconds>(seconds);
+				return std::chrono::system_clock::time_point(
+					std::chrono::duration_cast<std::chrono::system_clock::duration>(microseconds));
+			}
+			break;
+		case 7:
+			switch (argument)
+			{
+			case 20:
+				return false;
+			case 21:
+				return true;
+			case 22:
+				return std::monostate {};
+			default:
+				// Only double precision numbers have their bits as the argument
+				return std::bit_cast<double>(argument);
+			}
+		}
+		throw std::runtime_error("unexpected CBOR data item");
+	}
+
+	//  Decodes a CBOR batch response
+	auto decodeCbor(std::string_view body) -> std::vector<Attribute>
+	{
+		BinaryReader reader(body);
+		const auto [type, size] = readCborHead(reader);
+		if (type != 5)
+		{
+			throw std::runtime_error("CBOR response is not a map");
+		}
+
+		std::vector<Attribute> attributes;
+		for (std::uint64_t index = 0; index < size; ++index)
+		{
+			auto path = readCborValue(reader);
+			if (!std::holds_alternative<std::string>(path))
+			{
+				throw std::runtime_error("CBOR map key is not a text string");
+			}
+			attributes.push_back({ std::get<std::string>(path), readCborValue(reader) });
+		}
+		if (!reader.atEnd())
+		{
+			throw std::runtime_error("data after the end of the CBOR response");
+		}
+		return attributes;
+	}
+
+	//  Reads the size of a MessagePack string, or std::nullopt if the next object is not a string
+	auto readMessagePackStringSize(std::uint8_t type, BinaryReader &reader) -> std::optional<std::size_t>
+	{
+		if ((type & 0xe0) == 0xa0)
+		{
+			return type & 0x1f;
+		}
+		if (type >= 0xd9 && type <= 0xdb)
+		{
+			return reader.bigEndian(std::size_t(1) << (type - 0xd9));
+		}
+		return std::nullopt;
+	}
+
+	//  Reads a MessagePack value
+	auto readMessagePackValue(BinaryReader &reader) -> Value
+	{
+		const auto type = reader.byte();
+		if (const auto size = readMessagePackStringSize(type, reader))
+		{
+			return std::string(reader.bytes(*size));
+		}
+		switch (type)
+		{
+		case 0xc0:
+			return std::monostate {};
+		case 0xc2:
+			return false;
+		case 0xc3:
+			return true;
+		case 0xcb:
+			return std::bit_cast<double>(reader.bigEndian(8));
+		case 0xcf:
+			return reader.bigEndian(8);
+		case 0xd3:
+			return std::int64_t(reader.bigEndian(8));
+		case 0xc7:
+			// Only the 96 bit form of the timestamp extension type is used
+			if (reader.byte() == 12 && std::int8_t(reader.byte()) == -1)
+			{
+				const auto nanoseconds = std::chrono::nanoseconds(reader.bigEndian(4));
+				const auto seconds = std::chrono::seconds(std::int64_t(reader.bigEndian(8)));
+				return std::chrono::system_clock::time_point(
+					std::chrono::duration_cast<std::chrono::system_clock::duration>(seconds + nanoseconds));
+			}
+			break;
+		}
+		throw std::runtime_error("unexpected MessagePack object");
+	}
+
+	//  Decodes a MessagePack batch response
+	auto decodeMessagePack(std::string_view body) -> std::vector<Attribute>
+	{
+		BinaryReader reader(body);
+		const auto type = reader.byte();
+		std::uint64_t size = 0;
+		if ((type & 0xf0) == 0x80)
+		{
+			size = type & 0x0f;
+		}
+		else if (type == 0xde || type == 0xdf)
+		{
+			size = reader.bigEndian(type == 0xde ? 2 : 4);
+		}
+		else
+		{
+			throw std::runtime_error("MessagePack response is not a map");
+		}
+
+		std::vector<Attribute> attributes;
+		for (std::uint64_t index = 0; index < size; ++index)
+		{
+			auto path = readMessagePackValue(reader);
+			if (!std::holds_alternative<std::string>(path))
+			{
+				throw std::runtime_error("MessagePack map key is not a string");
+			}
+			attributes.push_back({ std::get<std::string>(path), readMessagePackValue(reader) });
+		}
+		if (!reader.atEnd())
+		{
+			throw std::runtime_error("data after the end of the MessagePack response");
+		}
+		return attributes;
+	}
+
+	//  Formats a time in ISO 8601 format with microseconds, independently of the JSON writer
+	auto formatTime(std::chrono::system_clock::time_point time) -> std::string
+	{
+		const auto microseconds =
+			std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+		const auto seconds = std::time_t(microseconds / 1'000'000);
+		std::tm parts {};
+#ifdef _WIN32
+		gmtime_s(&parts, &seconds);
+#else
+		gmtime_r(&seconds, &parts);
+#endif
+		char text[64];
+		std::snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ", parts.tm_year + 1900,
+			parts.tm_mon + 1, parts.tm_mday, parts.tm_hour, parts.tm_min, parts.tm_sec, int(microseconds % 1'000'000));
+		return text;
+	}
+
+	//  Parses a JSON number as the type of the expected value
+	template <class Number>
+	auto parseNumber(std::string_view text) -> Value
+	{
+		Number number {};
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+		if (error != std::errc {} || end != text.data() + text.size())
+		{
+			throw std::runtime_error("invalid JSON number");
+		}
+		return number;
+	}
+
+	//  Decodes a JSON batch response. JSON does not tell the types of numbers, or strings from times, so the
+	// expected attributes are used to select them.
+	auto decodeJson(std::string_view body, const std::vector<Attribute> &expected) -> std::vector<Attribute>
+	{
+		JsonReader reader(body);
+		reader.beginObject();
+
+		std::vector<Attribute> attributes;
+		std::string path;
+		while (reader.nextMember(path))
+		{
+			const auto &expectedValue = expected.at(attributes.size())._value;
+			Value value;
+			switch (reader.nextKind())
+			{
+			case JsonReader::Kind::Null:
+				reader.readNull();
+				break;
+			case JsonReader::Kind::Boolean:
+				value = reader.readBoolean();
+				break;
+			case JsonReader::Kind::String:
+			{
+				std::string text;
+				reader.readString(text);
+				if (std::holds_alternative<std::chrono::system_clock::time_point>(expectedValue) &&
+					text == formatTime(std::get<std::chrono::system_clock::time_point>(expectedValue)))
+				{
+					value = expectedValue;
+				}
+				else
+				{
+					value = std::move(text);
+				}
+				break;
+			}
+			case JsonReader::Kind::Number:
+			{
+				const auto text = reader.readNumber();
+				if (std::holds_alternative<std::int64_t>(expectedValue))
+				{
+					value = parseNumber<std::int64_t>(text);
+				}
+				else if (std::holds_alternative<std::uint64_t>(expectedValue))
+				{
+					value = parseNumber<std::uint64_t>(text);
+				}
+				else
+				{
+					value = parseNumber<double>(text);
+				}
+				break;
+			}
+			default:
+				throw std::runtime_error("unexpected JSON value");
+			}
+			attributes.push_back({ path, std::move(value) });
+		}
+		reader.finish();
+
+		return attributes;
+	}
+
+	//  Checks whether a decoded value is the same as the value that was encoded. Non-negative integers are decoded
+	// as unsigned in CBOR.
+	auto sameValue(const Value &expected, const Value &decoded) -> bool
+	{
+		if (const auto integer = std::get_if<std::int64_t>(&expected); integer && *integer >= 0)
+		{
+			if (const auto unsignedInteger = std::get_if<std::uint64_t>(&decoded))
+			{
+				return std::uint64_t(*integer) == *unsignedInteger;
+			}
+		}
+		return expected == decoded;
+	}
+
+	//  Checks that a response decodes to the attributes it was made from
+	//  @return false if the response was different
+	auto check(Encoding encoding, std::string_view name, std::string_view body, const std::vector<Attribute> &expected)
+		-> bool
+	{
+		std::vector<Attribute> decoded;
+		try
+		{
+			switch (encoding)
+			{
+			case Encoding::Json:
+				decoded = decodeJson(body, expected);
+				break;
+			case Encoding::Cbor:
+				decoded = decodeCbor(body);
+				break;
+			case Encoding::MessagePack:
+				decoded = decodeMessagePack(body);
+				break;
+			}
+		}
+		catch (const std::exception &exception)
+		{
+			std::cerr << name << ": could not decode the response: " << exception.what() << "\n";
+			return false;
+		}
+
+		if (decoded.size() != expected.size())
+		{
+			std::cerr << name << ": response has " << decoded.size() << " instead of " << expected.size()
+					  << " attributes\n";
+			return false;
+		}
+		for (std::size_t index = 0; index < expected.size(); ++index)
+		{
+			if (decoded[index]._path != expected[index]._path ||
+				!sameValue(expected[index]._value, decoded[index]._value))
+			{
+				std::cerr << name << ": attribute " << expected[index]._path << " was decoded wrongly\n";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//  Measures the average duration of a function in microseconds
+	template <class Function>
+	auto measure(int iterations, Function &&function) -> double
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			function();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+	}
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+	std::mt19937_64 random(2024);
+	const auto attributes = makeAttributes(random);
+	const bool checkOnly = argc > 1 && argv[1] == "--check"sv;
+
+	// Check all encodings first, so that the numbers are only printed for correct encoders
+	bool success = true;
+	std::vector<std::string> fragments;
+	std::string body;
+	for (auto &&[encoding, name] : kEncodings)
+	{
+		encodeValues(encoding, attributes, fragments);
+		encodeResponse(encoding, encodeKeys(encoding, attributes), fragments, body);
+		success = check(encoding, name, body, attributes) && success;
+	}
+	if (!success)
+	{
+		return 1;
+	}
+	std::cout << "all encodings decode to the original values\n";
+	if (checkOnly)
+	{
+		return 0;
+	}
+
+	constexpr int kIterations = 2000;
+	std::cout << "batch response with " << attributes.size() << " attributes:\n"
+			  << "  " << std::left << std::setw(12) << "encoding" << std::right << std::setw(14) << "values (us)"
+			  << std::setw(16) << "response (us)" << std::setw(16) << "size (bytes)" << std::setw(12) << "vs JSON\n";
+	std::size_t jsonSize = 0;
+	for (auto &&[encoding, name] : kEncodings)
+	{
+		// Encoding the values is done once per cycle, and putting together the response once per request
+		const auto keys = encodeKeys(encoding, attributes);
+		const auto valueTime = measure(kIterations, [&] { encodeValues(encoding, attributes, fragments); });
+		const auto responseTime = measure(kIterations, [&] { encodeResponse(encoding, keys, fragments, body); });
+
+		if (encoding == Encoding::Json)
+		{
+			jsonSize = body.size();
+		}
+		std::cout << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+				  << std::setw(14) << valueTime << std::setw(16) << responseTime << std::setw(16) << body.size()
+				  << std::setw(10) << std::setprecision(2) << double(body.size()) / double(jsonSize) << "x\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+// Copyright (c) embedded ocean GmbH
+
+// Measures the cost of producing a response on the path every request takes: building a new string for each response,
+// as the server originally did, building it in the buffer that is reused by each thread, and sending a response that
+// was built in advance. Each response is copied into a buffer afterwards, which stands in for the write to the
+// connection. The responses of all three methods are first checked to be the same. With the argument --check, only the
+// checks are run.
+
+#include <xentara/utils/string/cat.hpp>
+
+#include "HttpResponse.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace xentara;
+using namespace xentara::samples::webService;
+using namespace std::literals;
+
+namespace
+{
+	//  A response that is measured
+	struct Case
+	{
+		//  The name of the case
+		std::string_view _name;
+
+		//  The status code and reason
+		std::string_view _responseCode;
+
+		//  The body
+		std::string _responseData;
+
+		//  The headers to send in addition to the content headers
+		std::string_view _extraHeaders;
+	};
+
+	//  Builds a response in a new string, as the server did before responses were prepared in advance
+	auto concatenatedResponse(const Case &response) -> std::string
+	{
+		std::string result = utils::string::cat("HTTP/1.1 ",
+			response._responseCode,
+			"\r\n",
+			response._extraHeaders,
+			"Content-Length: ",
+			response._responseData.size(),
+			"\r\n"
+			"Content-Type: text/plain\r\n\r\n");
+		if (!response._responseData.empty())
+		{
+			result += response._responseData;
+		}
+		return result;
+	}
+
+	//  Makes the responses that are measured: the greeting, an authentication error, and a larger body
+	auto makeCases() -> std::vector<Case>
+	{
+		std::string largeBody;
+		while (largeBody.size() < 4096)
+		{
+			largeBody += "{\"Plant/Line 1/Sensor 7/value\":21.375},"sv;
+		}
+
+		return {
+			{ "greeting"sv, "200 OK"sv, "Hello from Xentara!", {} },
+			{ "401"sv, "401 Unauthorized"sv, "invalid token \r\n",
+				"WWW-Authenticate: Bearer realm=\"xentara\", error=\"invalid_token\"\r\n"sv },
+			{ "4 KB body"sv, "200 OK"sv, std::move(largeBody), "Vary: Accept, Accept-Encoding\r\n"sv },
+		};
+	}
+
+	//  The buffer the responses are copied to, in place of the connection
+	std::array<char, 65536> gConnection;
+
+	//  Copies a response to the connection buffer
+	auto copyToConnection(std::string_view response) -> void
+	{
+		std::memcpy(gConnection.data(), response.data(), std::min(response.size(), gConnection.size()));
+	}
+
+	//  Signature of the function that writes a response
+	using WriteFunction = auto (*)(std::string_view response) -> void;
+
+	//  Writes a response. The function is called through a volatile pointer, so that the compiler cannot leave out
+	// the copies, whose result is never read.
+	volatile WriteFunction writeResponse = &copyToConnection;
+
+	//  Measures the average duration of a function in nanoseconds
+	template <class Function>
+	auto measure(Function &&function) -> double
+	{
+		constexpr int kIterations = 1'000'000;
+		const auto start = std::chrono::steady_clock::now();
+		for (int iteration = 0; iteration < kIterations; ++iteration)
+		{
+			function();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::nano>(elapsed).count() / kIterations;
+	}
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+	const auto cases = makeCases();
+
+	// Check that all methods produce the same response
+	bool success = true;
+	for (auto &&response : cases)
+	{
+		const auto expected = concatenatedResponse(response);
+		std::string prepared;
+		serializeResponse(prepared, response._responseCode, response._responseData, response._extraHeaders);
+		const auto dynamic =
+			dynamicResponse(response._responseCode, response._responseData, response._extraHeaders);
+		if (prepared != expected || dynamic != expected)
+		{
+			std::cerr << response._name << ": the responses differ\n";
+			success = false;
+		}
+	}
+	if (!success)
+	{
+		return 1;
+	}
+	std::cout << "all methods produce the same responses\n";
+	if (argc > 1 && argv[1] == "--check"sv)
+	{
+		return 0;
+	}
+
+	std::cout << "  " << std::left << std::setw(12) << "response" << std::right << std::setw(16) << "new string"
+			  << std::setw(16) << "thread buffer" << std::setw(16) << "prepared\n";
+	for (auto &&response : cases)
+	{
+		const auto concatenated = measure([&] { writeResponse(concatenatedResponse(response)); });
+		const auto dynamic = measure([&] {
+			writeResponse(dynamicResponse(response._responseCode, response._responseData, response._extraHeaders));
+		});
+		std::string prepared;
+		serializeResponse(prepared, response._responseCode, response._responseData, response._extraHeaders);
+		const auto preparedTime = measure([&] { writeResponse(prepared); });
+
+		std::cout << "  " << std::left << std::setw(12) << response._name << std::right << std::fixed
+				  << std::setprecision(1) << std::setw(13) << concatenated << " ns" << std::setw(13) << dynamic << " ns"
+				  << std::setw(13) << preparedTime << " ns\n";
+	}
+
+	return 0;
+}
@@ -5,6 +5,14 @@
 #include <xentara/utils/json/decoder/Errors.hpp>
 #include <libhttp.h>
 
+#include "AuthenticationResult.hpp"
+#include "HttpError.hpp"
+#include "Logger.hpp"
+#include "RequestContext.hpp"
+#include "StringHash.hpp"
+
+#include <vector>
+
  namespace xentara::samples::webService
 {
 
@@ -20,12 +28,25 @@ public:
 	//  jsonObject the object from the json file
 	virtual auto loadConfig(utils::json::decoder::Object &jsonObject) -> void = 0;
 
+	//  Sets the claims that select the rate limit of a client. This is called before initialize(), if rate limiting
+	// is configured.
+	//  claims the claims of each limit after the default limit. The provider stores the number of the first limit
+	// with a matching claim, starting at 1, in RequestContext::_rateLimit, or 0 if no limit matches.
+	virtual auto setRateLimitClaims(std::vector<StringMap<StringSet>> claims) -> void = 0;
+
 	//  This function will initiates all the parameters for the Authentication Provider
-	virtual auto initialize() -> void = 0;
+	//  logger the logger for messages from the provider, which must outlive the provider
+	virtual auto initialize(Logger &logger) -> void = 0;
 
 	//  verifies the OpenId authentication
 	//  request contains information about the HTTP request
-	virtual auto checkAuthentication(const lh_rqi_t *request) -> void = 0;
+	//  context receives information about the client, like the subject of the token
+	//  @return the result of the check. Exceptions are only thrown for unexpected errors.
+	virtual auto checkAuthentication(const lh_rqi_t *request, RequestContext &context) -> AuthenticationResult = 0;
+
+	//  Gets the error response for a failed authentication check. The responses are built once in initialize().
+	//  result the result of the check, which must not be AuthenticationResult::Success
+	virtual auto errorResponse(AuthenticationResult result) const -> const HttpError & = 0;
 };
 
 //  Pure Virtual deconstructor
@@ -108,4 +108,36 @@ auto AbstractTokenVerification::readFile(const std::filesystem::path &path) -> s
 	return { keyText.data(), keyText.size() };
 }
 
+auto AbstractTokenVerification::verifySignature(const SignatureVerifier &verifier, const DecodedJwt &token)
+	-> AuthenticationResult
+{
+	// The token must use the algorithm of the key, otherwise an attacker could e.g. sign a token with HS256 using
+	// the public key of an RS256 key pair as secret
+	if (token.algorithm() != verifier.algorithm())
+	{
+		return AuthenticationResult::UnknownKey;
+	}
+
+	// The jwt-cpp algorithms need strings. Reuse the same strings for each token so no memory needs to be allocated
+	// in the steady state.
+	thread_local std::string data;
+	thread_local std::string signature;
+	data.assign(token.signingInput());
+	signature.assign(token.signature());
+
+	// Error code of the verifier
+	std::error_code errorCode;
+
+	// Verify the signature
+	verifier.verify(data, signature, errorCode);
+
+	// Check if there is any error during verification process
+	if (errorCode)
+	{
+		return AuthenticationResult::InvalidSignature;
+	}
+
+	return AuthenticationResult::Success;
+}
+
 } // namespace xentara::samples::webService
\ No newline at end of file
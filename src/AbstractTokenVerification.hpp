@@ -5,8 +5,12 @@
 #include <xentara/utils/json/decoder/Document.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
 
-#include "JwtCpp.hpp"
+#include "AuthenticationResult.hpp"
+#include "DecodedJwt.hpp"
+#include "Logger.hpp"
+#include "TokenVerifierFactory.hpp"
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 
@@ -25,16 +29,36 @@ public:
 	virtual auto loadConfig(utils::json::decoder::Object &jsonObject) -> void = 0;
 
 	// Initialize the parameters for the token Verification
-	virtual auto initialize() -> void = 0;
+	//  logger the logger for messages about the keys, which must outlive the verification
+	virtual auto initialize(Logger &logger) -> void = 0;
 
 	// verify the token
-	virtual auto verify(const JwtToken &token) -> void = 0;
+	//  @return AuthenticationResult::Success if the signature is valid, or the reason why it is not
+	virtual auto verify(const DecodedJwt &token) -> AuthenticationResult = 0;
+
+	//  Checks the header of a token before the payload is decoded, so that tokens that can never be verified are
+	// rejected cheaply
+	//  token the token, of which only the header has been decoded
+	//  @return false if there is no key for the algorithm and key ID in the token header
+	virtual auto precheck(const DecodedJwt &token) -> bool = 0;
+
+	//  Gets a number that changes whenever the keys change. Rejections that are remembered for a token are only valid
+	// as long as this number stays the same, because new keys may make a previously rejected token valid.
+	virtual auto keyGeneration() const noexcept -> std::uint64_t
+	{
+		return 0;
+	}
 
 	//  read the from JSON Object, the type of authentication and returns the apropriate TokenVerifier
 	static auto load(utils::json::decoder::Object &jsonObject) -> std::unique_ptr<AbstractTokenVerification>;
 
 	//  read the key from the file
 	auto readFile(const std::filesystem::path &path) -> std::string;
+
+protected:
+	//  verifies the signature of a token using a specific verifier
+	//  @return AuthenticationResult::Success if the signature is valid, or the reason why it is not
+	auto verifySignature(const SignatureVerifier &verifier, const DecodedJwt &token) -> AuthenticationResult;
 };
 
 //  the virtual destructor
@@ -0,0 +1,247 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/config/Errors.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+#include <xentara/utils/string/cat.hpp>
+
+#include "AccessLog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  Converts a duration to nanoseconds, clamping it to the range of a record field
+	auto toRecordTime(std::chrono::nanoseconds duration) noexcept -> std::uint32_t
+	{
+		return std::uint32_t(std::clamp<std::chrono::nanoseconds::rep>(
+			duration.count(), 0, std::numeric_limits<std::uint32_t>::max()));
+	}
+} // namespace
+
+auto AccessLog::loadConfig(utils::json::decoder::Object &jsonObject) -> void
+{
+	// Go through all parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"file")
+		{
+			// The file is a string
+			auto file = value.asString<std::u8string>();
+
+			// Store the file
+			_file = std::string(file.begin(), file.end());
+
+			// check it the path the file is relative
+			if (!_file.is_absolute())
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("invalid access log file path : set absolute path for the access log file "
+									   "of the Web Service Server"));
+			}
+		}
+		else if (key == u8"maxFileSize")
+		{
+			// The maximum file size is a number
+			_maxFileSize = value.asNumber<std::uint64_t>();
+
+			// The file must be able to hold at least one record
+			if (_maxFileSize < sizeof(AccessLogHeader) + sizeof(AccessLogRecord))
+			{
+				utils::json::decoder::throwWithLocation(
+					value, std::runtime_error("maxFileSize of the access log of the Web Service Server is too small"));
+			}
+		}
+		else if (key == u8"maxFiles")
+		{
+			// The number of old files is a number
+			_maxFiles = value.asNumber<std::uint32_t>();
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+
+	// Check if the file has been found
+	if (_file.empty())
+	{
+		utils::json::decoder::throwWithLocation(
+			jsonObject, std::runtime_error("missing file for the access log of the Web Service Server"));
+	}
+}
+
+auto AccessLog::start() -> void
+{
+	open();
+
+	_thread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+}
+
+auto AccessLog::stop() -> void
+{
+	if (_thread.joinable())
+	{
+		_thread.request_stop();
+		_thread.join();
+	}
+
+	// Write anything that was logged after the thread last looked
+	if (_stream)
+	{
+		drain();
+		std::fclose(_stream);
+		_stream = nullptr;
+	}
+}
+
+auto AccessLog::log(const lh_rqi_t &request, const RequestContext &context) noexcept -> void
+{
+	// Fill in the record directly in the ring buffer of this thread, or drop it if the buffer is full
+	bool queued = false;
+	try
+	{
+		queued = _rings.local().tryPush([&](AccessLogRecord &record) {
+			record._timestamp = std::uint64_t(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(context._receiveTime.time_since_epoch()).count());
+			record._authenticationTime = toRecordTime(context.stageTime(RequestStage::Authentication));
+			record._handlingTime = toRecordTime(context.stageTime(RequestStage::Handling));
+			record._writeTime = toRecordTime(context.stageTime(RequestStage::Write));
+			record._responseSize = std::uint32_t(std::min<std::size_t>(context._responseSize, UINT32_MAX));
+			record._status = context._status;
+			record._authenticationResult = std::uint8_t(context._authenticationResult);
+			record._reserved = 0;
+			setRecordField(record._method, request.request_method ? request.request_method : "");
+			setRecordField(record._subject, context._subject.view());
+			setRecordField(record._uri, request.uri ? request.uri : "");
+		});
+	}
+	catch (...)
+	{
+		// Logging must never fail, so the record is dropped if there is no memory for a ring buffer
+	}
+
+	if (!queued)
+	{
+		_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+auto AccessLog::open() -> void
+{
+	// Append to an existing file
+	_stream = std::fopen(_file.string().c_str(), "ab");
+	if (!_stream)
+	{
+		throw std::system_error(errno, std::generic_category(), "could not open access log " + _file.string());
+	}
+
+	// Write the header if the file is new
+	std::error_code errorCode;
+	_fileSize = std::filesystem::file_size(_file, errorCode);
+	if (errorCode || _fileSize == 0)
+	{
+		const AccessLogHeader header { ._recordSize = sizeof(AccessLogRecord) };
+		std::fwrite(&header, sizeof(header), 1, _stream);
+		_fileSize = sizeof(header);
+	}
+}
+
+auto AccessLog::rotate() -> void
+{
+	// The file may already be closed if a previous rotation failed
+	if (_stream)
+	{
+		std::fclose(_stream);
+		_stream = nullptr;
+	}
+
+	// Shift the old files, dropping the oldest one
+	std::error_code errorCode;
+	const auto numbered = [this](std::uint32_t number) {
+		auto path = _file;
+		path += utils::string::cat(".", number);
+		return path;
+	};
+	if (_maxFiles == 0)
+	{
+		std::filesystem::remove(_file, errorCode);
+	}
+	else
+	{
+		for (auto number = _maxFiles - 1; number > 0; --number)
+		{
+			std::filesystem::rename(numbered(number), numbered(number + 1), errorCode);
+		}
+		std::filesystem::rename(_file, numbered(1), errorCode);
+	}
+
+	open();
+}
+
+auto AccessLog::drain() -> bool
+{
+	// Collect all records that are ready
+	_batch.clear();
+	_rings.drain([this](const AccessLogRecord &record) {
+		_batch.append(reinterpret_cast<const char *>(&record), sizeof(record));
+	});
+
+	if (_batch.empty())
+	{
+		return false;
+	}
+
+	// Write the records, starting a new file whenever the current one is full. Records are never split between
+	// files.
+	std::string_view remaining(_batch);
+	while (!remaining.empty())
+	{
+		if (_fileSize + sizeof(AccessLogRecord) > _maxFileSize)
+		{
+			try
+			{
+				rotate();
+			}
+			catch (...)
+			{
+				// Drop the records if no new file could be opened. We will try again with the next batch.
+				return true;
+			}
+		}
+
+		const auto records = std::max<std::uint64_t>((_maxFileSize - _fileSize) / sizeof(AccessLogRecord), 1);
+		const auto chunk = remaining.substr(0, std::size_t(records * sizeof(AccessLogRecord)));
+		std::fwrite(chunk.data(), 1, chunk.size(), _stream);
+		_fileSize += chunk.size();
+		remaining.remove_prefix(chunk.size());
+	}
+
+	std::fflush(_stream);
+	return true;
+}
+
+auto AccessLog::run(std::stop_token stopToken) -> void
+{
+	// How long to wait when there was nothing to write
+	constexpr auto kIdleInterval = 50ms;
+
+	while (!stopToken.stop_requested())
+	{
+		if (!drain())
+		{
+			std::this_thread::sleep_for(kIdleInterval);
+		}
+	}
+}
+
+} // namespace xentara::samples::webService
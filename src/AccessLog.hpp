@@ -0,0 +1,108 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "AccessLogRecord.hpp"
+#include "RequestContext.hpp"
+#include "RingBuffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <libhttp.h>
+
+namespace xentara::samples::webService
+{
+
+//  A binary access log. Each worker thread writes the records for its requests into its own lock-free ring buffer,
+// and a background thread writes them to the log file in large sequential writes. When the file gets too large, it is
+// renamed by appending ".1", older files are renamed to ".2", ".3" and so on, and a new file is started.
+//
+// The records have the fixed size format described by AccessLogRecord, and can be converted to text using the
+// decode-access-log tool.
+class AccessLog
+{
+public:
+	//  Destructor. This stops the background thread and writes any remaining records.
+	~AccessLog()
+	{
+		stop();
+	}
+
+	//  Loads the configuration from the JSON Object
+	//  jsonObject the object from the json file
+	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Opens the log file and starts the background thread
+	auto start() -> void;
+
+	//  Stops the background thread, writes any remaining records and closes the file
+	auto stop() -> void;
+
+	//  Adds a record for a request. This never blocks; if the ring buffer of the calling thread is full, the record is
+	// dropped and counted.
+	//  request the request
+	//  context the information collected while handling the request
+	auto log(const lh_rqi_t &request, const RequestContext &context) noexcept -> void;
+
+	//  Gets the total number of records that were dropped because a ring buffer was full
+	auto droppedRecords() const noexcept -> std::uint64_t
+	{
+		return _droppedRecords.load(std::memory_order_relaxed);
+	}
+
+	//  The number of records each thread can queue before records are dropped
+	static constexpr std::size_t kRingCapacity = 512;
+
+private:
+	//  Opens the log file, writing the header if the file is new
+	auto open() -> void;
+
+	//  Closes the log file, renames it and the older files, and opens a new file
+	auto rotate() -> void;
+
+	//  Writes all queued records to the file
+	//  @return whether any records were written
+	auto drain() -> bool;
+
+	//  Drains the ring buffers until a stop is requested
+	auto run(std::stop_token stopToken) -> void;
+
+	//  The path of the log file
+	std::filesystem::path _file;
+
+	//  The size at which the file is rotated
+	std::uint64_t _maxFileSize { 64 * 1024 * 1024 };
+
+	//  The number of old files to keep
+	std::uint32_t _maxFiles { 4 };
+
+	//  The open log file
+	std::FILE *_stream { nullptr };
+
+	//  The size of the open log file
+	std::uint64_t _fileSize { 0 };
+
+	//  The ring buffers of the worker threads
+	RingBufferSet<AccessLogRecord, kRingCapacity> _rings;
+
+	//  The number of records dropped because a ring buffer was full
+	std::atomic<std::uint64_t> _droppedRecords { 0 };
+
+	//  The buffer used to collect records before writing them. This is only used by the thread draining the rings.
+	std::string _batch;
+
+	//  The background thread. This must be the last member, so that it is stopped before anything it uses is
+	// destroyed.
+	std::jthread _thread;
+};
+
+} // namespace xentara::samples::webService
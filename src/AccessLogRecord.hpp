@@ -0,0 +1,89 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  The header at the start of every access log file
+struct AccessLogHeader
+{
+	//  The magic number identifying access log files
+	static constexpr std::array<char, 8> kMagic { 'X', 'W', 'S', 'A', 'C', 'C', 'L', 'G' };
+
+	//  The current version of the format
+	static constexpr std::uint32_t kVersion = 1;
+
+	//  The magic number
+	std::array<char, 8> _magic { kMagic };
+
+	//  The version of the format
+	std::uint32_t _version { kVersion };
+
+	//  The size of each record, so that readers can skip fields added in later versions
+	std::uint32_t _recordSize { 0 };
+};
+
+static_assert(sizeof(AccessLogHeader) == 16);
+
+//  A record in the access log. The records have a fixed size, and are written in the native byte order of the
+// machine. Strings are padded with zeros, and are truncated if they are too long.
+struct AccessLogRecord
+{
+	//  The time the request was received, in nanoseconds since the Unix epoch
+	std::uint64_t _timestamp;
+
+	//  The time taken to check the authentication, in nanoseconds
+	std::uint32_t _authenticationTime;
+
+	//  The time taken to handle the request after it was authenticated, in nanoseconds
+	std::uint32_t _handlingTime;
+
+	//  The time taken to write the response, in nanoseconds
+	std::uint32_t _writeTime;
+
+	//  The size of the response, in bytes
+	std::uint32_t _responseSize;
+
+	//  The HTTP status code of the response
+	std::uint16_t _status;
+
+	//  The result of the authentication check, as a value of AuthenticationResult
+	std::uint8_t _authenticationResult;
+
+	//  Reserved, always 0
+	std::uint8_t _reserved;
+
+	//  The request method
+	std::array<char, 12> _method;
+
+	//  The subject of the token, or empty if there was no valid token
+	std::array<char, 64> _subject;
+
+	//  The request URI
+	std::array<char, 152> _uri;
+};
+
+static_assert(sizeof(AccessLogRecord) == 256);
+
+//  Copies a string into a fixed size field of a record, truncating it and padding it with zeros
+template <std::size_t kSize>
+auto setRecordField(std::array<char, kSize> &field, std::string_view value) noexcept -> void
+{
+	const auto end = std::copy_n(value.data(), std::min(value.size(), kSize), field.data());
+	std::fill(end, field.data() + kSize, '\0');
+}
+
+//  Gets a string from a fixed size field of a record
+template <std::size_t kSize>
+auto recordField(const std::array<char, kSize> &field) noexcept -> std::string_view
+{
+	return { field.data(), std::size_t(std::find(field.begin(), field.end(), '\0') - field.begin()) };
+}
+
+} // namespace xentara::samples::webService
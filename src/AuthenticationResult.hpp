@@ -0,0 +1,102 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  The result of an authentication check. Failed checks are reported using these codes instead of exceptions, so that
+// rejecting a request does not need to allocate memory or unwind the stack. The codes are used as indices into a table
+// of error responses that the authentication provider builds once when it is initialized.
+enum class AuthenticationResult : std::uint8_t
+{
+	//  The request is authenticated
+	Success,
+
+	//  The request contains no Authorization header
+	MissingAuthorization,
+
+	//  The request contains more than one Authorization header
+	DuplicateAuthorization,
+
+	//  The Authorization header is empty
+	EmptyAuthorization,
+
+	//  The Authorization header does not contain a bearer token
+	UnsupportedMethod,
+
+	//  The token could not be decoded
+	MalformedToken,
+
+	//  The token is not valid yet
+	NotYetValid,
+
+	//  The token has expired
+	Expired,
+
+	//  The token contains no audience
+	MissingAudience,
+
+	//  The token is not meant for this server
+	WrongAudience,
+
+	//  The token is missing the issuer, or has a different issuer
+	WrongIssuer,
+
+	//  The token uses an unknown key ID or an algorithm that does not match the key
+	UnknownKey,
+
+	//  The signature of the token is invalid
+	InvalidSignature,
+
+	//  None of the configured claims matched
+	ClaimsMismatch
+};
+
+//  The number of different authentication results
+constexpr std::size_t kAuthenticationResultCount = std::size_t(AuthenticationResult::ClaimsMismatch) + 1;
+
+//  Gets a name for an authentication result, for use in logs
+constexpr auto authenticationResultName(AuthenticationResult result) noexcept -> std::string_view
+{
+	using namespace std::literals;
+
+	switch (result)
+	{
+	case AuthenticationResult::Success:
+		return "success"sv;
+	case AuthenticationResult::MissingAuthorization:
+		return "missing_authorization"sv;
+	case AuthenticationResult::DuplicateAuthorization:
+		return "duplicate_authorization"sv;
+	case AuthenticationResult::EmptyAuthorization:
+		return "empty_authorization"sv;
+	case AuthenticationResult::UnsupportedMethod:
+		return "unsupported_method"sv;
+	case AuthenticationResult::MalformedToken:
+		return "malformed_token"sv;
+	case AuthenticationResult::NotYetValid:
+		return "not_yet_valid"sv;
+	case AuthenticationResult::Expired:
+		return "expired"sv;
+	case AuthenticationResult::MissingAudience:
+		return "missing_audience"sv;
+	case AuthenticationResult::WrongAudience:
+		return "wrong_audience"sv;
+	case AuthenticationResult::WrongIssuer:
+		return "wrong_issuer"sv;
+	case AuthenticationResult::UnknownKey:
+		return "unknown_key"sv;
+	case AuthenticationResult::InvalidSignature:
+		return "invalid_signature"sv;
+	case AuthenticationResult::ClaimsMismatch:
+		return "claims_mismatch"sv;
+	}
+
+	return "unknown"sv;
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,368 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "Base64Url.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define XENTARA_WEB_SERVICE_BASE64_SIMD 1
+#	include <immintrin.h>
+#	define XENTARA_WEB_SERVICE_TARGET(features) __attribute__((target(features)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#	define XENTARA_WEB_SERVICE_BASE64_SIMD 1
+#	include <immintrin.h>
+#	include <intrin.h>
+#	define XENTARA_WEB_SERVICE_TARGET(features)
+#endif
+
+namespace xentara::samples::webService::base64Url
+{
+
+namespace
+{
+	//  Marker for characters that are not part of the alphabet
+	constexpr std::uint8_t kInvalid = 0xff;
+
+	//  Creates the table that maps characters to their 6 bit values
+	constexpr auto makeDecodingTable() -> std::array<std::uint8_t, 256>
+	{
+		std::array<std::uint8_t, 256> table {};
+		for (auto &&entry : table)
+		{
+			entry = kInvalid;
+		}
+
+		constexpr std::string_view kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+		for (std::size_t i = 0; i < kAlphabet.size(); ++i)
+		{
+			table[static_cast<unsigned char>(kAlphabet[i])] = static_cast<std::uint8_t>(i);
+		}
+
+		return table;
+	}
+
+	//  The table that maps characters to their 6 bit values
+	constexpr auto kDecodingTable = makeDecodingTable();
+
+	//  Gets the 6 bit value of a character
+	constexpr auto sextet(char character) noexcept -> std::uint32_t
+	{
+		return kDecodingTable[static_cast<unsigned char>(character)];
+	}
+
+	//  Decodes unpadded data one group of four characters at a time
+	auto decodeScalar(std::string_view encoded, char *output) noexcept -> std::optional<std::size_t>
+	{
+		auto input = encoded.data();
+		const auto end = input + encoded.size();
+		auto next = output;
+
+		// Decode all the complete groups of four characters
+		for (; end - input >= 4; input += 4)
+		{
+			const auto a = sextet(input[0]);
+			const auto b = sextet(input[1]);
+			const auto c = sextet(input[2]);
+			const auto d = sextet(input[3]);
+
+			// Invalid characters have bits set above the lower six
+			if ((a | b | c | d) > 0x3f)
+			{
+				return std::nullopt;
+			}
+
+			const auto value = (a << 18) | (b << 12) | (c << 6) | d;
+
+			*next++ = static_cast<char>(value >> 16);
+			*next++ = static_cast<char>(value >> 8);
+			*next++ = static_cast<char>(value);
+		}
+
+		// Decode the remaining two or three characters
+		if (const auto remaining = end - input; remaining > 0)
+		{
+			const auto a = sextet(input[0]);
+			const auto b = sextet(input[1]);
+			const auto c = remaining == 3 ? sextet(input[2]) : 0;
+
+			if ((a | b | c) > 0x3f)
+			{
+				return std::nullopt;
+			}
+
+			const auto value = (a << 18) | (b << 12) | (c << 6);
+
+			*next++ = static_cast<char>(value >> 16);
+			if (remaining == 3)
+			{
+				*next++ = static_cast<char>(value >> 8);
+			}
+		}
+
+		return static_cast<std::size_t>(next - output);
+	}
+
+	//  Signature of the decoding functions
+	using DecodeFunction = auto (*)(std::string_view encoded, char *output) noexcept -> std::optional<std::size_t>;
+
+#ifdef XENTARA_WEB_SERVICE_BASE64_SIMD
+
+	//  Translates 16 characters to their 6 bit values, and packs them into 12 bytes at the start of the result.
+	// This uses range comparisons instead of a table lookup: the base64url alphabet consists of three ranges and two
+	// single characters, each of which maps to its value by adding a constant offset.
+	//  valid receives false if any of the characters is not part of the alphabet
+	XENTARA_WEB_SERVICE_TARGET("sse4.1")
+	inline auto translateAndPack(__m128i characters, bool &valid) noexcept -> __m128i
+	{
+		// Characters outside of ASCII are negative, and fail all the range checks
+		const auto upper = _mm_and_si128(
+			_mm_cmpgt_epi8(characters, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(characters, _mm_set1_epi8('Z' + 1)));
+		const auto lower = _mm_and_si128(
+			_mm_cmpgt_epi8(characters, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(characters, _mm_set1_epi8('z' + 1)));
+		const auto digit = _mm_and_si128(
+			_mm_cmpgt_epi8(characters, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(characters, _mm_set1_epi8('9' + 1)));
+		const auto minus = _mm_cmpeq_epi8(characters, _mm_set1_epi8('-'));
+		const auto underscore = _mm_cmpeq_epi8(characters, _mm_set1_epi8('_'));
+
+		// Check that every character is in one of the ranges
+		const auto inAlphabet =
+			_mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, minus)), underscore);
+		valid = _mm_movemask_epi8(inAlphabet) == 0xffff;
+
+		// Add the offset for the range to get the 6 bit values
+		const auto offsets = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+											  _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+			_mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+							 _mm_and_si128(minus, _mm_set1_epi8(62 - '-'))),
+				_mm_and_si128(underscore, _mm_set1_epi8(63 - '_'))));
+		const auto values = _mm_add_epi8(characters, offsets);
+
+		// Merge pairs of 6 bit values into 12 bits, and then pairs of those into 24 bits per 32 bit lane
+		const auto pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+		const auto triplets = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+		// Move the three bytes of each lane to the front in big endian order
+		return _mm_shuffle_epi8(triplets, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	}
+
+	//  Decodes 16 characters at a time using SSE4.1
+	XENTARA_WEB_SERVICE_TARGET("sse4.1")
+	auto decodeSse41(std::string_view encoded, char *output) noexcept -> std::optional<std::size_t>
+	{
+		auto input = encoded.data();
+		const auto end = input + encoded.size();
+		auto next = output;
+
+		for (; end - input >= 16; input += 16, next += 12)
+		{
+			bool valid = false;
+			const auto packed =
+				translateAndPack(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input)), valid);
+			if (!valid)
+			{
+				return std::nullopt;
+			}
+
+			// Only 12 of the 16 bytes are data, and the output buffer may not have room for the rest
+			alignas(16) char bytes[16];
+			_mm_store_si128(reinterpret_cast<__m128i *>(bytes), packed);
+			std::memcpy(next, bytes, 12);
+		}
+
+		// Decode the rest one group at a time
+		const auto rest = decodeScalar(std::string_view(input, static_cast<std::size_t>(end - input)), next);
+		if (!rest)
+		{
+			return std::nullopt;
+		}
+
+		return static_cast<std::size_t>(next - output) + *rest;
+	}
+
+	//  Decodes 32 characters at a time using AVX2
+	XENTARA_WEB_SERVICE_TARGET("avx2")
+	auto decodeAvx2(std::string_view encoded, char *output) noexcept -> std::optional<std::size_t>
+	{
+		auto input = encoded.data();
+		const auto end = input + encoded.size();
+		auto next = output;
+
+		for (; end - input >= 32; input += 32, next += 24)
+		{
+			const auto characters = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+
+			// Range checks, as in translateAndPack()
+			const auto upper = _mm256_and_si256(_mm256_cmpgt_epi8(characters, _mm256_set1_epi8('A' - 1)),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), characters));
+			const auto lower = _mm256_and_si256(_mm256_cmpgt_epi8(characters, _mm256_set1_epi8('a' - 1)),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), characters));
+			const auto digit = _mm256_and_si256(_mm256_cmpgt_epi8(characters, _mm256_set1_epi8('0' - 1)),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), characters));
+			const auto minus = _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('-'));
+			const auto underscore = _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('_'));
+
+			const auto inAlphabet = _mm256_or_si256(
+				_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, minus)), underscore);
+			if (_mm256_movemask_epi8(inAlphabet) != -1)
+			{
+				return std::nullopt;
+			}
+
+			const auto offsets = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+													 _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+				_mm256_or_si256(_mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+									_mm256_and_si256(minus, _mm256_set1_epi8(62 - '-'))),
+					_mm256_and_si256(underscore, _mm256_set1_epi8(63 - '_'))));
+			const auto values = _mm256_add_epi8(characters, offsets);
+
+			const auto pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+			const auto triplets = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+
+			// Pack each 128 bit lane into its first 12 bytes, then move the two lanes together
+			const auto lanes = _mm256_shuffle_epi8(triplets,
+				_mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+					13, 12, -1, -1, -1, -1));
+			const auto packed = _mm256_permutevar8x32_epi32(lanes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+			// Only 24 of the 32 bytes are data, and the output buffer may not have room for the rest
+			alignas(32) char bytes[32];
+			_mm256_store_si256(reinterpret_cast<__m256i *>(bytes), packed);
+			std::memcpy(next, bytes, 24);
+		}
+
+		// Decode the rest using SSE4.1
+		const auto rest = decodeSse41(std::string_view(input, static_cast<std::size_t>(end - input)), next);
+		if (!rest)
+		{
+			return std::nullopt;
+		}
+
+		return static_cast<std::size_t>(next - output) + *rest;
+	}
+
+	//  The instruction set extensions supported by the CPU
+	struct CpuFeatures
+	{
+		//  Whether SSE4.1 is supported
+		bool _sse41 { false };
+
+		//  Whether AVX2 is supported
+		bool _avx2 { false };
+	};
+
+	//  Detects the instruction set extensions supported by the CPU
+	auto detectCpuFeatures() noexcept -> CpuFeatures
+	{
+#	ifdef _MSC_VER
+		int registers[4] {};
+		__cpuid(registers, 0);
+		const auto maxLeaf = registers[0];
+
+		__cpuid(registers, 1);
+		const bool sse41 = (registers[2] & (1 << 19)) != 0;
+		const bool osxsave = (registers[2] & (1 << 27)) != 0;
+
+		bool avx2 = false;
+		if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+		{
+			__cpuidex(registers, 7, 0);
+			avx2 = (registers[1] & (1 << 5)) != 0;
+		}
+#	else
+		__builtin_cpu_init();
+		const bool sse41 = __builtin_cpu_supports("sse4.1");
+		const bool avx2 = __builtin_cpu_supports("avx2");
+#	endif
+
+		return { sse41, avx2 };
+	}
+
+	//  The instruction set extensions supported by the CPU, detected once at startup
+	const CpuFeatures kCpuFeatures = detectCpuFeatures();
+
+#endif
+
+	//  Gets the function of an implementation
+	auto implementationFunction(Implementation implementation) noexcept -> DecodeFunction
+	{
+		switch (implementation)
+		{
+#ifdef XENTARA_WEB_SERVICE_BASE64_SIMD
+		case Implementation::Sse41:
+			return &decodeSse41;
+		case Implementation::Avx2:
+			return &decodeAvx2;
+#endif
+		default:
+			return &decodeScalar;
+		}
+	}
+
+	//  Selects the fastest implementation the CPU supports
+	auto selectImplementation() noexcept -> DecodeFunction
+	{
+		if (isSupported(Implementation::Avx2))
+		{
+			return implementationFunction(Implementation::Avx2);
+		}
+		if (isSupported(Implementation::Sse41))
+		{
+			return implementationFunction(Implementation::Sse41);
+		}
+		return &decodeScalar;
+	}
+
+	//  The implementation used for decoding, selected once at startup
+	const DecodeFunction kDecode = selectImplementation();
+
+	//  Strips the padding and checks the length of the data before decoding it
+	auto decodeWith(std::string_view encoded, char *output, DecodeFunction function) noexcept
+		-> std::optional<std::size_t>
+	{
+		// Strip the padding
+		while (!encoded.empty() && encoded.back() == '=')
+		{
+			encoded.remove_suffix(1);
+		}
+
+		// A single character in the last group can never be valid
+		if (encoded.size() % 4 == 1)
+		{
+			return std::nullopt;
+		}
+
+		return function(encoded, output);
+	}
+} // namespace
+
+auto decode(std::string_view encoded, char *output) noexcept -> std::optional<std::size_t>
+{
+	return decodeWith(encoded, output, kDecode);
+}
+
+auto isSupported(Implementation implementation) noexcept -> bool
+{
+	switch (implementation)
+	{
+	case Implementation::Scalar:
+		return true;
+#ifdef XENTARA_WEB_SERVICE_BASE64_SIMD
+	case Implementation::Sse41:
+		return kCpuFeatures._sse41;
+	case Implementation::Avx2:
+		return kCpuFeatures._avx2;
+#endif
+	default:
+		return false;
+	}
+}
+
+auto decode(std::string_view encoded, char *output, Implementation implementation) noexcept
+	-> std::optional<std::size_t>
+{
+	return decodeWith(encoded, output, implementationFunction(implementation));
+}
+
+} // namespace xentara::samples::webService::base64Url
@@ -0,0 +1,47 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+//  Functions for decoding base64url encoded data, as used in JSON web tokens.
+// More information about base64url can be found here: https://www.rfc-editor.org/rfc/rfc4648#section-5
+namespace xentara::samples::webService::base64Url
+{
+
+//  Gets the maximum size of the decoded data
+//  encoded the encoded data
+constexpr auto decodedSize(std::string_view encoded) noexcept -> std::size_t
+{
+	return encoded.size() / 4 * 3 + (encoded.size() % 4 > 1 ? encoded.size() % 4 - 1 : 0);
+}
+
+//  Decodes base64url encoded data. Trailing padding characters ("=") are accepted, but not required.
+//  encoded the encoded data
+//  output the buffer to write the decoded data to. This must have room for at least decodedSize(encoded) bytes.
+//  @return the number of bytes written, or std::nullopt if the data is not valid base64url
+auto decode(std::string_view encoded, char *output) noexcept -> std::optional<std::size_t>;
+
+//  The implementations of the decoder. decode() uses the fastest one the CPU supports.
+enum class Implementation
+{
+	//  Decodes one group of four characters at a time
+	Scalar,
+
+	//  Decodes 16 characters at a time using SSE4.1
+	Sse41,
+
+	//  Decodes 32 characters at a time using AVX2
+	Avx2
+};
+
+//  Checks whether an implementation was compiled in and is supported by the CPU
+auto isSupported(Implementation implementation) noexcept -> bool;
+
+//  Decodes base64url encoded data using a specific implementation, for testing and benchmarking
+//  implementation the implementation to use. This must be supported by the CPU.
+auto decode(std::string_view encoded, char *output, Implementation implementation) noexcept
+	-> std::optional<std::size_t>;
+
+} // namespace xentara::samples::webService::base64Url
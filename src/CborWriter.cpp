@@ -0,0 +1,138 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "CborWriter.hpp"
+
+#include <bit>
+
+namespace xentara::samples::webService::cbor
+{
+
+namespace
+{
+	//  The major types used
+	enum class MajorType : std::uint8_t
+	{
+		UnsignedInteger = 0,
+		NegativeInteger = 1,
+		TextString = 3,
+		Map = 5,
+		Tag = 6,
+		Simple = 7
+	};
+
+	//  The additional information for an argument in the following 1, 2, 4, or 8 bytes
+	constexpr std::uint8_t kOneByte = 24;
+	constexpr std::uint8_t kTwoBytes = 25;
+	constexpr std::uint8_t kFourBytes = 26;
+	constexpr std::uint8_t kEightBytes = 27;
+
+	//  The simple values and the additional information for a double precision number
+	constexpr std::uint8_t kFalse = 20;
+	constexpr std::uint8_t kTrue = 21;
+	constexpr std::uint8_t kNull = 22;
+	constexpr std::uint8_t kDouble = 27;
+
+	//  The tag for epoch-based date/time
+	constexpr std::uint8_t kEpochTimeTag = 1;
+
+	//  Appends the initial byte of a data item
+	auto appendInitialByte(std::string &data, MajorType type, std::uint8_t additional) -> void
+	{
+		data.push_back(char((std::uint8_t(type) << 5) | additional));
+	}
+
+	//  Appends an unsigned integer in big endian byte order
+	template <class Value>
+	auto appendBigEndian(std::string &data, Value value) -> void
+	{
+		for (auto shift = int(sizeof(Value) * 8) - 8; shift >= 0; shift -= 8)
+		{
+			data.push_back(char((value >> shift) & 0xff));
+		}
+	}
+
+	//  Appends the head of a data item, using the shortest form for the argument
+	auto appendHead(std::string &data, MajorType type, std::uint64_t argument) -> void
+	{
+		if (argument < kOneByte)
+		{
+			appendInitialByte(data, type, std::uint8_t(argument));
+		}
+		else if (argument <= 0xff)
+		{
+			appendInitialByte(data, type, kOneByte);
+			appendBigEndian(data, std::uint8_t(argument));
+		}
+		else if (argument <= 0xffff)
+		{
+			appendInitialByte(data, type, kTwoBytes);
+			appendBigEndian(data, std::uint16_t(argument));
+		}
+		else if (argument <= 0xffff'ffff)
+		{
+			appendInitialByte(data, type, kFourBytes);
+			appendBigEndian(data, std::uint32_t(argument));
+		}
+		else
+		{
+			appendInitialByte(data, type, kEightBytes);
+			appendBigEndian(data, argument);
+		}
+	}
+} // namespace
+
+auto appendMapHeader(std::string &data, std::size_t size) -> void
+{
+	appendHead(data, MajorType::Map, size);
+}
+
+auto appendString(std::string &data, std::string_view value) -> void
+{
+	appendHead(data, MajorType::TextString, value.size());
+	data.append(value);
+}
+
+auto appendNumber(std::string &data, std::int64_t value) -> void
+{
+	// Negative numbers are encoded as -1 - n
+	if (value < 0)
+	{
+		appendInitialByte(data, MajorType::NegativeInteger, kEightBytes);
+		appendBigEndian(data, ~std::uint64_t(value));
+	}
+	else
+	{
+		appendInitialByte(data, MajorType::UnsignedInteger, kEightBytes);
+		appendBigEndian(data, std::uint64_t(value));
+	}
+}
+
+auto appendNumber(std::string &data, std::uint64_t value) -> void
+{
+	appendInitialByte(data, MajorType::UnsignedInteger, kEightBytes);
+	appendBigEndian(data, value);
+}
+
+auto appendNumber(std::string &data, double value) -> void
+{
+	appendInitialByte(data, MajorType::Simple, kDouble);
+	appendBigEndian(data, std::bit_cast<std::uint64_t>(value));
+}
+
+auto appendBoolean(std::string &data, bool value) -> void
+{
+	appendInitialByte(data, MajorType::Simple, value ? kTrue : kFalse);
+}
+
+auto appendTime(std::string &data, std::chrono::system_clock::time_point value) -> void
+{
+	appendInitialByte(data, MajorType::Tag, kEpochTimeTag);
+	appendNumber(data, std::chrono::duration<double>(value.time_since_epoch()).count());
+}
+
+auto appendNull(std::string &data) -> void
+{
+	appendInitialByte(data, MajorType::Simple, kNull);
+}
+
+} // namespace xentara::samples::webService::cbor
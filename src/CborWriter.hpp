@@ -0,0 +1,46 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  Functions for writing CBOR (RFC 8949) directly into a string. Like the functions in the json namespace, nothing but
+// the string itself is allocated.
+//
+// Numbers always use their 64 bit forms, so that their size does not depend on their value.
+namespace cbor
+{
+
+	//  Appends the head of a map with the given number of entries
+	auto appendMapHeader(std::string &data, std::size_t size) -> void;
+
+	//  Appends a UTF-8 text string
+	auto appendString(std::string &data, std::string_view value) -> void;
+
+	//  Appends an integer
+	auto appendNumber(std::string &data, std::int64_t value) -> void;
+
+	//  Appends an unsigned integer
+	auto appendNumber(std::string &data, std::uint64_t value) -> void;
+
+	//  Appends a double precision floating point number
+	auto appendNumber(std::string &data, double value) -> void;
+
+	//  Appends a boolean
+	auto appendBoolean(std::string &data, bool value) -> void;
+
+	//  Appends a point in time as an epoch-based date/time (tag 1) with a double precision number of seconds
+	auto appendTime(std::string &data, std::chrono::system_clock::time_point value) -> void;
+
+	//  Appends null
+	auto appendNull(std::string &data) -> void;
+
+} // namespace cbor
+
+} // namespace xentara::samples::webService
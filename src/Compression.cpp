@@ -0,0 +1,252 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/config/Errors.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "Compression.hpp"
+#include "Metrics.hpp"
+#include "QualityList.hpp"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  The size by which the output is grown while compressing
+	constexpr std::size_t kOutputChunkSize = 16 * 1024;
+
+	//  A zlib stream that is reused by a thread
+	struct ThreadStream
+	{
+		//  Destructor
+		~ThreadStream()
+		{
+			if (_initialized)
+			{
+				deflateEnd(&_stream);
+			}
+		}
+
+		//  The stream
+		z_stream _stream {};
+
+		//  Whether the stream was initialized
+		bool _initialized { false };
+
+		//  The compression level the stream uses
+		int _level { 0 };
+	};
+
+	//  Gets the stream of the calling thread for a content coding, ready to compress new data
+	auto threadStream(ContentCoding coding, int level) -> z_stream &
+	{
+		// gzip and deflate use different window bits, which cannot be changed after initialization
+		thread_local ThreadStream gzipStream;
+		thread_local ThreadStream deflateStream;
+		auto &stream = coding == ContentCoding::Gzip ? gzipStream : deflateStream;
+
+		if (!stream._initialized)
+		{
+			// Adding 16 to the window bits selects the gzip format
+			constexpr int kWindowBits = 15;
+			constexpr int kMemoryLevel = 8;
+			if (deflateInit2(&stream._stream, level, Z_DEFLATED,
+					coding == ContentCoding::Gzip ? kWindowBits + 16 : kWindowBits, kMemoryLevel,
+					Z_DEFAULT_STRATEGY) != Z_OK)
+			{
+				throw std::bad_alloc();
+			}
+			stream._initialized = true;
+			stream._level = level;
+		}
+		else
+		{
+			deflateReset(&stream._stream);
+			if (stream._level != level)
+			{
+				deflateParams(&stream._stream, level, Z_DEFAULT_STRATEGY);
+				stream._level = level;
+			}
+		}
+
+		return stream._stream;
+	}
+} // namespace
+
+auto Compression::loadConfig(utils::json::decoder::Object &jsonObject) -> void
+{
+	// Go through all parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"enabled")
+		{
+			_enabled = value.asBool();
+		}
+		else if (key == u8"level")
+		{
+			// The level must be one that zlib supports. Level 0 would only add overhead.
+			const auto level = value.asNumber<int>();
+			if (level < 1 || level > 9)
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error(
+						"invalid level for the compression of the Web Service Server: must be between 1 and 9"));
+			}
+			_level = level;
+		}
+		else if (key == u8"minimumSize")
+		{
+			_minimumSize = value.asNumber<std::size_t>();
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+}
+
+auto Compression::negotiate(std::string_view acceptEncoding) const -> ContentCoding
+{
+	if (!_enabled)
+	{
+		return ContentCoding::Identity;
+	}
+
+	// Find the quality of gzip and deflate. A wildcard applies to the codings that are not listed explicitly.
+	int gzipQuality = -1;
+	int deflateQuality = -1;
+	int wildcardQuality = -1;
+	QualityList list(acceptEncoding);
+	while (const auto element = list.next())
+	{
+		if (QualityList::equalsIgnoringCase(element->_value, "gzip"sv) ||
+			QualityList::equalsIgnoringCase(element->_value, "x-gzip"sv))
+		{
+			gzipQuality = element->_quality;
+		}
+		else if (QualityList::equalsIgnoringCase(element->_value, "deflate"sv))
+		{
+			deflateQuality = element->_quality;
+		}
+		else if (element->_value == "*"sv)
+		{
+			wildcardQuality = element->_quality;
+		}
+	}
+	if (gzipQuality < 0)
+	{
+		gzipQuality = wildcardQuality;
+	}
+	if (deflateQuality < 0)
+	{
+		deflateQuality = wildcardQuality;
+	}
+
+	if (gzipQuality > 0 && gzipQuality >= deflateQuality)
+	{
+		return ContentCoding::Gzip;
+	}
+	if (deflateQuality > 0)
+	{
+		return ContentCoding::Deflate;
+	}
+	return ContentCoding::Identity;
+}
+
+auto Compression::compress(ContentCoding coding, std::string_view body, std::string &output) const -> void
+{
+	Compressor compressor(coding, _level, output);
+	compressor.append(body);
+	compressor.finish();
+}
+
+auto Compression::record(std::size_t uncompressedSize, std::size_t compressedSize, bool cached) noexcept -> void
+{
+	_compressedResponses.fetch_add(1, std::memory_order_relaxed);
+	if (cached)
+	{
+		_cachedResponses.fetch_add(1, std::memory_order_relaxed);
+	}
+	_uncompressedBytes.fetch_add(uncompressedSize, std::memory_order_relaxed);
+	_compressedBytes.fetch_add(compressedSize, std::memory_order_relaxed);
+}
+
+auto Compression::formatMetrics(std::string &text) const -> void
+{
+	Metrics::formatCounter(text, "compressed_responses_total"sv, "Number of responses sent compressed."sv,
+		_compressedResponses.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "compressed_responses_cached_total"sv,
+		"Number of compressed responses whose body was compressed for an earlier request in the same cycle."sv,
+		_cachedResponses.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "compression_uncompressed_bytes_total"sv,
+		"Size of the bodies of compressed responses before compression."sv,
+		_uncompressedBytes.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "compression_compressed_bytes_total"sv,
+		"Size of the bodies of compressed responses as sent."sv, _compressedBytes.load(std::memory_order_relaxed));
+}
+
+auto Compression::headerValue(ContentCoding coding) noexcept -> std::string_view
+{
+	switch (coding)
+	{
+	case ContentCoding::Gzip:
+		return "gzip"sv;
+	case ContentCoding::Deflate:
+		return "deflate"sv;
+	case ContentCoding::Identity:
+	default:
+		return "identity"sv;
+	}
+}
+
+Compressor::Compressor(ContentCoding coding, int level, std::string &output) :
+	_stream(threadStream(coding, level)), _output(output)
+{
+}
+
+auto Compressor::append(std::string_view data) -> void
+{
+	_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+	_stream.avail_in = uInt(data.size());
+	run(Z_NO_FLUSH);
+}
+
+auto Compressor::finish() -> void
+{
+	_stream.next_in = nullptr;
+	_stream.avail_in = 0;
+	run(Z_FINISH);
+}
+
+auto Compressor::run(int flush) -> void
+{
+	while (true)
+	{
+		// Make room for more output
+		const auto used = _output.size();
+		_output.resize(used + kOutputChunkSize);
+		_stream.next_out = reinterpret_cast<Bytef *>(_output.data() + used);
+		_stream.avail_out = uInt(kOutputChunkSize);
+
+		const auto result = deflate(&_stream, flush);
+		_output.resize(_output.size() - _stream.avail_out);
+
+		// Without finishing, zlib is done once it has room left over. When finishing, it must reach the end.
+		if (flush == Z_FINISH ? result == Z_STREAM_END : _stream.avail_out != 0)
+		{
+			return;
+		}
+		if (result != Z_OK && result != Z_BUF_ERROR)
+		{
+			throw std::runtime_error("compressing a response failed");
+		}
+	}
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,203 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "Encoding.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <zlib.h>
+
+namespace xentara::samples::webService
+{
+
+//  The content codings responses can be compressed with
+enum class ContentCoding : std::uint8_t
+{
+	//  The response is not compressed
+	Identity,
+
+	//  The gzip format (RFC 1952)
+	Gzip,
+
+	//  The zlib format (RFC 1950), which HTTP calls "deflate"
+	Deflate
+};
+
+//  The number of content codings
+constexpr std::size_t kContentCodingCount = 3;
+
+//  Compresses responses for clients that accept it.
+//
+// Only responses whose body has a minimum size are compressed, because compressing small bodies costs more time than
+// it saves. Each worker thread keeps its own zlib streams and reuses them for all responses, so that compressing does
+// not need to allocate the large internal buffers of zlib every time.
+class Compression
+{
+public:
+	//  Loads the configuration from the JSON Object
+	//  jsonObject the object from the json file
+	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Selects the content coding for a response from the value of an Accept-Encoding header. gzip is preferred over
+	// deflate if the client accepts both equally.
+	//  acceptEncoding the value of the header, or an empty string if the request had none
+	//  @return the content coding, which is ContentCoding::Identity if compression is disabled
+	auto negotiate(std::string_view acceptEncoding) const -> ContentCoding;
+
+	//  Checks whether a body of the given size should be compressed
+	auto shouldCompress(std::size_t size) const noexcept -> bool
+	{
+		return _enabled && size >= _minimumSize;
+	}
+
+	//  Gets the compression level
+	auto level() const noexcept -> int
+	{
+		return _level;
+	}
+
+	//  Compresses a complete body
+	//  output the string to append the compressed data to
+	auto compress(ContentCoding coding, std::string_view body, std::string &output) const -> void;
+
+	//  Records a compressed response that was sent
+	//  uncompressedSize the size of the body before compression
+	//  compressedSize the size of the body that was sent
+	//  cached whether the compressed body was taken from a cache
+	auto record(std::size_t uncompressedSize, std::size_t compressedSize, bool cached) noexcept -> void;
+
+	//  Writes the compression counters in the Prometheus text format
+	//  text the string to append the counters to
+	auto formatMetrics(std::string &text) const -> void;
+
+	//  Gets the value of the Content-Encoding header for a content coding
+	static auto headerValue(ContentCoding coding) noexcept -> std::string_view;
+
+	//  The default compression level
+	static constexpr int kDefaultLevel = 6;
+
+	//  The default size a body needs to have to be compressed
+	static constexpr std::size_t kDefaultMinimumSize = 1024;
+
+private:
+	//  Whether responses are compressed at all
+	bool _enabled { true };
+
+	//  The zlib compression level, from 1 (fastest) to 9 (smallest)
+	int _level { kDefaultLevel };
+
+	//  The size a body needs to have to be compressed
+	std::size_t _minimumSize { kDefaultMinimumSize };
+
+	//  The number of compressed responses sent
+	std::atomic<std::uint64_t> _compressedResponses { 0 };
+
+	//  The number of compressed responses that were taken from a cache
+	std::atomic<std::uint64_t> _cachedResponses { 0 };
+
+	//  The size of the bodies of the compressed responses before compression
+	std::atomic<std::uint64_t> _uncompressedBytes { 0 };
+
+	//  The size of the bodies of the compressed responses after compression
+	std::atomic<std::uint64_t> _compressedBytes { 0 };
+};
+
+//  Compresses data piece by piece using the zlib stream of the calling thread. Only one compressor may be used by a
+// thread at the same time.
+class Compressor
+{
+public:
+	//  Constructor
+	//  coding the content coding, which must not be ContentCoding::Identity
+	//  level the compression level
+	//  output the string to append the compressed data to
+	Compressor(ContentCoding coding, int level, std::string &output);
+
+	//  Compresses more data
+	auto append(std::string_view data) -> void;
+
+	//  Writes the rest of the compressed data. No more data may be appended after this.
+	auto finish() -> void;
+
+private:
+	//  Runs the compression until all input was consumed, or until the end of the stream if finishing
+	auto run(int flush) -> void;
+
+	//  The zlib stream of the calling thread
+	z_stream &_stream;
+
+	//  The compressed data
+	std::string &_output;
+};
+
+//  Keeps the compressed body of a response that many clients ask for, like the values of a group, so that it is only
+// compressed once per cycle for all of them. There is a separate body for each encoding and content coding.
+class CompressedCache
+{
+public:
+	//  A compressed body
+	struct Body
+	{
+		//  The number of the cycle of the snapshot the body was made from
+		std::uint64_t _cycle { 0 };
+
+		//  The compressed data
+		std::string _data;
+	};
+
+	//  Gets the compressed body for a cycle. If no body was compressed for this cycle or a later one yet, the body is
+	// compressed by the calling thread while other threads that need it wait.
+	//  produce a function that appends the compressed body to the string passed to it
+	//  @return the body, which may be from a later cycle than requested
+	template <class Produce>
+	auto get(Encoding encoding, ContentCoding coding, std::uint64_t cycle, Produce &&produce)
+		-> std::shared_ptr<const Body>
+	{
+		auto &slot = _slots[std::size_t(encoding) * kContentCodingCount + std::size_t(coding)];
+
+		// Most requests find the body without taking the lock
+		if (auto body = slot._body.load(std::memory_order_acquire); body && body->_cycle >= cycle)
+		{
+			return body;
+		}
+
+		// Compress the body, unless another thread did so in the meantime
+		std::scoped_lock lock(slot._mutex);
+		if (auto body = slot._body.load(std::memory_order_acquire); body && body->_cycle >= cycle)
+		{
+			return body;
+		}
+		auto body = std::make_shared<Body>();
+		body->_cycle = cycle;
+		produce(body->_data);
+		slot._body.store(body, std::memory_order_release);
+
+		return body;
+	}
+
+private:
+	//  The body for one encoding and content coding
+	struct Slot
+	{
+		//  The latest body
+		std::atomic<std::shared_ptr<const Body>> _body;
+
+		//  Held while compressing a new body
+		std::mutex _mutex;
+	};
+
+	//  The slots for all combinations of encoding and content coding
+	std::array<Slot, kEncodingCount * kContentCodingCount> _slots;
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,164 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/config/Errors.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+#include <xentara/utils/string/cat.hpp>
+
+#include "ConnectionOptions.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace xentara::samples::webService
+{
+
+namespace
+{
+	//  Loads a count that must not be 0
+	auto loadCount(const auto &value, const char *name) -> std::uint32_t
+	{
+		const auto count = value.template asNumber<std::uint32_t>();
+		if (count == 0)
+		{
+			utils::json::decoder::throwWithLocation(value,
+				std::runtime_error(
+					utils::string::cat(name, " of the connections of the Web Service Server must not be 0")));
+		}
+		return count;
+	}
+
+	//  Formats an optional value for the description
+	template <class Value>
+	auto describe(const std::optional<Value> &value) -> std::string
+	{
+		if (!value)
+		{
+			return "default";
+		}
+		if constexpr (std::is_same_v<Value, bool>)
+		{
+			return *value ? "yes" : "no";
+		}
+		else
+		{
+			return std::to_string(*value);
+		}
+	}
+
+	//  Formats a flag for libhttp options that are numbers
+	auto flag(bool value) -> std::string
+	{
+		return value ? "1" : "0";
+	}
+} // namespace
+
+auto ConnectionOptions::loadConfig(utils::json::decoder::Object &jsonObject) -> void
+{
+	// Go through all parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"adaptive")
+		{
+			_adaptive = value.asBool();
+		}
+		else if (key == u8"workerThreads")
+		{
+			_workerThreads = loadCount(value, "workerThreads");
+		}
+		else if (key == u8"connectionQueue")
+		{
+			_connectionQueue = loadCount(value, "connectionQueue");
+		}
+		else if (key == u8"listenBacklog")
+		{
+			_listenBacklog = loadCount(value, "listenBacklog");
+		}
+		else if (key == u8"keepAlive")
+		{
+			_keepAlive = value.asBool();
+		}
+		else if (key == u8"requestTimeout")
+		{
+			_requestTimeout = loadCount(value, "requestTimeout");
+		}
+		else if (key == u8"tcpNoDelay")
+		{
+			_tcpNoDelay = value.asBool();
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+}
+
+auto ConnectionOptions::resolve() -> void
+{
+	// Choose the values that were not configured from the number of CPUs
+	if (_adaptive)
+	{
+		_cpuCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+		if (!_workerThreads)
+		{
+			_workerThreads = std::clamp(_cpuCount * kThreadsPerCpu, kMinWorkerThreads, kMaxWorkerThreads);
+		}
+		if (!_connectionQueue)
+		{
+			_connectionQueue = *_workerThreads * kQueuedConnectionsPerThread;
+		}
+	}
+
+	// Convert the configured values to libhttp options
+	_values.clear();
+	if (_workerThreads)
+	{
+		_values.emplace_back("num_threads", std::to_string(*_workerThreads));
+	}
+	if (_connectionQueue)
+	{
+		_values.emplace_back("connection_queue", std::to_string(*_connectionQueue));
+	}
+	if (_listenBacklog)
+	{
+		_values.emplace_back("listen_backlog", std::to_string(*_listenBacklog));
+	}
+	if (_keepAlive)
+	{
+		_values.emplace_back("enable_keep_alive", describe(_keepAlive));
+	}
+	if (_requestTimeout)
+	{
+		_values.emplace_back("request_timeout", std::to_string(*_requestTimeout));
+	}
+	if (_tcpNoDelay)
+	{
+		_values.emplace_back("tcp_nodelay", flag(*_tcpNoDelay));
+	}
+}
+
+auto ConnectionOptions::options() const -> std::vector<lh_opt_t>
+{
+	std::vector<lh_opt_t> options;
+	for (auto &&[name, value] : _values)
+	{
+		options.push_back({ name, value.c_str() });
+	}
+	return options;
+}
+
+auto ConnectionOptions::description() const -> std::string
+{
+	return utils::string::cat("worker threads: ", describe(_workerThreads),
+		_adaptive ? utils::string::cat(" (adaptive, ", _cpuCount, " CPUs)") : std::string(),
+		", connection queue: ", describe(_connectionQueue), ", listen backlog: ", describe(_listenBacklog),
+		", keep-alive: ", describe(_keepAlive), ", request timeout: ",
+		_requestTimeout ? utils::string::cat(*_requestTimeout, " ms") : describe(_requestTimeout), ", TCP no delay: ",
+		describe(_tcpNoDelay));
+}
+
+} // namespace xentara::samples::webService
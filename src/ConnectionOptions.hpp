@@ -0,0 +1,88 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libhttp.h>
+
+namespace xentara::samples::webService
+{
+
+//  The options for the worker threads and connections of libhttp. Options that are not configured are not passed to
+// libhttp, so that its defaults are used.
+//
+// In adaptive mode, the number of worker threads and the length of the connection queue are chosen from the number of
+// CPUs when the server starts, unless they are configured explicitly.
+class ConnectionOptions
+{
+public:
+	//  Loads the configuration from the JSON Object
+	//  jsonObject the object from the json file
+	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Chooses the values for the adaptive mode. This must be called before options().
+	auto resolve() -> void;
+
+	//  Gets the options to pass to libhttp, not including the terminating entry
+	//  @return the options. The strings are owned by this object.
+	auto options() const -> std::vector<lh_opt_t>;
+
+	//  Describes the chosen values, for the log
+	auto description() const -> std::string;
+
+	//  Gets the number of worker threads, or std::nullopt if the default of libhttp is used
+	auto workerThreads() const noexcept -> std::optional<std::uint32_t>
+	{
+		return _workerThreads;
+	}
+
+	//  The number of worker threads per CPU in adaptive mode. Worker threads spend part of their time waiting for the
+	// network, so there are more threads than CPUs.
+	static constexpr std::uint32_t kThreadsPerCpu = 2;
+
+	//  The minimum number of worker threads in adaptive mode
+	static constexpr std::uint32_t kMinWorkerThreads = 4;
+
+	//  The maximum number of worker threads in adaptive mode
+	static constexpr std::uint32_t kMaxWorkerThreads = 256;
+
+	//  The length of the connection queue per worker thread in adaptive mode
+	static constexpr std::uint32_t kQueuedConnectionsPerThread = 4;
+
+private:
+	//  Whether the adaptive mode is enabled
+	bool _adaptive { false };
+
+	//  The number of CPUs found in adaptive mode
+	std::uint32_t _cpuCount { 0 };
+
+	//  The number of worker threads
+	std::optional<std::uint32_t> _workerThreads;
+
+	//  The number of accepted connections that can wait for a worker thread
+	std::optional<std::uint32_t> _connectionQueue;
+
+	//  The length of the listen backlog of the socket
+	std::optional<std::uint32_t> _listenBacklog;
+
+	//  Whether connections are kept open between requests
+	std::optional<bool> _keepAlive;
+
+	//  The time to wait for a request, in milliseconds
+	std::optional<std::uint32_t> _requestTimeout;
+
+	//  Whether Nagle's algorithm is disabled
+	std::optional<bool> _tcpNoDelay;
+
+	//  The option values as strings, so that they stay valid while libhttp is started
+	std::vector<std::pair<const char *, std::string>> _values;
+};
+
+} // namespace xentara::samples::webService
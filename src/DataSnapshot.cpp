@@ -0,0 +1,446 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/config/Errors.hpp>
+#include <xentara/config/Resolver.hpp>
+#include <xentara/data/DataType.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+#include <xentara/utils/string/cat.hpp>
+
+#include "CborWriter.hpp"
+#include "DataSnapshot.hpp"
+#include "JsonWriter.hpp"
+#include "MessagePackWriter.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  Reads a value of a specific type and writes it in all encodings
+	template <class Value>
+	auto appendValue(const data::ReadHandle &handle,
+		std::string &fragment,
+		std::string &cborFragment,
+		std::string &messagePackFragment) -> void
+	{
+		// Values that cannot be read are written as null
+		const auto value = handle.read<Value>();
+		if (!value)
+		{
+			json::appendNull(fragment);
+			cbor::appendNull(cborFragment);
+			messagePack::appendNull(messagePackFragment);
+			return;
+		}
+
+		if constexpr (std::is_same_v<Value, bool>)
+		{
+			json::appendBoolean(fragment, *value);
+			cbor::appendBoolean(cborFragment, *value);
+			messagePack::appendBoolean(messagePackFragment, *value);
+		}
+		else if constexpr (std::is_same_v<Value, std::string>)
+		{
+			json::appendString(fragment, *value);
+			cbor::appendString(cborFragment, *value);
+			messagePack::appendString(messagePackFragment, *value);
+		}
+		else if constexpr (std::is_same_v<Value, std::chrono::system_clock::time_point>)
+		{
+			json::appendTime(fragment, *value);
+			cbor::appendTime(cborFragment, *value);
+			messagePack::appendTime(messagePackFragment, *value);
+		}
+		else
+		{
+			json::appendNumber(fragment, *value);
+			cbor::appendNumber(cborFragment, *value);
+			messagePack::appendNumber(messagePackFragment, *value);
+		}
+	}
+} // namespace
+
+auto DataSnapshot::loadConfig(utils::json::decoder::Array &jsonArray, config::Resolver &resolver) -> void
+{
+	// The indices are only needed for groups
+	std::vector<std::size_t> indices;
+	loadElements(jsonArray, resolver, indices);
+}
+
+auto DataSnapshot::loadGroups(utils::json::decoder::Object &jsonObject, config::Resolver &resolver) -> void
+{
+	// Go through all the groups
+	for (auto &&[key, value] : jsonObject)
+	{
+		// The group name may not be empty
+		const std::string name(key.begin(), key.end());
+		if (name.empty())
+		{
+			utils::json::decoder::throwWithLocation(
+				key, std::runtime_error("empty group name for webService Server"));
+		}
+
+		// Each group may only be defined once
+		auto [group, inserted] = _groups.try_emplace(name, Group { ._index = _groups.size() });
+		if (!inserted)
+		{
+			utils::json::decoder::throwWithLocation(
+				key, std::runtime_error(utils::string::cat("duplicate group \"", name, "\" for webService Server")));
+		}
+
+		// The group is an array of elements with their attributes
+		auto elements = value.asArray();
+		loadElements(elements, resolver, group->second._attributes);
+	}
+}
+
+auto DataSnapshot::loadElements(
+	utils::json::decoder::Array &jsonArray, config::Resolver &resolver, std::vector<std::size_t> &indices) -> void
+{
+	// Go through all the elements
+	for (auto &&element : jsonArray)
+	{
+		// Each element is an object
+		auto elementObject = element.asObject();
+
+		// Load the element
+		loadElement(elementObject, resolver, indices);
+	}
+}
+
+auto DataSnapshot::loadElement(
+	utils::json::decoder::Object &jsonObject, config::Resolver &resolver, std::vector<std::size_t> &indices) -> void
+{
+	// The binding is filled in below, but only used by the resolver once all the configuration was loaded
+	auto &binding = _bindings.emplace_back();
+
+	std::u8string elementName;
+	std::vector<std::u8string> attributeNames;
+	bool writable = false;
+
+	// Go through all the parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"element")
+		{
+			// The element is a string
+			elementName = value.asString<std::u8string>();
+
+			// Find the attributes once the element was resolved
+			resolver.submit<model::Element>(value, [this, &binding](std::reference_wrapper<model::Element> element) {
+				resolve(element.get(), binding);
+			});
+		}
+		else if (key == u8"attributes")
+		{
+			// Go through all the attributes
+			for (auto &&attribute : value.asArray())
+			{
+				// The attribute is a string
+				auto attributeName = attribute.asString<std::u8string>();
+
+				// Attribute names only consist of ASCII characters
+				if (attributeName.empty() ||
+					std::ranges::any_of(attributeName, [](char8_t character) { return character >= 0x80; }))
+				{
+					utils::json::decoder::throwWithLocation(
+						attribute, std::runtime_error("invalid attribute name for data of webService Server"));
+				}
+
+				attributeNames.push_back(std::move(attributeName));
+			}
+		}
+		else if (key == u8"writable")
+		{
+			// Whether the attributes may be written is a boolean
+			writable = value.asBool();
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+
+	// Check element defined
+	if (elementName.empty())
+	{
+		utils::json::decoder::throwWithLocation(
+			jsonObject, std::runtime_error("missing element for data of webService Server"));
+	}
+
+	// Check attributes defined
+	if (attributeNames.empty())
+	{
+		utils::json::decoder::throwWithLocation(
+			jsonObject, std::runtime_error("missing attributes for data of webService Server"));
+	}
+
+	// Add an entry for each attribute
+	for (auto &&attributeName : attributeNames)
+	{
+		std::string path(elementName.begin(), elementName.end());
+		path.push_back('/');
+		path.append(attributeName.begin(), attributeName.end());
+
+		// Attributes that are listed more than once, for example in several groups, share the same entry
+		const auto [existing, inserted] = _index.try_emplace(path, _entries.size());
+		const auto index = existing->second;
+		indices.push_back(index);
+		if (inserted)
+		{
+			// Prepare the member name for batch responses
+			std::string memberName;
+			json::appendString(memberName, path);
+			memberName.push_back(':');
+			std::string cborKey;
+			cbor::appendString(cborKey, path);
+			std::string messagePackKey;
+			messagePack::appendString(messagePackKey, path);
+
+			_entries.push_back(Entry { ._path = std::move(path),
+				._memberName = std::move(memberName),
+				._cborKey = std::move(cborKey),
+				._messagePackKey = std::move(messagePackKey) });
+		}
+
+		// The attribute is writable if it is listed as writable anywhere. The attribute is resolved again for each
+		// listing, but only after all the configuration was loaded, so that each resolution knows if it is writable.
+		_entries[index]._writable |= writable;
+		binding._attributes.emplace_back(std::u16string(attributeName.begin(), attributeName.end()), index);
+	}
+}
+
+auto DataSnapshot::resolve(model::Element &element, const Binding &binding) -> void
+{
+	for (auto &&[name, index] : binding._attributes)
+	{
+		// Find the attribute
+		const auto attribute = element.resolveAttribute(name);
+		if (!attribute)
+		{
+			throw std::runtime_error(
+				utils::string::cat("unknown attribute \"", _entries[index]._path, "\" in data of webService Server"));
+		}
+
+		// Remember how to read it
+		auto &entry = _entries[index];
+		entry._handle = element.attributeReadHandle(*attribute);
+		entry._type = valueType(attribute->dataType());
+		if (entry._writable)
+		{
+			entry._writeHandle = element.attributeWriteHandle(*attribute);
+		}
+	}
+}
+
+auto DataSnapshot::find(std::string_view path) const -> std::optional<std::size_t>
+{
+	if (auto found = _index.find(path); found != _index.end())
+	{
+		return found->second;
+	}
+
+	return std::nullopt;
+}
+
+auto DataSnapshot::group(std::string_view name) const -> const Group *
+{
+	if (auto found = _groups.find(name); found != _groups.end())
+	{
+		return &found->second;
+	}
+
+	return nullptr;
+}
+
+auto DataSnapshot::collect(std::chrono::system_clock::time_point time) -> void
+{
+	auto snapshot = freeSnapshot();
+	const auto cycle = ++_cycle;
+
+	// Only this task publishes snapshots, so the current snapshot is the previous one, and never the one being filled
+	// in
+	const auto previous = _current.load(std::memory_order_relaxed);
+
+	// Read all the values. The strings keep their capacity when a snapshot is reused.
+	snapshot->_fragments.resize(_entries.size());
+	snapshot->_cborFragments.resize(_entries.size());
+	snapshot->_messagePackFragments.resize(_entries.size());
+	snapshot->_changes.resize(_entries.size());
+	for (std::size_t index = 0; index < _entries.size(); ++index)
+	{
+		auto &fragment = snapshot->_fragments[index];
+		auto &cborFragment = snapshot->_cborFragments[index];
+		auto &messagePackFragment = snapshot->_messagePackFragments[index];
+		fragment.clear();
+		cborFragment.clear();
+		messagePackFragment.clear();
+		readValue(_entries[index], fragment, cborFragment, messagePackFragment);
+
+		// Remember when the value changed. The MessagePack form is compared, because it is the shortest, and keeps
+		// every detail of the value.
+		if (previous && previous->_messagePackFragments[index] == messagePackFragment)
+		{
+			snapshot->_changes[index] = previous->_changes[index];
+		}
+		else
+		{
+			snapshot->_changes[index] = cycle;
+		}
+	}
+
+	// A group changes whenever any of its values changes
+	snapshot->_groupChanges.resize(_groups.size());
+	for (auto &&[name, group] : _groups)
+	{
+		std::uint64_t changed = 0;
+		for (auto index : group._attributes)
+		{
+			changed = std::max(changed, snapshot->_changes[index]);
+		}
+		snapshot->_groupChanges[group._index] = changed;
+	}
+
+	snapshot->_time = time;
+	snapshot->_cycle = cycle;
+
+	// Publish the snapshot
+	_current.store(std::move(snapshot), std::memory_order_release);
+
+	// Wake up any waiting threads. Both this and the waiting threads use sequentially consistent operations on
+	// _publishedCycle and _waiters, so either this sees the waiter, or the waiter sees the new cycle.
+	_publishedCycle.store(cycle);
+	if (_waiters.load() != 0)
+	{
+		// Make sure waiters that already checked the cycle are waiting on the condition variable
+		{
+			std::scoped_lock lock(_waitMutex);
+		}
+		_updated.notify_all();
+	}
+}
+
+auto DataSnapshot::waitForSnapshot(std::uint64_t cycle, std::chrono::steady_clock::time_point deadline)
+	-> std::shared_ptr<const Snapshot>
+{
+	std::unique_lock lock(_waitMutex);
+	_waiters.fetch_add(1);
+	const auto updated =
+		_updated.wait_until(lock, deadline, [&] { return stopped() || _publishedCycle.load() > cycle; });
+	_waiters.fetch_sub(1);
+
+	if (!updated || stopped())
+	{
+		return nullptr;
+	}
+
+	return current();
+}
+
+auto DataSnapshot::sleepUntil(std::chrono::steady_clock::time_point deadline) -> bool
+{
+	std::unique_lock lock(_waitMutex);
+	return !_updated.wait_until(lock, deadline, [&] { return stopped(); });
+}
+
+auto DataSnapshot::stop() -> void
+{
+	{
+		std::scoped_lock lock(_waitMutex);
+		_stopped = true;
+	}
+	_updated.notify_all();
+}
+
+auto DataSnapshot::freeSnapshot() -> std::shared_ptr<Snapshot>
+{
+	// A snapshot is free if it is neither the current one nor used by any worker thread. Worker threads can only get
+	// the current snapshot, so a snapshot that is free stays free.
+	for (auto &&snapshot : _snapshots)
+	{
+		if (snapshot.use_count() == 1)
+		{
+			// Make sure the worker thread that released the snapshot is done reading it
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return snapshot;
+		}
+	}
+
+	// Create a new snapshot, and keep it for reuse unless there are already enough
+	auto snapshot = std::make_shared<Snapshot>();
+	if (_snapshots.size() < kMaxReusedSnapshots)
+	{
+		_snapshots.push_back(snapshot);
+	}
+
+	return snapshot;
+}
+
+auto DataSnapshot::valueType(const data::DataType &dataType) -> ValueType
+{
+	if (dataType == data::DataType::kBoolean)
+	{
+		return ValueType::Boolean;
+	}
+	if (dataType == data::DataType::kInteger)
+	{
+		return ValueType::Integer;
+	}
+	if (dataType == data::DataType::kUnsignedInteger)
+	{
+		return ValueType::UnsignedInteger;
+	}
+	if (dataType == data::DataType::kFloatingPoint)
+	{
+		return ValueType::FloatingPoint;
+	}
+	if (dataType == data::DataType::kString)
+	{
+		return ValueType::String;
+	}
+	if (dataType == data::DataType::kTimeStamp)
+	{
+		return ValueType::TimeStamp;
+	}
+
+	return ValueType::Unsupported;
+}
+
+auto DataSnapshot::readValue(
+	const Entry &entry, std::string &fragment, std::string &cborFragment, std::string &messagePackFragment) -> void
+{
+	switch (entry._type)
+	{
+	case ValueType::Boolean:
+		appendValue<bool>(entry._handle, fragment, cborFragment, messagePackFragment);
+		break;
+	case ValueType::Integer:
+		appendValue<std::int64_t>(entry._handle, fragment, cborFragment, messagePackFragment);
+		break;
+	case ValueType::UnsignedInteger:
+		appendValue<std::uint64_t>(entry._handle, fragment, cborFragment, messagePackFragment);
+		break;
+	case ValueType::FloatingPoint:
+		appendValue<double>(entry._handle, fragment, cborFragment, messagePackFragment);
+		break;
+	case ValueType::String:
+		appendValue<std::string>(entry._handle, fragment, cborFragment, messagePackFragment);
+		break;
+	case ValueType::TimeStamp:
+		appendValue<std::chrono::system_clock::time_point>(entry._handle, fragment, cborFragment, messagePackFragment);
+		break;
+	case ValueType::Unsupported:
+		json::appendNull(fragment);
+		cbor::appendNull(cborFragment);
+		messagePack::appendNull(messagePackFragment);
+		break;
+	}
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,314 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/config/Resolver.hpp>
+#include <xentara/data/ReadHandle.hpp>
+#include <xentara/data/WriteHandle.hpp>
+#include <xentara/model/Attribute.hpp>
+#include <xentara/model/Element.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "Encoding.hpp"
+#include "StringHash.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xentara::samples::webService
+{
+
+//  A snapshot of the attributes served by the server, which is taken once per Xentara cycle.
+//
+// The values are read from the data model by a Xentara task, and are stored as ready-made JSON text, CBOR and
+// MessagePack, so that the worker threads of the server never access the data model and never need to format values.
+// The snapshots are published atomically. Snapshots are reused once no worker thread is using them any more, so that
+// taking a snapshot does not need to allocate memory once the server is running.
+//
+// Threads that want to be told about new snapshots can wait for them. Waking them costs the Xentara task a lock and a
+// notification, but only if any thread is actually waiting.
+class DataSnapshot
+{
+public:
+	//  The types of values that can be converted to JSON
+	enum class ValueType : std::uint8_t
+	{
+		Boolean,
+		Integer,
+		UnsignedInteger,
+		FloatingPoint,
+		String,
+		TimeStamp,
+
+		//  Values of other types are served as null
+		Unsupported
+	};
+
+	//  The values of all attributes at the end of a cycle
+	struct Snapshot
+	{
+		//  The JSON text of the value of each attribute, in the order of the attributes
+		std::vector<std::string> _fragments;
+
+		//  The CBOR data item of the value of each attribute
+		std::vector<std::string> _cborFragments;
+
+		//  The MessagePack object of the value of each attribute
+		std::vector<std::string> _messagePackFragments;
+
+		//  The number of the cycle in which the value of each attribute last changed. This serves as the version of
+		// the value.
+		std::vector<std::uint64_t> _changes;
+
+		//  The number of the cycle in which any value of each group last changed, indexed by the index of the group
+		std::vector<std::uint64_t> _groupChanges;
+
+		//  The time of the cycle in which the values were read
+		std::chrono::system_clock::time_point _time;
+
+		//  The number of the cycle in which the values were read, starting at 1
+		std::uint64_t _cycle { 0 };
+
+		//  Gets the values of all attributes in a specific encoding
+		auto fragments(Encoding encoding) const noexcept -> const std::vector<std::string> &
+		{
+			switch (encoding)
+			{
+			case Encoding::Cbor:
+				return _cborFragments;
+			case Encoding::MessagePack:
+				return _messagePackFragments;
+			case Encoding::Json:
+			default:
+				return _fragments;
+			}
+		}
+	};
+
+	//  A named group of attributes
+	struct Group
+	{
+		//  The index of the group, from 0 to the number of groups
+		std::size_t _index;
+
+		//  The indices of the attributes in the group
+		std::vector<std::size_t> _attributes;
+	};
+
+	//  Loads the configuration from the JSON Array
+	//  jsonArray the array from the json file. Each entry is an object with the element and the names of its
+	// attributes.
+	//  resolver the resolver used to find the elements
+	auto loadConfig(utils::json::decoder::Array &jsonArray, config::Resolver &resolver) -> void;
+
+	//  Loads the named groups of attributes from the JSON object. Each member of the object is a group whose value has
+	// the same form as the array passed to loadConfig(). The attributes of the groups are served as well.
+	//  jsonObject the object from the json file
+	//  resolver the resolver used to find the elements
+	auto loadGroups(utils::json::decoder::Object &jsonObject, config::Resolver &resolver) -> void;
+
+	//  Gets the number of attributes
+	auto size() const noexcept -> std::size_t
+	{
+		return _entries.size();
+	}
+
+	//  Finds an attribute by its path, which has the form "element/attribute"
+	//  @return the index of the attribute, or std::nullopt if there is no such attribute
+	auto find(std::string_view path) const -> std::optional<std::size_t>;
+
+	//  Finds a group by its name
+	//  @return the group, or nullptr if there is no such group
+	auto group(std::string_view name) const -> const Group *;
+
+	//  Gets the number of groups
+	auto groupCount() const noexcept -> std::size_t
+	{
+		return _groups.size();
+	}
+
+	//  Gets the path of an attribute
+	auto path(std::size_t index) const noexcept -> std::string_view
+	{
+		return _entries[index]._path;
+	}
+
+	//  Gets the type of an attribute
+	auto valueType(std::size_t index) const noexcept -> ValueType
+	{
+		return _entries[index]._type;
+	}
+
+	//  Checks whether an attribute may be written
+	auto writable(std::size_t index) const noexcept -> bool
+	{
+		return _entries[index]._writable;
+	}
+
+	//  Gets the handle used to write an attribute. This must only be used for attributes that are writable.
+	auto writeHandle(std::size_t index) const noexcept -> const data::WriteHandle &
+	{
+		return _entries[index]._writeHandle;
+	}
+
+	//  Gets the path of an attribute as a key in a map. For JSON, this is a string followed by a colon, for use as a
+	// member name in a JSON object. For the binary encodings, it is just the string.
+	auto memberName(std::size_t index, Encoding encoding = Encoding::Json) const noexcept -> std::string_view
+	{
+		switch (encoding)
+		{
+		case Encoding::Cbor:
+			return _entries[index]._cborKey;
+		case Encoding::MessagePack:
+			return _entries[index]._messagePackKey;
+		case Encoding::Json:
+		default:
+			return _entries[index]._memberName;
+		}
+	}
+
+	//  Reads all attributes and publishes a new snapshot. This must only be called by the Xentara task.
+	//  time the time of the cycle
+	auto collect(std::chrono::system_clock::time_point time) -> void;
+
+	//  Gets the current snapshot
+	//  @return the snapshot, or nullptr if no snapshot was taken yet
+	auto current() const noexcept -> std::shared_ptr<const Snapshot>
+	{
+		return _current.load(std::memory_order_acquire);
+	}
+
+	//  Waits for a snapshot that was taken after a specific cycle
+	//  cycle the number of the last cycle the caller knows about
+	//  deadline the time to stop waiting
+	//  @return the new snapshot, or nullptr if the deadline passed or stop() was called
+	auto waitForSnapshot(std::uint64_t cycle, std::chrono::steady_clock::time_point deadline)
+		-> std::shared_ptr<const Snapshot>;
+
+	//  Waits until a specific time, or until stop() is called
+	//  @return false if stop() was called
+	auto sleepUntil(std::chrono::steady_clock::time_point deadline) -> bool;
+
+	//  Wakes up all waiting threads, and makes all future waits return immediately
+	auto stop() -> void;
+
+	//  Checks whether stop() was called
+	auto stopped() const noexcept -> bool
+	{
+		return _stopped.load(std::memory_order_relaxed);
+	}
+
+private:
+	//  An attribute that is served
+	struct Entry
+	{
+		//  The path of the attribute
+		std::string _path;
+
+		//  The path as a JSON member name, including the quotes and the colon
+		std::string _memberName;
+
+		//  The path as a CBOR text string
+		std::string _cborKey;
+
+		//  The path as a MessagePack string
+		std::string _messagePackKey;
+
+		//  The handle used to read the attribute
+		data::ReadHandle _handle;
+
+		//  The type of the attribute
+		ValueType _type { ValueType::Unsupported };
+
+		//  Whether the attribute may be written
+		bool _writable { false };
+
+		//  The handle used to write the attribute, if it is writable
+		data::WriteHandle _writeHandle;
+	};
+
+	//  The attributes of an element that still need to be resolved
+	struct Binding
+	{
+		//  The names of the attributes, together with the index of their entry
+		std::vector<std::pair<std::u16string, std::size_t>> _attributes;
+	};
+
+	//  Loads an array of elements with their attributes
+	//  indices receives the indices of the attributes
+	auto loadElements(utils::json::decoder::Array &jsonArray,
+		config::Resolver &resolver,
+		std::vector<std::size_t> &indices) -> void;
+
+	//  Loads a single element with its attributes
+	//  indices receives the indices of the attributes
+	auto loadElement(utils::json::decoder::Object &jsonObject,
+		config::Resolver &resolver,
+		std::vector<std::size_t> &indices) -> void;
+
+	//  Finds the attributes of a resolved element
+	auto resolve(model::Element &element, const Binding &binding) -> void;
+
+	//  Gets a snapshot that can be filled in, reusing one that is no longer used if possible
+	auto freeSnapshot() -> std::shared_ptr<Snapshot>;
+
+	//  Gets the type of value for a data type
+	static auto valueType(const data::DataType &dataType) -> ValueType;
+
+	//  Reads an attribute and writes its value in all encodings
+	static auto readValue(
+		const Entry &entry, std::string &fragment, std::string &cborFragment, std::string &messagePackFragment) -> void;
+
+	//  The attributes
+	std::vector<Entry> _entries;
+
+	//  The index of each attribute by its path
+	StringMap<std::size_t> _index;
+
+	//  The groups by their names
+	StringMap<Group> _groups;
+
+	//  The attributes waiting for their element to be resolved. A list is used so that the bindings do not move
+	// while the resolver holds pointers to them.
+	std::list<Binding> _bindings;
+
+	//  The current snapshot
+	std::atomic<std::shared_ptr<const Snapshot>> _current;
+
+	//  All snapshots that were created. These are only used by the Xentara task.
+	std::vector<std::shared_ptr<Snapshot>> _snapshots;
+
+	//  The number of the last cycle
+	std::uint64_t _cycle { 0 };
+
+	//  The number of the cycle of the current snapshot, for threads waiting for a new snapshot
+	std::atomic<std::uint64_t> _publishedCycle { 0 };
+
+	//  The number of threads waiting for a new snapshot
+	std::atomic<std::uint32_t> _waiters { 0 };
+
+	//  Whether stop() was called
+	std::atomic<bool> _stopped { false };
+
+	//  Protects waiting for new snapshots
+	std::mutex _waitMutex;
+
+	//  Signalled when a new snapshot was published or stop() was called
+	std::condition_variable _updated;
+
+	//  The maximum number of snapshots to keep for reuse. More snapshots are only needed if worker threads hold on to
+	// old snapshots for several cycles.
+	static constexpr std::size_t kMaxReusedSnapshots = 4;
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,126 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "DecodedJwt.hpp"
+#include "Base64Url.hpp"
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+auto DecodedJwt::decode(std::string_view encodedToken, std::string &buffer) -> std::optional<DecodedJwt>
+{
+	auto token = decodeHeader(encodedToken, buffer);
+	if (!token || !token->decodeBody())
+	{
+		return std::nullopt;
+	}
+
+	return token;
+}
+
+auto DecodedJwt::decodeHeader(std::string_view encodedToken, std::string &buffer) -> std::optional<DecodedJwt>
+{
+	// Split the token into header, payload and signature
+	const auto headerEnd = encodedToken.find('.');
+	if (headerEnd == std::string_view::npos)
+	{
+		return std::nullopt;
+	}
+	const auto payloadEnd = encodedToken.find('.', headerEnd + 1);
+	if (payloadEnd == std::string_view::npos || encodedToken.find('.', payloadEnd + 1) != std::string_view::npos)
+	{
+		return std::nullopt;
+	}
+
+	const auto encodedHeader = encodedToken.substr(0, headerEnd);
+	const auto encodedPayload = encodedToken.substr(headerEnd + 1, payloadEnd - headerEnd - 1);
+	const auto encodedSignature = encodedToken.substr(payloadEnd + 1);
+
+	// Make room for all three parts in the buffer. The buffer must not be resized after this, because that would
+	// invalidate the views into it.
+	const auto headerCapacity = base64Url::decodedSize(encodedHeader);
+	buffer.resize(
+		headerCapacity + base64Url::decodedSize(encodedPayload) + base64Url::decodedSize(encodedSignature));
+	const auto header = buffer.data();
+
+	// Decode the header, which must be a JSON object
+	const auto headerSize = base64Url::decode(encodedHeader, header);
+	if (!headerSize)
+	{
+		return std::nullopt;
+	}
+	const auto headerJson = JsonView::parse(std::string_view(header, *headerSize));
+	if (!headerJson || !headerJson->isObject())
+	{
+		return std::nullopt;
+	}
+
+	DecodedJwt token(encodedToken.substr(0, payloadEnd), encodedSignature);
+	token._payloadBuffer = header + headerCapacity;
+
+	// Get the algorithm and key ID from the header
+	bool valid = true;
+	headerJson->forEachMember([&](const JsonView &key, const JsonView &value) {
+		const auto isAlgorithm = key.text() == "alg"sv;
+		if (!isAlgorithm && key.text() != "kid"sv)
+		{
+			return;
+		}
+
+		// The values must be strings
+		if (!value.isString())
+		{
+			valid = false;
+			return;
+		}
+
+		// Unescape the value in place. This only ever makes the string shorter, and the buffer is ours to modify.
+		const auto text = value.text();
+		const auto output = buffer.data() + (text.data() - buffer.data());
+		const auto size = JsonView::unescape(text, output);
+		if (!size)
+		{
+			valid = false;
+			return;
+		}
+
+		(isAlgorithm ? token._algorithm : token._keyId) = std::string_view(output, *size);
+	});
+
+	// The algorithm is mandatory
+	if (!valid || token._algorithm.empty())
+	{
+		return std::nullopt;
+	}
+
+	return token;
+}
+
+auto DecodedJwt::decodeBody() -> bool
+{
+	// The encoded payload is the part of the signing input after the header
+	const auto encodedPayload = _signingInput.substr(_signingInput.find('.') + 1);
+
+	// Decode the payload and signature into the space reserved for them
+	const auto payload = _payloadBuffer;
+	const auto signature = payload + base64Url::decodedSize(encodedPayload);
+	const auto payloadSize = base64Url::decode(encodedPayload, payload);
+	const auto signatureSize = base64Url::decode(_encodedSignature, signature);
+	if (!payloadSize || !signatureSize)
+	{
+		return false;
+	}
+
+	// The payload must be a JSON object
+	const auto payloadJson = JsonView::parse(std::string_view(payload, *payloadSize));
+	if (!payloadJson || !payloadJson->isObject())
+	{
+		return false;
+	}
+
+	_payload = payloadJson;
+	_signature = std::string_view(signature, *signatureSize);
+	return true;
+}
+
+} // namespace xentara::samples::webService
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "JsonView.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  A JSON web token that has been decoded without building a JSON document for the header and payload. Only the
+// algorithm and key ID are taken from the header. The payload is kept as a JsonView, so that the caller can pick out
+// the claims it is interested in.
+//
+// The decoded data is stored in a buffer provided by the caller, which must outlive the token.
+class DecodedJwt
+{
+public:
+	//  Decodes a token
+	//  encodedToken the encoded token
+	//  buffer the buffer to store the decoded data in. The buffer can be reused for the next token once this token
+	// is no longer needed, so that no memory needs to be allocated in the steady state.
+	//  @return the decoded token, or std::nullopt if the token is malformed
+	static auto decode(std::string_view encodedToken, std::string &buffer) -> std::optional<DecodedJwt>;
+
+	//  Decodes only the header of a token, so that tokens that cannot be verified anyway can be rejected before the
+	// payload is decoded. The payload and signature can be decoded afterwards using decodeBody().
+	//  encodedToken the encoded token, which must outlive the token
+	//  buffer the buffer to store the decoded data in, which must not be modified until decodeBody() was called
+	//  @return the token with only the algorithm and key ID set, or std::nullopt if the token is malformed
+	static auto decodeHeader(std::string_view encodedToken, std::string &buffer) -> std::optional<DecodedJwt>;
+
+	//  Decodes the payload and signature of a token whose header was decoded using decodeHeader()
+	//  @return false if the payload or signature are malformed
+	auto decodeBody() -> bool;
+
+	//  Gets the signature algorithm from the header
+	constexpr auto algorithm() const noexcept -> std::string_view
+	{
+		return _algorithm;
+	}
+
+	//  Gets the key ID from the header, or an empty string if the header has no key ID
+	constexpr auto keyId() const noexcept -> std::string_view
+	{
+		return _keyId;
+	}
+
+	//  Gets the payload, which is always a JSON object. This must only be called once the payload has been decoded.
+	constexpr auto payload() const noexcept -> const JsonView &
+	{
+		return *_payload;
+	}
+
+	//  Gets the part of the encoded token the signature was calculated over, which is the encoded header and payload
+	// separated by a dot
+	constexpr auto signingInput() const noexcept -> std::string_view
+	{
+		return _signingInput;
+	}
+
+	//  Gets the decoded signature
+	constexpr auto signature() const noexcept -> std::string_view
+	{
+		return _signature;
+	}
+
+private:
+	//  Constructor
+	DecodedJwt(std::string_view signingInput, std::string_view encodedSignature) noexcept :
+		_signingInput(signingInput), _encodedSignature(encodedSignature)
+	{
+	}
+
+	//  The signature algorithm
+	std::string_view _algorithm;
+
+	//  The key ID
+	std::string_view _keyId;
+
+	//  The encoded header and payload
+	std::string_view _signingInput;
+
+	//  The encoded signature
+	std::string_view _encodedSignature;
+
+	//  The part of the buffer reserved for the decoded payload, followed by the part reserved for the signature
+	char *_payloadBuffer { nullptr };
+
+	//  The decoded payload, once it has been decoded
+	std::optional<JsonView> _payload;
+
+	//  The decoded signature
+	std::string_view _signature;
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,115 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "Encoding.hpp"
+#include "QualityList.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  A media type, and the encoding it selects
+	struct MediaType
+	{
+		//  The media type or range
+		std::string_view _name;
+
+		//  The encoding
+		Encoding _encoding;
+
+		//  Whether the media type is a wildcard
+		bool _wildcard;
+	};
+
+	//  The media types that are understood. MessagePack has no registered media type, so the names in common use are
+	// all accepted.
+	constexpr MediaType kMediaTypes[] = {
+		{ "application/json"sv, Encoding::Json, false },
+		{ "application/cbor"sv, Encoding::Cbor, false },
+		{ "application/msgpack"sv, Encoding::MessagePack, false },
+		{ "application/x-msgpack"sv, Encoding::MessagePack, false },
+		{ "application/vnd.msgpack"sv, Encoding::MessagePack, false },
+		{ "*/*"sv, Encoding::Json, true },
+		{ "application/*"sv, Encoding::Json, true },
+	};
+} // namespace
+
+auto negotiateEncoding(std::string_view accept) -> std::optional<Encoding>
+{
+	// Clients that do not say what they accept get JSON
+	if (QualityList::trim(accept).empty())
+	{
+		return Encoding::Json;
+	}
+
+	std::optional<Encoding> best;
+	int bestQuality = 0;
+	bool bestIsWildcard = false;
+	unsigned refused = 0;
+	QualityList list(accept);
+	while (const auto element = list.next())
+	{
+		// Look up the media type
+		const auto mediaType = std::ranges::find_if(kMediaTypes, [&](const MediaType &candidate) {
+			return QualityList::equalsIgnoringCase(candidate._name, element->_value);
+		});
+		if (mediaType == std::end(kMediaTypes))
+		{
+			continue;
+		}
+
+		// A quality of 0 means the type is not acceptable, even if a wildcard matches it
+		if (element->_quality == 0)
+		{
+			if (!mediaType->_wildcard)
+			{
+				refused |= 1u << unsigned(mediaType->_encoding);
+			}
+			continue;
+		}
+
+		// Keep the best one
+		if (element->_quality > bestQuality ||
+			(element->_quality == bestQuality && bestIsWildcard && !mediaType->_wildcard))
+		{
+			best = mediaType->_encoding;
+			bestQuality = element->_quality;
+			bestIsWildcard = mediaType->_wildcard;
+		}
+	}
+
+	// A wildcard selects the first encoding that was not refused
+	if (best && bestIsWildcard)
+	{
+		best.reset();
+		for (std::size_t index = 0; index < kEncodingCount; ++index)
+		{
+			if ((refused & (1u << index)) == 0)
+			{
+				return Encoding(index);
+			}
+		}
+	}
+
+	return best;
+}
+
+auto contentType(Encoding encoding) noexcept -> std::string_view
+{
+	switch (encoding)
+	{
+	case Encoding::Cbor:
+		return "application/cbor"sv;
+	case Encoding::MessagePack:
+		return "application/msgpack"sv;
+	case Encoding::Json:
+	default:
+		return "application/json"sv;
+	}
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,38 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  The encodings attribute values can be served in
+enum class Encoding : std::uint8_t
+{
+	//  JSON text. This is used if the client does not ask for anything else.
+	Json,
+
+	//  CBOR as described in RFC 8949
+	Cbor,
+
+	//  MessagePack
+	MessagePack
+};
+
+//  The number of encodings
+constexpr std::size_t kEncodingCount = 3;
+
+//  Selects the encoding for a response from the value of an Accept header. The supported type with the highest quality
+// is used. If several have the same quality, a specific type is preferred over a wildcard, and otherwise the one listed
+// first. Wildcards select the first encoding that is not refused with a quality of 0, starting with JSON.
+//  accept the value of the Accept header, or an empty string if the request had none
+//  @return the encoding, or std::nullopt if the client accepts none of the encodings
+auto negotiateEncoding(std::string_view accept) -> std::optional<Encoding>;
+
+//  Gets the media type of an encoding, for use in the Content-Type header
+auto contentType(Encoding encoding) noexcept -> std::string_view;
+
+} // namespace xentara::samples::webService
@@ -48,7 +48,7 @@ private:
 	std::string _responseData;
 
 	//  Extra header fields
-	std::string_view _extraHeaderFiels;
+	std::string _extraHeaderFiels;
 };
 
 } // namespace xentara::samples::webService
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "HttpResponse.hpp"
+
+#include <charconv>
+#include <iterator>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+auto serializeResponse(std::string &response,
+	std::string_view responseCode,
+	std::string_view responseData,
+	std::string_view extraHeaderFiels,
+	std::string_view contentType) -> void
+{
+	// Make the data for responce
+	serializeHeader(response, responseCode, responseData.size(), extraHeaderFiels, contentType);
+	response.append(responseData);
+}
+
+auto serializeHeader(std::string &response,
+	std::string_view responseCode,
+	std::size_t contentLength,
+	std::string_view extraHeaderFiels,
+	std::string_view contentType) -> void
+{
+	// Format the content length
+	char contentLengthText[24];
+	const auto contentLengthEnd =
+		std::to_chars(std::begin(contentLengthText), std::end(contentLengthText), contentLength).ptr;
+
+	response.clear();
+	response.append("HTTP/1.1 "sv)
+		.append(responseCode)
+		.append("\r\n"sv)
+		.append(extraHeaderFiels)
+		.append("Content-Length: "sv)
+		.append(std::begin(contentLengthText), contentLengthEnd)
+		.append("\r\n"
+				"Content-Type: "sv)
+		.append(contentType)
+		.append("\r\n\r\n"sv);
+}
+
+auto dynamicResponse(std::string_view responseCode,
+	std::string_view responseData,
+	std::string_view extraHeaderFiels,
+	std::string_view contentType) -> std::string_view
+{
+	// Make the data for responce in a buffer that is reused by this thread
+	thread_local std::string response;
+	serializeResponse(response, responseCode, responseData, extraHeaderFiels, contentType);
+
+	return response;
+}
+
+} // namespace xentara::samples::webService
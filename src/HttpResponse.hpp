@@ -0,0 +1,35 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  Serializes a complete response, including the status line and headers
+//  response the string to store the response in. Any previous contents are replaced.
+auto serializeResponse(std::string &response,
+	std::string_view responseCode,
+	std::string_view responseData,
+	std::string_view extraHeaderFiels,
+	std::string_view contentType = "text/plain") -> void;
+
+//  Serializes the status line and headers of a response
+//  response the string to store the header in. Any previous contents are replaced.
+auto serializeHeader(std::string &response,
+	std::string_view responseCode,
+	std::size_t contentLength,
+	std::string_view extraHeaderFiels,
+	std::string_view contentType) -> void;
+
+//  Builds a response that is not prepared in advance. The response is built in a buffer that is reused for all
+// responses of the calling thread, so that no memory needs to be allocated in the steady state.
+//  @return the complete response, which is valid until the next call from the same thread
+auto dynamicResponse(std::string_view responseCode,
+	std::string_view responseData = {},
+	std::string_view extraHeaderFiels = {},
+	std::string_view contentType = "text/plain") -> std::string_view;
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,249 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/utils/string/cat.hpp>
+
+#include "HttpsClient.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+#ifdef _WIN32
+#	include <winsock2.h>
+#else
+#	include <sys/socket.h>
+#	include <sys/time.h>
+#endif
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  Deleter for BIO objects
+	struct BioDeleter
+	{
+		auto operator()(BIO *bio) const noexcept -> void
+		{
+			BIO_free_all(bio);
+		}
+	};
+
+	//  Deleter for SSL objects
+	struct SslDeleter
+	{
+		auto operator()(SSL *ssl) const noexcept -> void
+		{
+			SSL_free(ssl);
+		}
+	};
+
+	//  Throws an exception with the last OpenSSL error added to the message
+	[[noreturn]] auto throwSslError(std::string_view message) -> void
+	{
+		char error[256] {};
+		ERR_error_string_n(ERR_get_error(), error, sizeof(error));
+		throw std::runtime_error(utils::string::cat(message, ": ", std::string_view(error)));
+	}
+
+	//  Sets the send and receive time outs of a socket
+	auto setTimeouts(int socket, std::chrono::seconds timeout) -> void
+	{
+#ifdef _WIN32
+		const DWORD value = static_cast<DWORD>(std::chrono::milliseconds(timeout).count());
+		const auto option = reinterpret_cast<const char *>(&value);
+#else
+		const timeval value { static_cast<decltype(timeval::tv_sec)>(timeout.count()), 0 };
+		const auto option = &value;
+#endif
+		setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, option, sizeof(value));
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, option, sizeof(value));
+	}
+
+	//  Converts a string to lower case
+	auto toLower(std::string_view string) -> std::string
+	{
+		std::string result(string);
+		std::ranges::transform(
+			result, result.begin(), [](unsigned char character) { return char(std::tolower(character)); });
+		return result;
+	}
+
+	//  Removes leading and trailing white space
+	auto trim(std::string_view string) -> std::string_view
+	{
+		while (!string.empty() && (string.front() == ' ' || string.front() == '\t'))
+		{
+			string.remove_prefix(1);
+		}
+		while (!string.empty() && (string.back() == ' ' || string.back() == '\t' || string.back() == '\r'))
+		{
+			string.remove_suffix(1);
+		}
+		return string;
+	}
+} // namespace
+
+HttpsClient::HttpsClient(const std::filesystem::path &caFile) : _context(SSL_CTX_new(TLS_client_method()))
+{
+	if (!_context)
+	{
+		throwSslError("could not create SSL context");
+	}
+
+	// Always verify the server
+	SSL_CTX_set_verify(_context.get(), SSL_VERIFY_PEER, nullptr);
+	SSL_CTX_set_min_proto_version(_context.get(), TLS1_2_VERSION);
+
+	// Many servers close the connection without sending close_notify. The end of the body is checked against the
+	// Content-Length header instead, if there is one.
+	SSL_CTX_set_options(_context.get(), SSL_OP_IGNORE_UNEXPECTED_EOF);
+
+	// Load the trusted certificates
+	const auto loaded = caFile.empty()
+		? SSL_CTX_set_default_verify_paths(_context.get())
+		: SSL_CTX_load_verify_locations(_context.get(), caFile.string().c_str(), nullptr);
+	if (loaded != 1)
+	{
+		throwSslError("could not load trusted certificates");
+	}
+}
+
+auto HttpsClient::get(std::string_view url, const std::vector<std::pair<std::string, std::string>> &headers)
+	-> Response
+{
+	// Split the URL into host, port and path
+	constexpr auto kScheme = "https://"sv;
+	if (!url.starts_with(kScheme))
+	{
+		throw std::runtime_error(utils::string::cat("unsupported URL ", url, ": only https is supported"));
+	}
+	const auto authority = url.substr(kScheme.size(), url.find('/', kScheme.size()) - kScheme.size());
+	const auto pathStart = kScheme.size() + authority.size();
+	const auto path = pathStart < url.size() ? url.substr(pathStart) : "/"sv;
+	const auto portSeparator = authority.rfind(':');
+	const auto host = std::string(authority.substr(0, portSeparator));
+	const auto port = portSeparator == std::string_view::npos ? "443"sv : authority.substr(portSeparator + 1);
+	if (host.empty() || port.empty())
+	{
+		throw std::runtime_error(utils::string::cat("invalid URL ", url));
+	}
+
+	// Connect to the server. The socket is non-blocking while connecting, so that the connection attempt can time out
+	// even if the server silently drops the packets.
+	std::unique_ptr<BIO, BioDeleter> connection(BIO_new_connect(utils::string::cat(host, ":", port).c_str()));
+	if (!connection || BIO_set_nbio(connection.get(), 1) != 1 ||
+		BIO_do_connect_retry(connection.get(), static_cast<int>(kTimeout.count()), 0) != 1)
+	{
+		throwSslError(utils::string::cat("could not connect to ", authority));
+	}
+
+	// Switch the socket back to blocking mode, with time outs for sending and receiving
+	const auto socket = static_cast<int>(BIO_get_fd(connection.get(), nullptr));
+	if (BIO_socket_nbio(socket, 0) != 1)
+	{
+		throwSslError(utils::string::cat("could not set up connection to ", authority));
+	}
+	setTimeouts(socket, kTimeout);
+
+	// Perform the TLS handshake, checking that the certificate belongs to the host
+	std::unique_ptr<SSL, SslDeleter> ssl(SSL_new(_context.get()));
+	if (!ssl || SSL_set_fd(ssl.get(), socket) != 1 || SSL_set_tlsext_host_name(ssl.get(), host.c_str()) != 1 ||
+		SSL_set1_host(ssl.get(), host.c_str()) != 1)
+	{
+		throwSslError("could not set up TLS connection");
+	}
+	if (SSL_connect(ssl.get()) != 1)
+	{
+		throwSslError(utils::string::cat("TLS handshake with ", authority, " failed"));
+	}
+
+	// Send the request
+	auto request = utils::string::cat("GET ", path, " HTTP/1.0\r\nHost: ", authority, "\r\n");
+	for (auto &&[name, value] : headers)
+	{
+		request += utils::string::cat(name, ": ", value, "\r\n");
+	}
+	request += "\r\n";
+	if (SSL_write(ssl.get(), request.data(), static_cast<int>(request.size())) != static_cast<int>(request.size()))
+	{
+		throwSslError(utils::string::cat("could not send request to ", authority));
+	}
+
+	// Read the response until the server closes the connection
+	std::string data;
+	char buffer[16 * 1024];
+	while (true)
+	{
+		const auto received = SSL_read(ssl.get(), buffer, sizeof(buffer));
+		if (received <= 0)
+		{
+			const auto error = SSL_get_error(ssl.get(), received);
+			if (error == SSL_ERROR_ZERO_RETURN)
+			{
+				break;
+			}
+			throwSslError(utils::string::cat("could not receive response from ", authority));
+		}
+
+		data.append(buffer, static_cast<std::size_t>(received));
+		if (data.size() > kMaxResponseSize)
+		{
+			throw std::runtime_error(utils::string::cat("response from ", authority, " is too large"));
+		}
+	}
+
+	// Parse the status line
+	Response response;
+	const auto headerEnd = data.find("\r\n\r\n");
+	if (headerEnd == std::string::npos || !data.starts_with("HTTP/"))
+	{
+		throw std::runtime_error(utils::string::cat("invalid response from ", authority));
+	}
+	auto lines = std::string_view(data).substr(0, headerEnd);
+	auto line = lines.substr(0, lines.find("\r\n"));
+	const auto statusStart = line.find(' ') + 1;
+	const auto statusEnd = line.data() + line.size();
+	if (statusStart == 0 || std::from_chars(line.data() + statusStart, statusEnd, response._status).ec != std::errc())
+	{
+		throw std::runtime_error(utils::string::cat("invalid status line from ", authority));
+	}
+
+	// Parse the header fields
+	while (line.size() < lines.size())
+	{
+		lines.remove_prefix(line.size() + 2);
+		line = lines.substr(0, lines.find("\r\n"));
+
+		const auto colon = line.find(':');
+		if (colon != std::string_view::npos)
+		{
+			response._headers.insert_or_assign(
+				toLower(trim(line.substr(0, colon))), std::string(trim(line.substr(colon + 1))));
+		}
+	}
+
+	response._body = data.substr(headerEnd + 4);
+
+	// Make sure the connection was not closed before the whole body was received
+	if (auto contentLength = response._headers.find("content-length"sv); contentLength != response._headers.end())
+	{
+		const auto &value = contentLength->second;
+		std::size_t size {};
+		if (std::from_chars(value.data(), value.data() + value.size(), size).ec != std::errc() ||
+			size != response._body.size())
+		{
+			throw std::runtime_error(utils::string::cat("incomplete response from ", authority));
+		}
+	}
+
+	return response;
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,71 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "StringHash.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <openssl/ssl.h>
+
+namespace xentara::samples::webService
+{
+
+//  A minimal HTTPS client for fetching documents like JSON web key sets from a server. Requests are made using
+// HTTP/1.0, so that the server closes the connection after the response and never uses chunked encoding.
+//
+// The client blocks while the request is running, so it must only be used from background threads.
+class HttpsClient
+{
+public:
+	//  A response from the server
+	struct Response
+	{
+		//  The status code
+		int _status { 0 };
+
+		//  The header fields, with the names in lower case
+		StringMap<std::string> _headers;
+
+		//  The body
+		std::string _body;
+	};
+
+	//  Constructor
+	//  caFile a file containing the certificates of the certificate authorities to trust, or an empty path to use
+	// the default certificate store of the system
+	explicit HttpsClient(const std::filesystem::path &caFile = {});
+
+	//  Sends a GET request
+	//  url the URL, which must use the https scheme
+	//  headers additional header fields to send
+	//  @return the response
+	//  @throw std::runtime_error if the request failed
+	auto get(std::string_view url, const std::vector<std::pair<std::string, std::string>> &headers = {}) -> Response;
+
+	//  The time out for connecting, sending and receiving
+	static constexpr std::chrono::seconds kTimeout { 10 };
+
+	//  The maximum size of a response. Responses that are larger are rejected.
+	static constexpr std::size_t kMaxResponseSize = 1024 * 1024;
+
+private:
+	//  Deleter for the SSL context
+	struct ContextDeleter
+	{
+		auto operator()(SSL_CTX *context) const noexcept -> void
+		{
+			SSL_CTX_free(context);
+		}
+	};
+
+	//  The SSL context
+	std::unique_ptr<SSL_CTX, ContextDeleter> _context;
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,365 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/utils/string/cat.hpp>
+
+#include "JsonReader.hpp"
+#include "HttpError.hpp"
+
+#include <utility>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  Appends a Unicode code point encoded as UTF-8
+	auto appendUtf8(std::string &text, char32_t codePoint) -> void
+	{
+		if (codePoint < 0x80)
+		{
+			text.push_back(char(codePoint));
+		}
+		else if (codePoint < 0x800)
+		{
+			text.push_back(char(0xc0 | (codePoint >> 6)));
+			text.push_back(char(0x80 | (codePoint & 0x3f)));
+		}
+		else if (codePoint < 0x10000)
+		{
+			text.push_back(char(0xe0 | (codePoint >> 12)));
+			text.push_back(char(0x80 | ((codePoint >> 6) & 0x3f)));
+			text.push_back(char(0x80 | (codePoint & 0x3f)));
+		}
+		else
+		{
+			text.push_back(char(0xf0 | (codePoint >> 18)));
+			text.push_back(char(0x80 | ((codePoint >> 12) & 0x3f)));
+			text.push_back(char(0x80 | ((codePoint >> 6) & 0x3f)));
+			text.push_back(char(0x80 | (codePoint & 0x3f)));
+		}
+	}
+} // namespace
+
+auto JsonReader::beginArray() -> void
+{
+	expect('[');
+	_opened = true;
+}
+
+auto JsonReader::nextElement() -> bool
+{
+	return next(']');
+}
+
+auto JsonReader::beginObject() -> void
+{
+	expect('{');
+	_opened = true;
+}
+
+auto JsonReader::nextMember(std::string &name) -> bool
+{
+	if (!next('}'))
+	{
+		return false;
+	}
+
+	readString(name);
+	expect(':');
+	return true;
+}
+
+auto JsonReader::next(char close) -> bool
+{
+	const auto opened = std::exchange(_opened, false);
+
+	// Check for the end
+	if (peek() == close)
+	{
+		++_position;
+		return false;
+	}
+
+	// All but the first element or member are preceded by a comma
+	if (!opened)
+	{
+		expect(',');
+	}
+
+	return true;
+}
+
+auto JsonReader::readString(std::string &value) -> void
+{
+	expect('"');
+
+	value.clear();
+	while (_position < _text.size())
+	{
+		const auto character = _text[_position++];
+		switch (character)
+		{
+		case '"':
+			return;
+
+		case '\\':
+			if (_position >= _text.size())
+			{
+				fail();
+			}
+			switch (_text[_position++])
+			{
+			case '"':
+				value.push_back('"');
+				break;
+			case '\\':
+				value.push_back('\\');
+				break;
+			case '/':
+				value.push_back('/');
+				break;
+			case 'b':
+				value.push_back('\b');
+				break;
+			case 'f':
+				value.push_back('\f');
+				break;
+			case 'n':
+				value.push_back('\n');
+				break;
+			case 'r':
+				value.push_back('\r');
+				break;
+			case 't':
+				value.push_back('\t');
+				break;
+			case 'u':
+			{
+				auto codePoint = readHexDigits();
+
+				// Combine surrogate pairs
+				if (codePoint >= 0xd800 && codePoint < 0xdc00)
+				{
+					if (!_text.substr(_position).starts_with("\\u"sv))
+					{
+						fail();
+					}
+					_position += 2;
+					const auto lowSurrogate = readHexDigits();
+					if (lowSurrogate < 0xdc00 || lowSurrogate >= 0xe000)
+					{
+						fail();
+					}
+					codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+				}
+				else if (codePoint >= 0xdc00 && codePoint < 0xe000)
+				{
+					fail();
+				}
+
+				appendUtf8(value, codePoint);
+				break;
+			}
+			default:
+				fail();
+			}
+			break;
+
+		default:
+			// Control characters must be escaped
+			if (static_cast<unsigned char>(character) < 0x20)
+			{
+				fail();
+			}
+			value.push_back(character);
+		}
+	}
+
+	// The closing quote is missing
+	fail();
+}
+
+auto JsonReader::nextKind() noexcept -> Kind
+{
+	switch (peek())
+	{
+	case '"':
+		return Kind::String;
+	case '-':
+	case '0':
+	case '1':
+	case '2':
+	case '3':
+	case '4':
+	case '5':
+	case '6':
+	case '7':
+	case '8':
+	case '9':
+		return Kind::Number;
+	case 't':
+	case 'f':
+		return Kind::Boolean;
+	case 'n':
+		return Kind::Null;
+	case '[':
+		return Kind::Array;
+	case '{':
+		return Kind::Object;
+	default:
+		return Kind::Invalid;
+	}
+}
+
+auto JsonReader::readNumber() -> std::string_view
+{
+	if (nextKind() != Kind::Number)
+	{
+		fail();
+	}
+
+	const auto start = _position;
+	const auto isDigit = [&] { return _position < _text.size() && _text[_position] >= '0' && _text[_position] <= '9'; };
+	const auto skipDigits = [&] {
+		if (!isDigit())
+		{
+			fail();
+		}
+		while (isDigit())
+		{
+			++_position;
+		}
+	};
+
+	// Check the grammar of JSON numbers: an optional minus, the integer part without leading zeros, an optional
+	// fraction, and an optional exponent
+	if (_text[_position] == '-')
+	{
+		++_position;
+	}
+	if (_position < _text.size() && _text[_position] == '0')
+	{
+		++_position;
+	}
+	else
+	{
+		skipDigits();
+	}
+	if (_position < _text.size() && _text[_position] == '.')
+	{
+		++_position;
+		skipDigits();
+	}
+	if (_position < _text.size() && (_text[_position] == 'e' || _text[_position] == 'E'))
+	{
+		++_position;
+		if (_position < _text.size() && (_text[_position] == '+' || _text[_position] == '-'))
+		{
+			++_position;
+		}
+		skipDigits();
+	}
+
+	return _text.substr(start, _position - start);
+}
+
+auto JsonReader::readBoolean() -> bool
+{
+	if (peek() == 't')
+	{
+		readKeyword("true"sv);
+		return true;
+	}
+
+	readKeyword("false"sv);
+	return false;
+}
+
+auto JsonReader::readNull() -> void
+{
+	peek();
+	readKeyword("null"sv);
+}
+
+auto JsonReader::readKeyword(std::string_view keyword) -> void
+{
+	if (!_text.substr(_position).starts_with(keyword))
+	{
+		fail();
+	}
+	_position += keyword.size();
+}
+
+auto JsonReader::finish() -> void
+{
+	peek();
+	if (_position < _text.size())
+	{
+		fail();
+	}
+}
+
+auto JsonReader::peek() noexcept -> char
+{
+	while (_position < _text.size())
+	{
+		const auto character = _text[_position];
+		if (character != ' ' && character != '\t' && character != '\n' && character != '\r')
+		{
+			return character;
+		}
+		++_position;
+	}
+
+	return '\0';
+}
+
+auto JsonReader::expect(char character) -> void
+{
+	if (peek() != character)
+	{
+		fail();
+	}
+	++_position;
+}
+
+auto JsonReader::readHexDigits() -> char32_t
+{
+	if (_text.size() - _position < 4)
+	{
+		fail();
+	}
+
+	char32_t value = 0;
+	for (std::size_t index = 0; index < 4; ++index)
+	{
+		const auto character = _text[_position++];
+		value <<= 4;
+		if (character >= '0' && character <= '9')
+		{
+			value |= char32_t(character - '0');
+		}
+		else if (character >= 'a' && character <= 'f')
+		{
+			value |= char32_t(character - 'a' + 10);
+		}
+		else if (character >= 'A' && character <= 'F')
+		{
+			value |= char32_t(character - 'A' + 10);
+		}
+		else
+		{
+			fail();
+		}
+	}
+
+	return value;
+}
+
+auto JsonReader::fail() const -> void
+{
+	throw HttpError("400 Bad Request"sv, utils::string::cat("invalid JSON at offset ", _position));
+}
+
+} // namespace xentara::samples::webService
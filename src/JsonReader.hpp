@@ -0,0 +1,104 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  Reads JSON text from a request body piece by piece, without building a document.
+//
+// The caller asks for the values it expects in the order they appear, e.g. beginArray(), then nextElement() and
+// readString() until nextElement() returns false, then finish(). Text that does not match throws an HttpError with
+// the code "400 Bad Request".
+class JsonReader
+{
+public:
+	//  The kinds of values
+	enum class Kind
+	{
+		String,
+		Number,
+		Boolean,
+		Null,
+		Array,
+		Object,
+
+		//  Anything that is not the start of a valid value
+		Invalid
+	};
+
+	//  Constructor
+	//  text the JSON text, which must stay valid as long as the reader is used
+	explicit JsonReader(std::string_view text) noexcept : _text(text)
+	{
+	}
+
+	//  Reads the start of an array
+	auto beginArray() -> void;
+
+	//  Moves to the next element of an array
+	//  @return true if there is another element, or false if the end of the array was read
+	auto nextElement() -> bool;
+
+	//  Reads the start of an object
+	auto beginObject() -> void;
+
+	//  Moves to the next member of an object, and reads its name
+	//  name receives the name of the member. Any previous contents are replaced.
+	//  @return true if there is another member, or false if the end of the object was read
+	auto nextMember(std::string &name) -> bool;
+
+	//  Reads a string
+	//  value receives the string, with all escape sequences replaced. Any previous contents are replaced.
+	auto readString(std::string &value) -> void;
+
+	//  Gets the kind of the next value without reading it
+	auto nextKind() noexcept -> Kind;
+
+	//  Reads a number
+	//  @return the text of the number, which is valid as long as the text passed to the constructor
+	auto readNumber() -> std::string_view;
+
+	//  Reads a boolean
+	auto readBoolean() -> bool;
+
+	//  Reads a null
+	auto readNull() -> void;
+
+	//  Checks that nothing but whitespace follows
+	auto finish() -> void;
+
+private:
+	//  Moves to the next element or member
+	//  close the character that closes the array or object
+	auto next(char close) -> bool;
+
+	//  Skips any whitespace, and gets the next character, or '\0' at the end of the text
+	auto peek() noexcept -> char;
+
+	//  Reads a specific character, skipping any whitespace before it
+	auto expect(char character) -> void;
+
+	//  Reads a keyword like "true" or "null"
+	auto readKeyword(std::string_view keyword) -> void;
+
+	//  Reads the four hex digits of a \u escape sequence
+	auto readHexDigits() -> char32_t;
+
+	//  Throws an error about invalid JSON at the current position
+	[[noreturn]] auto fail() const -> void;
+
+	//  The text
+	std::string_view _text;
+
+	//  The current position
+	std::size_t _position { 0 };
+
+	//  Whether an array or object was just opened, so that the first element or member does not need a comma
+	bool _opened { false };
+};
+
+} // namespace xentara::samples::webService
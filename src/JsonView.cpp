@@ -0,0 +1,486 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "JsonView.hpp"
+
+#include <charconv>
+#include <limits>
+
+namespace xentara::samples::webService
+{
+
+namespace
+{
+	//  The maximum nesting depth of arrays and objects. Tokens have no business nesting deeper than this, and the
+	// limit keeps malicious input from exhausting the stack.
+	constexpr std::size_t kMaxDepth = 32;
+
+	//  Checks if a character is JSON whitespace
+	constexpr auto isWhitespace(char character) noexcept -> bool
+	{
+		return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+	}
+
+	//  Checks if a character is a decimal digit
+	constexpr auto isDigit(char character) noexcept -> bool
+	{
+		return character >= '0' && character <= '9';
+	}
+
+	//  Skips whitespace
+	auto skipWhitespace(std::string_view text, std::size_t &position) noexcept -> void
+	{
+		while (position < text.size() && isWhitespace(text[position]))
+		{
+			++position;
+		}
+	}
+
+	//  Gets the value of a hexadecimal digit, or -1 if the character is not a hexadecimal digit
+	constexpr auto hexValue(char character) noexcept -> int
+	{
+		if (character >= '0' && character <= '9')
+		{
+			return character - '0';
+		}
+		if (character >= 'a' && character <= 'f')
+		{
+			return character - 'a' + 10;
+		}
+		if (character >= 'A' && character <= 'F')
+		{
+			return character - 'A' + 10;
+		}
+		return -1;
+	}
+
+	//  Reads the four hexadecimal digits of a \u escape sequence
+	auto readCodeUnit(std::string_view text, std::size_t position) noexcept -> std::optional<char32_t>
+	{
+		if (text.size() - position < 4)
+		{
+			return std::nullopt;
+		}
+
+		char32_t codeUnit = 0;
+		for (std::size_t i = 0; i < 4; ++i)
+		{
+			const auto digit = hexValue(text[position + i]);
+			if (digit < 0)
+			{
+				return std::nullopt;
+			}
+			codeUnit = (codeUnit << 4) | static_cast<char32_t>(digit);
+		}
+
+		return codeUnit;
+	}
+
+	//  Scans the digits of a number
+	auto scanDigits(std::string_view text, std::size_t &position) noexcept -> bool
+	{
+		const auto start = position;
+		while (position < text.size() && isDigit(text[position]))
+		{
+			++position;
+		}
+		return position != start;
+	}
+
+	//  Scans a string, starting after the opening quote
+	//  @return the position of the closing quote, or std::nullopt if the string is invalid
+	auto scanString(std::string_view text, std::size_t position) noexcept -> std::optional<std::size_t>
+	{
+		while (position < text.size())
+		{
+			const auto character = text[position];
+
+			// Check for the end of the string
+			if (character == '"')
+			{
+				return position;
+			}
+
+			// Control characters must be escaped
+			if (static_cast<unsigned char>(character) < 0x20)
+			{
+				return std::nullopt;
+			}
+
+			// Handle escape sequences
+			if (character == '\\')
+			{
+				if (++position >= text.size())
+				{
+					return std::nullopt;
+				}
+
+				switch (text[position])
+				{
+				case '"':
+				case '\\':
+				case '/':
+				case 'b':
+				case 'f':
+				case 'n':
+				case 'r':
+				case 't':
+					break;
+				case 'u':
+					if (!readCodeUnit(text, position + 1))
+					{
+						return std::nullopt;
+					}
+					position += 4;
+					break;
+				default:
+					return std::nullopt;
+				}
+			}
+
+			++position;
+		}
+
+		// The string is not terminated
+		return std::nullopt;
+	}
+} // namespace
+
+auto JsonView::parse(std::string_view text) -> std::optional<JsonView>
+{
+	std::size_t position = 0;
+	auto value = scanValue(text, position, 0);
+
+	// Only whitespace may follow the value
+	skipWhitespace(text, position);
+	if (!value || position != text.size())
+	{
+		return std::nullopt;
+	}
+
+	return value;
+}
+
+auto JsonView::scanValue(std::string_view text, std::size_t &position, std::size_t depth) -> std::optional<JsonView>
+{
+	skipWhitespace(text, position);
+	if (position >= text.size())
+	{
+		return std::nullopt;
+	}
+
+	const auto start = position;
+	switch (text[position])
+	{
+	case '"':
+		{
+			const auto end = scanString(text, position + 1);
+			if (!end)
+			{
+				return std::nullopt;
+			}
+
+			position = *end + 1;
+			return JsonView(Type::String, text.substr(start + 1, *end - start - 1));
+		}
+
+	case '[':
+	case '{':
+		{
+			const auto isObject = text[position] == '{';
+			const auto closing = isObject ? '}' : ']';
+
+			if (depth >= kMaxDepth)
+			{
+				return std::nullopt;
+			}
+
+			++position;
+			skipWhitespace(text, position);
+
+			// Handle empty arrays and objects
+			if (position < text.size() && text[position] == closing)
+			{
+				++position;
+				return JsonView(isObject ? Type::Object : Type::Array, text.substr(start, position - start));
+			}
+
+			while (true)
+			{
+				// Object members start with a key and a colon
+				if (isObject)
+				{
+					const auto key = scanValue(text, position, depth + 1);
+					if (!key || !key->isString())
+					{
+						return std::nullopt;
+					}
+
+					skipWhitespace(text, position);
+					if (position >= text.size() || text[position] != ':')
+					{
+						return std::nullopt;
+					}
+					++position;
+				}
+
+				// Scan the element or member value
+				if (!scanValue(text, position, depth + 1))
+				{
+					return std::nullopt;
+				}
+
+				// Elements or members are followed by a comma or the closing bracket
+				skipWhitespace(text, position);
+				if (position >= text.size())
+				{
+					return std::nullopt;
+				}
+				if (text[position] == closing)
+				{
+					++position;
+					return JsonView(isObject ? Type::Object : Type::Array, text.substr(start, position - start));
+				}
+				if (text[position] != ',')
+				{
+					return std::nullopt;
+				}
+				++position;
+			}
+		}
+
+	case 't':
+	case 'f':
+	case 'n':
+		{
+			using namespace std::literals;
+
+			for (auto &&[literal, type] : { std::pair { "true"sv, Type::Boolean },
+					 std::pair { "false"sv, Type::Boolean },
+					 std::pair { "null"sv, Type::Null } })
+			{
+				if (text.substr(position).starts_with(literal))
+				{
+					position += literal.size();
+					return JsonView(type, text.substr(start, literal.size()));
+				}
+			}
+			return std::nullopt;
+		}
+
+	default:
+		{
+			// Must be a number
+			if (text[position] == '-')
+			{
+				++position;
+			}
+
+			// Integer part. Leading zeros are not allowed.
+			if (position < text.size() && text[position] == '0')
+			{
+				++position;
+			}
+			else if (!scanDigits(text, position))
+			{
+				return std::nullopt;
+			}
+
+			// Fraction
+			if (position < text.size() && text[position] == '.')
+			{
+				++position;
+				if (!scanDigits(text, position))
+				{
+					return std::nullopt;
+				}
+			}
+
+			// Exponent
+			if (position < text.size() && (text[position] == 'e' || text[position] == 'E'))
+			{
+				++position;
+				if (position < text.size() && (text[position] == '+' || text[position] == '-'))
+				{
+					++position;
+				}
+				if (!scanDigits(text, position))
+				{
+					return std::nullopt;
+				}
+			}
+
+			return JsonView(Type::Number, text.substr(start, position - start));
+		}
+	}
+}
+
+auto JsonView::nextElement(std::size_t &position) const -> std::optional<JsonView>
+{
+	// Skip whitespace and separators
+	while (position < _text.size() &&
+		(isWhitespace(_text[position]) || _text[position] == ',' || _text[position] == ':'))
+	{
+		++position;
+	}
+
+	// Check for the end of the array or object
+	if (position >= _text.size() || _text[position] == ']' || _text[position] == '}')
+	{
+		return std::nullopt;
+	}
+
+	return scanValue(_text, position, 0);
+}
+
+auto JsonView::asInteger() const noexcept -> std::optional<std::int64_t>
+{
+	if (_type != Type::Number)
+	{
+		return std::nullopt;
+	}
+
+	// Try plain integers first
+	std::int64_t integer = 0;
+	if (auto [end, error] = std::from_chars(_text.data(), _text.data() + _text.size(), integer);
+		error == std::errc() && end == _text.data() + _text.size())
+	{
+		return integer;
+	}
+
+	// Handle fractions and exponents
+	double value = 0;
+	if (auto [end, error] = std::from_chars(_text.data(), _text.data() + _text.size(), value);
+		error != std::errc() || end != _text.data() + _text.size())
+	{
+		return std::nullopt;
+	}
+
+	if (!(value >= double(std::numeric_limits<std::int64_t>::min()) &&
+			value < double(std::numeric_limits<std::int64_t>::max())))
+	{
+		return std::nullopt;
+	}
+
+	return static_cast<std::int64_t>(value);
+}
+
+auto JsonView::asString(std::string &scratch) const -> std::optional<std::string_view>
+{
+	if (_type != Type::String)
+	{
+		return std::nullopt;
+	}
+
+	// Return the text directly if there is nothing to unescape
+	if (_text.find('\\') == std::string_view::npos)
+	{
+		return _text;
+	}
+
+	scratch.resize(_text.size());
+	const auto size = unescape(_text, scratch.data());
+	if (!size)
+	{
+		return std::nullopt;
+	}
+
+	return std::string_view(scratch.data(), *size);
+}
+
+auto JsonView::unescape(std::string_view text, char *output) noexcept -> std::optional<std::size_t>
+{
+	auto next = output;
+
+	// Writes a code point as UTF-8
+	const auto writeUtf8 = [&next](char32_t codePoint) {
+		if (codePoint < 0x80)
+		{
+			*next++ = static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			*next++ = static_cast<char>(0xc0 | (codePoint >> 6));
+			*next++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		else if (codePoint < 0x10000)
+		{
+			*next++ = static_cast<char>(0xe0 | (codePoint >> 12));
+			*next++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			*next++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		else
+		{
+			*next++ = static_cast<char>(0xf0 | (codePoint >> 18));
+			*next++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+			*next++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			*next++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+	};
+
+	for (std::size_t position = 0; position < text.size(); ++position)
+	{
+		if (text[position] != '\\')
+		{
+			*next++ = text[position];
+			continue;
+		}
+
+		if (++position >= text.size())
+		{
+			return std::nullopt;
+		}
+
+		switch (text[position])
+		{
+		case '"':
+		case '\\':
+		case '/':
+			*next++ = text[position];
+			break;
+		case 'b':
+			*next++ = '\b';
+			break;
+		case 'f':
+			*next++ = '\f';
+			break;
+		case 'n':
+			*next++ = '\n';
+			break;
+		case 'r':
+			*next++ = '\r';
+			break;
+		case 't':
+			*next++ = '\t';
+			break;
+		case 'u':
+			{
+				auto codePoint = readCodeUnit(text, position + 1);
+				if (!codePoint)
+				{
+					return std::nullopt;
+				}
+				position += 4;
+
+				// Combine surrogate pairs
+				if (*codePoint >= 0xd800 && *codePoint < 0xdc00 && text.substr(position + 1).starts_with("\\u"))
+				{
+					const auto low = readCodeUnit(text, position + 3);
+					if (low && *low >= 0xdc00 && *low < 0xe000)
+					{
+						codePoint = 0x10000 + ((*codePoint - 0xd800) << 10) + (*low - 0xdc00);
+						position += 6;
+					}
+				}
+
+				writeUtf8(*codePoint);
+				break;
+			}
+		default:
+			return std::nullopt;
+		}
+	}
+
+	return static_cast<std::size_t>(next - output);
+}
+
+} // namespace xentara::samples::webService
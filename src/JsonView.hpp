@@ -0,0 +1,156 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  A view on a JSON value inside a JSON text. The value is only scanned far enough to find out its type and where it
+// ends. Nothing is copied or allocated, so this is much cheaper than building a JSON document if only a few values are
+// needed.
+class JsonView
+{
+public:
+	//  The type of a JSON value
+	enum class Type
+	{
+		Null,
+		Boolean,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	//  Parses a complete JSON text
+	//  text the JSON text
+	//  @return a view on the value, or std::nullopt if the text is not valid JSON
+	static auto parse(std::string_view text) -> std::optional<JsonView>;
+
+	//  Gets the type of the value
+	constexpr auto type() const noexcept -> Type
+	{
+		return _type;
+	}
+
+	//  Gets the JSON text of the value. For strings, this is the still escaped text between the quotes.
+	constexpr auto text() const noexcept -> std::string_view
+	{
+		return _text;
+	}
+
+	//  Checks the type of the value
+	constexpr auto isString() const noexcept -> bool
+	{
+		return _type == Type::String;
+	}
+
+	//  Checks the type of the value
+	constexpr auto isNumber() const noexcept -> bool
+	{
+		return _type == Type::Number;
+	}
+
+	//  Checks the type of the value
+	constexpr auto isArray() const noexcept -> bool
+	{
+		return _type == Type::Array;
+	}
+
+	//  Checks the type of the value
+	constexpr auto isObject() const noexcept -> bool
+	{
+		return _type == Type::Object;
+	}
+
+	//  Gets the value of a number as an integer. Fractions are truncated.
+	//  @return the value, or std::nullopt if the value is not a number or is out of range
+	auto asInteger() const noexcept -> std::optional<std::int64_t>;
+
+	//  Gets the value of a string. If the string contains no escape sequences, a view into the JSON text is returned
+	// without copying anything. Otherwise, the string is unescaped into the given buffer.
+	//  scratch a buffer that is used if the string contains escape sequences
+	//  @return the string, or std::nullopt if the value is not a string
+	auto asString(std::string &scratch) const -> std::optional<std::string_view>;
+
+	//  Calls a callback for each element of an array
+	//  callback the callback, which is called with a JsonView for every element
+	//  @return false if the value is not an array
+	template <class Callback>
+	auto forEachElement(Callback &&callback) const -> bool
+	{
+		if (_type != Type::Array)
+		{
+			return false;
+		}
+
+		// The contents have been validated when the array was scanned, so they can simply be iterated
+		std::size_t position = 1;
+		while (auto element = nextElement(position))
+		{
+			callback(*element);
+		}
+
+		return true;
+	}
+
+	//  Calls a callback for each member of an object
+	//  callback the callback, which is called with the still escaped key and a JsonView for the value
+	//  @return false if the value is not an object
+	template <class Callback>
+	auto forEachMember(Callback &&callback) const -> bool
+	{
+		if (_type != Type::Object)
+		{
+			return false;
+		}
+
+		// The contents have been validated when the object was scanned, so they can simply be iterated
+		std::size_t position = 1;
+		while (auto key = nextElement(position))
+		{
+			auto value = nextElement(position);
+			callback(*key, *value);
+		}
+
+		return true;
+	}
+
+	//  Unescapes the text of a JSON string
+	//  text the escaped text between the quotes
+	//  output the buffer to write the unescaped string to. This must have room for at least text.size() bytes, and
+	// may point to the beginning of the text itself.
+	//  @return the length of the unescaped string, or std::nullopt if the text contains invalid escape sequences
+	static auto unescape(std::string_view text, char *output) noexcept -> std::optional<std::size_t>;
+
+private:
+	//  Constructor
+	constexpr JsonView(Type type, std::string_view text) noexcept : _type(type), _text(text)
+	{
+	}
+
+	//  Scans a value
+	//  text the JSON text
+	//  position the position to start at, which is moved past the value
+	//  depth the nesting depth of the value
+	//  @return a view on the value, or std::nullopt if the value is invalid
+	static auto scanValue(std::string_view text, std::size_t &position, std::size_t depth) -> std::optional<JsonView>;
+
+	//  Gets the next element or key or value in an array or object that has already been validated.
+	//  position the position to start at, which is moved past the element and the following separator
+	//  @return the element, or std::nullopt if the end of the array or object has been reached
+	auto nextElement(std::size_t &position) const -> std::optional<JsonView>;
+
+	//  The type of the value
+	Type _type;
+
+	//  The JSON text of the value
+	std::string_view _text;
+};
+
+} // namespace xentara::samples::webService
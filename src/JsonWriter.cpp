@@ -0,0 +1,131 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "JsonWriter.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <iterator>
+
+namespace xentara::samples::webService::json
+{
+using namespace std::literals;
+
+namespace
+{
+	//  Appends a number with at least the given number of digits, padded with zeros
+	auto appendPadded(std::string &text, std::int64_t value, int digits) -> void
+	{
+		char buffer[24];
+		const auto end = std::to_chars(std::begin(buffer), std::end(buffer), value).ptr;
+		for (auto size = end - std::begin(buffer); size < digits; ++size)
+		{
+			text.push_back('0');
+		}
+		text.append(std::begin(buffer), end);
+	}
+} // namespace
+
+auto appendString(std::string &text, std::string_view value) -> void
+{
+	constexpr auto kHexDigits = "0123456789abcdef"sv;
+
+	text.push_back('"');
+	for (auto character : value)
+	{
+		switch (character)
+		{
+		case '"':
+			text.append("\\\""sv);
+			break;
+		case '\\':
+			text.append("\\\\"sv);
+			break;
+		case '\n':
+			text.append("\\n"sv);
+			break;
+		case '\r':
+			text.append("\\r"sv);
+			break;
+		case '\t':
+			text.append("\\t"sv);
+			break;
+		default:
+			// Escape all other control characters
+			if (static_cast<unsigned char>(character) < 0x20)
+			{
+				text.append("\\u00"sv);
+				text.push_back(kHexDigits[static_cast<unsigned char>(character) >> 4]);
+				text.push_back(kHexDigits[static_cast<unsigned char>(character) & 0xf]);
+			}
+			else
+			{
+				text.push_back(character);
+			}
+		}
+	}
+	text.push_back('"');
+}
+
+auto appendNumber(std::string &text, std::int64_t value) -> void
+{
+	char buffer[24];
+	const auto end = std::to_chars(std::begin(buffer), std::end(buffer), value).ptr;
+	text.append(std::begin(buffer), end);
+}
+
+auto appendNumber(std::string &text, std::uint64_t value) -> void
+{
+	char buffer[24];
+	const auto end = std::to_chars(std::begin(buffer), std::end(buffer), value).ptr;
+	text.append(std::begin(buffer), end);
+}
+
+auto appendNumber(std::string &text, double value) -> void
+{
+	if (!std::isfinite(value))
+	{
+		appendNull(text);
+		return;
+	}
+
+	// The shortest representation that reads back as the same value
+	char buffer[32];
+	const auto end = std::to_chars(std::begin(buffer), std::end(buffer), value).ptr;
+	text.append(std::begin(buffer), end);
+}
+
+auto appendBoolean(std::string &text, bool value) -> void
+{
+	text.append(value ? "true"sv : "false"sv);
+}
+
+auto appendTime(std::string &text, std::chrono::system_clock::time_point value) -> void
+{
+	const auto microseconds = std::chrono::floor<std::chrono::microseconds>(value);
+	const auto days = std::chrono::floor<std::chrono::days>(microseconds);
+	const std::chrono::year_month_day date { days };
+	const std::chrono::hh_mm_ss time { microseconds - days };
+
+	text.push_back('"');
+	appendPadded(text, int(date.year()), 4);
+	text.push_back('-');
+	appendPadded(text, unsigned(date.month()), 2);
+	text.push_back('-');
+	appendPadded(text, unsigned(date.day()), 2);
+	text.push_back('T');
+	appendPadded(text, time.hours().count(), 2);
+	text.push_back(':');
+	appendPadded(text, time.minutes().count(), 2);
+	text.push_back(':');
+	appendPadded(text, time.seconds().count(), 2);
+	text.push_back('.');
+	appendPadded(text, time.subseconds().count(), 6);
+	text.append("Z\""sv);
+}
+
+auto appendNull(std::string &text) -> void
+{
+	text.append("null"sv);
+}
+
+} // namespace xentara::samples::webService::json
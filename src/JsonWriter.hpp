@@ -0,0 +1,40 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  Functions for writing JSON text directly into a string. Nothing but the string itself is allocated, so that strings
+// whose capacity is reused can be filled without allocating memory.
+namespace json
+{
+
+	//  Appends a JSON string, adding the quotes and escaping all characters that need it
+	auto appendString(std::string &text, std::string_view value) -> void;
+
+	//  Appends a JSON number
+	auto appendNumber(std::string &text, std::int64_t value) -> void;
+
+	//  Appends a JSON number
+	auto appendNumber(std::string &text, std::uint64_t value) -> void;
+
+	//  Appends a JSON number. Values that cannot be represented in JSON, like infinity or NaN, are written as null.
+	auto appendNumber(std::string &text, double value) -> void;
+
+	//  Appends a JSON boolean
+	auto appendBoolean(std::string &text, bool value) -> void;
+
+	//  Appends a point in time as a JSON string in ISO 8601 format, in UTC, with microseconds
+	auto appendTime(std::string &text, std::chrono::system_clock::time_point value) -> void;
+
+	//  Appends a JSON null
+	auto appendNull(std::string &text) -> void;
+
+} // namespace json
+
+} // namespace xentara::samples::webService
@@ -2,9 +2,25 @@
 
 #include <xentara/utils/json/decoder/Document.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
+#include <xentara/utils/string/cat.hpp>
+
 #include "JwksTokenVerification.hpp"
 #include "TokenVerifierFactory.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#	include <poll.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
 #ifdef _MSC_VER
 #	pragma warning(push)
 #	pragma warning(disable : 4242)
@@ -29,6 +45,78 @@ namespace xentara::samples::webService
 {
 using namespace std::literals;
 
+namespace
+{
+	//  The time after which keys are fetched again if the server does not say how long they may be cached
+	constexpr std::chrono::seconds kDefaultRefreshInterval = 15min;
+
+	//  The minimum and maximum times after which keys are fetched again
+	constexpr std::chrono::seconds kMinRefreshInterval = 30s;
+	constexpr std::chrono::seconds kMaxRefreshInterval = 24h;
+
+	//  The minimum and maximum times after which a failed fetch is retried. The time is doubled after each failure.
+	constexpr std::chrono::seconds kMinRetryInterval = 5s;
+	constexpr std::chrono::seconds kMaxRetryInterval = 5min;
+
+	//  Gets an integer directive like max-age from a Cache-Control header
+	auto cacheDirective(std::string_view cacheControl, std::string_view name) -> std::optional<std::int64_t>
+	{
+		for (auto position = cacheControl.find(name); position != std::string_view::npos;
+			 position = cacheControl.find(name, position + 1))
+		{
+			// Make sure we found the whole directive name
+			const auto valueStart = position + name.size();
+			if ((position > 0 && cacheControl[position - 1] != ' ' && cacheControl[position - 1] != ',') ||
+				valueStart >= cacheControl.size() || cacheControl[valueStart] != '=')
+			{
+				continue;
+			}
+
+			std::int64_t value {};
+			const auto begin = cacheControl.data() + valueStart + 1;
+			if (std::from_chars(begin, cacheControl.data() + cacheControl.size(), value).ec == std::errc())
+			{
+				return value;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	//  Gets the time after which keys should be fetched again from the caching headers of a response. The keys are
+	// fetched again a bit before they expire, so that new keys are known before the old ones are retired.
+	auto refreshInterval(const StringMap<std::string> &headers) -> std::chrono::seconds
+	{
+		const auto cacheControl = headers.find("cache-control"sv);
+		if (cacheControl == headers.end())
+		{
+			return kDefaultRefreshInterval;
+		}
+		if (cacheControl->second.find("no-cache") != std::string::npos ||
+			cacheControl->second.find("no-store") != std::string::npos)
+		{
+			return kMinRefreshInterval;
+		}
+		auto maxAge = cacheDirective(cacheControl->second, "max-age");
+		if (!maxAge)
+		{
+			return kDefaultRefreshInterval;
+		}
+
+		// Subtract the time the response was held in a cache on the way
+		if (auto age = headers.find("age"sv); age != headers.end())
+		{
+			std::int64_t value {};
+			if (std::from_chars(age->second.data(), age->second.data() + age->second.size(), value).ec == std::errc())
+			{
+				*maxAge -= value;
+			}
+		}
+
+		return std::clamp(std::chrono::seconds(*maxAge - *maxAge / 10), kMinRefreshInterval, kMaxRefreshInterval);
+	}
+} // namespace
+
 auto JwksTokenVerification::loadConfig(utils::json::decoder::Object &jsonObject) -> void
 {
 	// Go through all parameters
@@ -65,55 +153,158 @@ auto JwksTokenVerification::loadConfig(utils::json::decoder::Object &jsonObject)
 					value, std::runtime_error("invalid jwksFile path : keyFile not found"));
 			}
 		}
+		else if (key == u8"jwksUri")
+		{
+			// The URI is a string
+			auto uri = value.asString<std::u8string>();
+
+			// Only HTTPS is supported, so that the keys cannot be tampered with on the way
+			if (!uri.starts_with(u8"https://"))
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("invalid jwksUri : only https URIs are supported for verification in "
+									   "Authentication for Web Service Server"));
+			}
+
+			// Store the URI
+			_jwksUri = std::string(uri.begin(), uri.end());
+		}
+		else if (key == u8"jwksCaFile")
+		{
+			// The CA file is a string
+			auto caFile = value.asString<std::u8string>();
+
+			// Store the CA file
+			_jwksCaFile = std::string(caFile.begin(), caFile.end());
+
+			// check it the path the CA file is relative
+			if (!_jwksCaFile.is_absolute())
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("invalid jwksCaFile path : set absolute path for the jwksCaFile for "
+									   "verification in Authentication for Web Service Server"));
+			}
+		}
 		else
 		{
 			config::throwUnknownParameterError(key);
 		}
 	}
 
-	// Check if the keyFile has been found
-	if (_jwksFile.empty())
+	// Check if either the keyFile or the URI has been found
+	if (_jwksFile.empty() == _jwksUri.empty())
 	{
 		utils::json::decoder::throwWithLocation(jsonObject,
-			std::runtime_error("missing jwksFile path for verification in Authentication for Web Service Server"));
+			std::runtime_error("exactly one of jwksFile and jwksUri must be set for verification in Authentication "
+							   "for Web Service Server"));
+	}
+
+	// The CA file is only used for the URI
+	if (!_jwksCaFile.empty() && _jwksUri.empty())
+	{
+		utils::json::decoder::throwWithLocation(
+			jsonObject, std::runtime_error("jwksCaFile can only be used together with jwksUri"));
 	}
 }
 
-auto JwksTokenVerification::verify(const JwtToken &token) -> void
+auto JwksTokenVerification::verify(const DecodedJwt &token) -> AuthenticationResult
 {
 
 	// Find the verifier that matches the key id
-	auto verifier = _verifiers.find(token.get_key_id());
+	auto verifier = this->verifier(token.keyId());
 
-	// If no key found through error
-	if (verifier == _verifiers.end())
+	// If no key found, reject the token. The key set may have been rotated at the identity provider, so ask for the
+	// keys to be fetched again, without waiting for them.
+	if (!verifier)
 	{
-		throw std::runtime_error("unknown key ID in token");
+		requestRefetch();
+		return AuthenticationResult::UnknownKey;
 	}
 
-	// Error code of the verifier
-	std::error_code errorCode;
+	// Verify the signature
+	return verifySignature(*verifier, token);
+}
 
-	// Verify the token
-	verifier->second.verify(token, errorCode);
+auto JwksTokenVerification::precheck(const DecodedJwt &token) -> bool
+{
+	// Find the verifier that matches the key id
+	auto verifier = this->verifier(token.keyId());
 
-	// Check if there is any error during verification process
-	if (errorCode.value() != static_cast<int>(jwt::error::token_verification_error::ok))
+	// If no key found, ask for the keys to be fetched again, like verify() does
+	if (!verifier)
 	{
-		// Ignore token expiration error
-		if (errorCode.value() != static_cast<int>(jwt::error::token_verification_error::token_expired))
-		{
-			throw std::runtime_error(errorCode.message());
-		}
+		requestRefetch();
+		return false;
+	}
+
+	return token.algorithm() == verifier->algorithm();
+}
+
+auto JwksTokenVerification::verifier(std::string_view keyId) -> const SignatureVerifier *
+{
+	auto &state = _threadStates.local();
+
+	// Pick up a new key set if the keys were reloaded. This is only a single atomic load unless the keys changed.
+	if (const auto generation = _generation.load(std::memory_order_acquire); generation != state._generation)
+	{
+		state._keySet = _keySet.load(std::memory_order_acquire);
+		state._verifiers.clear();
+		state._generation = generation;
+	}
+
+	// Look for an existing verifier for this thread
+	if (auto verifier = state._verifiers.find(keyId); verifier != state._verifiers.end())
+	{
+		return verifier->second.get();
+	}
+
+	// Find the key
+	auto key = state._keySet->_keys.find(keyId);
+	if (key == state._keySet->_keys.end())
+	{
+		return nullptr;
 	}
 
-	return;
+	// Create a verifier for this thread
+	auto &verifier = state._verifiers[key->first];
+	verifier = key->second._factory.get().create(key->second._pem);
+	return verifier.get();
 }
 
-auto JwksTokenVerification::initialize() -> void
+auto JwksTokenVerification::initialize(Logger &logger) -> void
 {
+	_logger = &logger;
+
+	// Fetch the keys from the URI if one was given
+	if (!_jwksUri.empty())
+	{
+		HttpsClient client(_jwksCaFile);
+
+		// Start without keys, and fetch them in the background right away, so that an identity provider that cannot
+		// be reached does not hold up the start of the server. Tokens are rejected until the keys have been fetched.
+		publish(std::make_shared<KeySet>());
+
+		// Keep the keys up to date
+		_updater = std::jthread(
+			[this, client = std::move(client)](std::stop_token stopToken) mutable
+			{ refresh(stopToken, std::move(client), 0s); });
+		return;
+	}
+
 	// Read the Jwks from the file
-	auto jwks = jwt::parse_jwks(readFile(_jwksFile));
+	_loadedJwks = readFile(_jwksFile);
+	publish(parseKeySet(_loadedJwks));
+
+	// Watch the file for changes
+	_updater = std::jthread([this](std::stop_token stopToken) { watch(stopToken); });
+}
+
+auto JwksTokenVerification::parseKeySet(const std::string &jwksText) -> std::shared_ptr<const KeySet>
+{
+	auto keySet = std::make_shared<KeySet>();
+
+	// Parse the Jwks
+	auto jwks = jwt::parse_jwks(jwksText);
 
 	// Go through all the keys and read the key
 	for (auto &&jwk : jwks)
@@ -129,9 +320,198 @@ auto JwksTokenVerification::initialize() -> void
 
 		// Convert the key to pem
 		auto x5c = jwk.get_x5c_key_value();
+		auto pem = jwt::helper::convert_base64_der_to_pem(x5c);
+
+		// Create a verifier right away, so that an invalid key is reported before the key set is used
+		algorithmFactory->create(pem);
+
+		// Add the pem key
+		keySet->_keys.insert_or_assign(jwk.get_key_id(), Key { *algorithmFactory, std::move(pem) });
+	}
+
+	return keySet;
+}
+
+auto JwksTokenVerification::publish(std::shared_ptr<const KeySet> keySet) -> void
+{
+	// Store the key set first, so that threads that see the new generation also see the new key set
+	_keySet.store(std::move(keySet), std::memory_order_release);
+	_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+auto JwksTokenVerification::reload() -> void
+{
+	try
+	{
+		// Do nothing if the contents have not changed
+		auto jwks = readFile(_jwksFile);
+		if (jwks == _loadedJwks)
+		{
+			return;
+		}
+
+		// Build the new key set completely before publishing it
+		publish(parseKeySet(jwks));
+		_loadedJwks = std::move(jwks);
+
+		_logger->log(Logger::Severity::Info, utils::string::cat("reloaded JSON web key set from ", _jwksFile.string()));
+	}
+	catch (const std::exception &exception)
+	{
+		// Keep the old keys. The file may just be in the middle of being written.
+		_logger->log(Logger::Severity::Warning,
+			utils::string::cat("could not reload JSON web key set from ", _jwksFile.string(), ": ", exception.what()));
+	}
+}
+
+auto JwksTokenVerification::watch(std::stop_token stopToken) -> void
+{
+	using namespace std::chrono_literals;
+
+	// How often to check whether to stop
+	constexpr auto kStopCheckInterval = 500ms;
+
+#ifdef __linux__
+	// Watch the directory rather than the file, because key files are usually replaced by renaming a new file over
+	// them, or by switching a symbolic link, which a watch on the file itself would not notice
+	if (const auto fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC); fileDescriptor >= 0)
+	{
+		const auto directory = _jwksFile.parent_path().string();
+		if (inotify_add_watch(fileDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0)
+		{
+			while (!stopToken.stop_requested())
+			{
+				pollfd pollDescriptor { fileDescriptor, POLLIN, 0 };
+				if (poll(&pollDescriptor, 1, int(std::chrono::milliseconds(kStopCheckInterval).count())) <= 0)
+				{
+					continue;
+				}
+
+				// Drain all pending events. Any change in the directory triggers a check, because reload() ignores
+				// changes that do not affect the contents of the key file.
+				alignas(inotify_event) char events[4096];
+				while (read(fileDescriptor, events, sizeof(events)) > 0)
+				{
+				}
+
+				reload();
+			}
+
+			close(fileDescriptor);
+			return;
+		}
+
+		close(fileDescriptor);
+	}
+#endif
+
+	// Fall back to polling the modification time
+	constexpr auto kPollInterval = 5s;
+	std::error_code errorCode;
+	auto lastWriteTime = std::filesystem::last_write_time(_jwksFile, errorCode);
+	auto nextPoll = std::chrono::steady_clock::now() + kPollInterval;
+	while (!stopToken.stop_requested())
+	{
+		std::this_thread::sleep_for(kStopCheckInterval);
+		if (std::chrono::steady_clock::now() < nextPoll)
+		{
+			continue;
+		}
+		nextPoll += kPollInterval;
 
-		// Add the pem key and create new verifier
-		_verifiers.emplace(jwk.get_key_id(), algorithmFactory->create(jwt::helper::convert_base64_der_to_pem(x5c)));
+		if (const auto writeTime = std::filesystem::last_write_time(_jwksFile, errorCode);
+			!errorCode && writeTime != lastWriteTime)
+		{
+			lastWriteTime = writeTime;
+			reload();
+		}
+	}
+}
+
+auto JwksTokenVerification::fetch(HttpsClient &client) -> std::chrono::seconds
+{
+	// Only ask for the keys if they have changed since the last fetch
+	std::vector<std::pair<std::string, std::string>> headers { { "Accept", "application/json" } };
+	if (!_etag.empty())
+	{
+		headers.emplace_back("If-None-Match", _etag);
+	}
+
+	auto response = client.get(_jwksUri, headers);
+	if (response._status == 200)
+	{
+		// Build the new key set completely before publishing it
+		publish(parseKeySet(response._body));
+
+		// Remember the entity tag for the next fetch
+		auto etag = response._headers.find("etag"sv);
+		_etag = etag != response._headers.end() ? etag->second : std::string();
+
+		_logger->log(Logger::Severity::Info, utils::string::cat("fetched JSON web key set from ", _jwksUri));
+	}
+	else if (response._status != 304)
+	{
+		throw std::runtime_error(utils::string::cat("server responded with status ", std::to_string(response._status)));
+	}
+
+	return refreshInterval(response._headers);
+}
+
+auto JwksTokenVerification::refresh(std::stop_token stopToken, HttpsClient client, std::chrono::seconds delay) -> void
+{
+	auto nextFetch = std::chrono::steady_clock::now() + delay;
+	auto retryInterval = kMinRetryInterval;
+	while (true)
+	{
+		// Wait until the keys are about to expire, or a fetch is requested
+		{
+			std::unique_lock lock(_refetchMutex);
+			_refetchCondition.wait_until(lock, stopToken, nextFetch, [this] { return _refetchRequested; });
+			if (stopToken.stop_requested())
+			{
+				return;
+			}
+			_refetchRequested = false;
+		}
+
+		try
+		{
+			nextFetch = std::chrono::steady_clock::now() + fetch(client);
+			retryInterval = kMinRetryInterval;
+		}
+		catch (const std::exception &exception)
+		{
+			// Keep the old keys, and try again later
+			_logger->log(Logger::Severity::Warning,
+				utils::string::cat("could not fetch JSON web key set from ", _jwksUri, ": ", exception.what()));
+			nextFetch = std::chrono::steady_clock::now() + retryInterval;
+			retryInterval = std::min(retryInterval * 2, kMaxRetryInterval);
+		}
+	}
+}
+
+auto JwksTokenVerification::requestRefetch() -> void
+{
+	// Keys from a file are reloaded as soon as the file changes anyway
+	if (_jwksUri.empty())
+	{
+		return;
+	}
+
+	// Only let one request through every kRefetchInterval
+	const auto now = std::chrono::steady_clock::now();
+	auto lastRefetch = _lastRefetch.load(std::memory_order_relaxed);
+	if (now < lastRefetch + kRefetchInterval ||
+		!_lastRefetch.compare_exchange_strong(lastRefetch, now, std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	// Wake up the fetch thread
+	{
+		std::scoped_lock lock(_refetchMutex);
+		_refetchRequested = true;
 	}
+	_refetchCondition.notify_one();
 }
 } // namespace xentara::samples::webService
\ No newline at end of file
@@ -4,18 +4,30 @@
 #include <xentara/utils/json/decoder/Document.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
 
-#include "JwtCpp.hpp"
 #include "AbstractTokenVerification.hpp"
+#include "HttpsClient.hpp"
+#include "PerThread.hpp"
+#include "StringHash.hpp"
+#include "TokenVerifierFactory.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stop_token>
 #include <string>
-#include <unordered_map>
 #include <fstream>
+#include <thread>
 
 namespace xentara::samples::webService
 {
 
-//  This is derived class of Token verification for JSON web key sets. 
+//  This is derived class of Token verification for JSON web key sets. The keys are either read from a file, which is
+// watched for changes, or fetched from the jwks_uri of the identity provider. In both cases, the keys are updated in
+// the background, so that key rotations do not require a restart, and worker threads never wait for the update.
 class JwksTokenVerification : public AbstractTokenVerification
 {
 public:
@@ -23,19 +35,135 @@ public:
 	// required for jwts token verification
 	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void final;
 
-	// Override function of AbstractTokenVerification::initialize(). This function reads the file and creates a verifier
-	auto initialize() -> void override;
+	// Override function of AbstractTokenVerification::initialize(). This function loads the keys and starts updating
+	// them in the background
+	auto initialize(Logger &logger) -> void override;
 
 	// Override function of AbstractTokenVerification::verify(...). This function creates the verification process of
 	// the token
-	auto verify(const JwtToken &token) -> void final;
+	auto verify(const DecodedJwt &token) -> AuthenticationResult final;
+
+	// Override function of AbstractTokenVerification::precheck(...). This function checks that the key set contains
+	// the key ID of the token, and that the key uses the algorithm of the token
+	auto precheck(const DecodedJwt &token) -> bool final;
+
+	// Override function of AbstractTokenVerification::keyGeneration(). This returns the generation of the key set.
+	auto keyGeneration() const noexcept -> std::uint64_t final
+	{
+		return _generation.load(std::memory_order_acquire);
+	}
 
 private:
+	//  A key from the key set
+	struct Key
+	{
+		//  The factory for the algorithm of the key
+		std::reference_wrapper<const TokenVerifierFactory> _factory;
+
+		//  The key in PEM format
+		std::string _pem;
+	};
+
+	//  An immutable snapshot of the key set. A new snapshot is created whenever the keys are reloaded, so that worker
+	// threads never see a partially built key set.
+	struct KeySet
+	{
+		//  The keys by key ID
+		StringMap<Key> _keys;
+	};
+
+	//  The state of each worker thread
+	struct ThreadState
+	{
+		//  The generation of the key set the verifiers were created from
+		std::uint64_t _generation { 0 };
+
+		//  The key set the verifiers were created from
+		std::shared_ptr<const KeySet> _keySet;
+
+		//  The verifiers by key ID. Each thread gets its own verifiers with their own copies of the keys, so that the
+		// threads do not share any cryptographic state. The verifiers are created when a thread first sees a key ID.
+		StringMap<std::unique_ptr<SignatureVerifier>> _verifiers;
+	};
+
+	//  Gets the verifier for a key ID for the calling thread
+	//  @return the verifier, or nullptr if the key ID is unknown
+	auto verifier(std::string_view keyId) -> const SignatureVerifier *;
+
+	//  Parses a JSON web key set
+	static auto parseKeySet(const std::string &jwksText) -> std::shared_ptr<const KeySet>;
+
+	//  Publishes a new key set to the worker threads
+	auto publish(std::shared_ptr<const KeySet> keySet) -> void;
+
+	//  Reloads the key file if its contents changed. Errors are reported, and the old keys are kept.
+	auto reload() -> void;
+
+	//  Watches the key file for changes until a stop is requested
+	auto watch(std::stop_token stopToken) -> void;
+
+	//  Fetches the keys from the URI, unless they have not changed since the last fetch
+	//  @return the time after which the keys should be fetched again
+	//  @throw std::runtime_error if the keys could not be fetched
+	auto fetch(HttpsClient &client) -> std::chrono::seconds;
+
+	//  Fetches the keys from the URI whenever they are about to expire or a fetch was requested, until a stop is
+	// requested. Errors are reported, and the old keys are kept.
+	//  delay the time until the first fetch
+	auto refresh(std::stop_token stopToken, HttpsClient client, std::chrono::seconds delay) -> void;
+
+	//  Asks the fetch thread to fetch the keys from the URI right away, because a token used an unknown key ID. This
+	// does not wait for the fetch, and does nothing if a fetch was already requested within kRefetchInterval, so that
+	// tokens with made up key IDs cannot cause a request to the identity provider each.
+	auto requestRefetch() -> void;
+
+	//  The minimum time between two fetches caused by unknown key IDs
+	static constexpr std::chrono::seconds kRefetchInterval { 60 };
+
+	//  The logger for messages about the keys
+	Logger *_logger { nullptr };
+
 	//  Path to the keyFile
 	std::filesystem::path _jwksFile;
 
-	//  Jwts verifiers map
-	std::unordered_map<std::string, JwtVerifier> _verifiers;
+	//  The URI to fetch the keys from, or an empty string if the keys are read from _jwksFile
+	std::string _jwksUri;
+
+	//  A file containing the certificates of the certificate authorities to trust when fetching the keys, or an empty
+	// path to use the default certificate store of the system
+	std::filesystem::path _jwksCaFile;
+
+	//  The entity tag of the last key set fetched from _jwksUri. This is only used by the fetch thread.
+	std::string _etag;
+
+	//  The last time a fetch was requested because of an unknown key ID
+	std::atomic<std::chrono::steady_clock::time_point> _lastRefetch { std::chrono::steady_clock::time_point::min() };
+
+	//  Protects _refetchRequested
+	std::mutex _refetchMutex;
+
+	//  Wakes up the fetch thread when a fetch was requested
+	std::condition_variable_any _refetchCondition;
+
+	//  Whether a fetch was requested because of an unknown key ID
+	bool _refetchRequested { false };
+
+	//  The contents of the key file the current keys were loaded from
+	std::string _loadedJwks;
+
+	//  The current key set. This is only read by worker threads if _generation has changed.
+	std::atomic<std::shared_ptr<const KeySet>> _keySet;
+
+	//  The generation of the current key set. This is incremented after a new key set has been published, and lets
+	// the worker threads check for a new key set with a single atomic load.
+	std::atomic<std::uint64_t> _generation { 0 };
+
+	//  The state of each worker thread
+	PerThread<ThreadState> _threadStates;
+
+	//  The thread watching the key file or fetching the keys. This must be the last member, so that it is stopped
+	// before anything it uses is destroyed.
+	std::jthread _updater;
 };
 
 } // namespace xentara::samples::webService
\ No newline at end of file
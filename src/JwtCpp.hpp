@@ -11,20 +11,8 @@
 #	pragma GCC diagnostic ignored "-Wold-style-cast"
 #endif
 
-#include <utility>
-
 #include <jwt-cpp/jwt.h>
 
-namespace xentara::samples::webService
-{
-// aliases
-using JwtToken = decltype(jwt::decode(std::declval<std::string>()));
-using JwtClaim = decltype(std::declval<JwtToken>().get_payload_claim(std::declval<std::string>()));
-using JwtClaimValue = decltype(std::declval<JwtClaim>().to_json());
-using JwtVerifier = decltype(jwt::verify());
-
-}; // namespace xentara::samples::webService
-
 #if defined (_MSC_VER)
 #	pragma warning(pop)
 #endif
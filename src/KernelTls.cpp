@@ -0,0 +1,103 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "KernelTls.hpp"
+#include "Metrics.hpp"
+
+#include <stdexcept>
+#include <string_view>
+
+#include <openssl/bio.h>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+auto KernelTls::configure(SSL_CTX *context) -> void
+{
+	// Let OpenSSL find this object from within the info callback
+	if (!SSL_CTX_set_ex_data(context, dataIndex(), this))
+	{
+		throw std::runtime_error("could not configure kernel TLS for the Web Service Server");
+	}
+
+	// OpenSSL only uses kTLS for connections whose cipher the kernel supports, and uses its own encryption otherwise
+	SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+	_enabled = true;
+
+	// Count the connections that actually use kTLS, keeping any callback libhttp registered
+	_previousInfoCallback = SSL_CTX_get_info_callback(context);
+	SSL_CTX_set_info_callback(context, &KernelTls::staticInfoCallback);
+}
+
+auto KernelTls::formatMetrics(std::string &text) const -> void
+{
+	if (!_enabled)
+	{
+		return;
+	}
+
+	Metrics::formatCounter(text, "ktls_handshakes_total"sv,
+		"Number of completed TLS handshakes while kernel TLS was enabled."sv,
+		_handshakes.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "ktls_send_connections_total"sv,
+		"Number of TLS connections whose records are encrypted by the kernel."sv,
+		_kernelSend.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "ktls_receive_connections_total"sv,
+		"Number of TLS connections whose records are decrypted by the kernel."sv,
+		_kernelReceive.load(std::memory_order_relaxed));
+}
+
+auto KernelTls::handshakeDone(const SSL *connection) noexcept -> void
+{
+	// OpenSSL may report the end of the handshake more than once with TLS 1.3, so mark the connection once it was
+	// counted
+	if (SSL_get_ex_data(connection, connectionDataIndex()))
+	{
+		return;
+	}
+	SSL_set_ex_data(const_cast<SSL *>(connection), connectionDataIndex(), this);
+
+	_handshakes.fetch_add(1, std::memory_order_relaxed);
+
+	if (BIO_get_ktls_send(SSL_get_wbio(connection)))
+	{
+		_kernelSend.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (BIO_get_ktls_recv(SSL_get_rbio(connection)))
+	{
+		_kernelReceive.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+auto KernelTls::staticInfoCallback(const SSL *connection, int where, int value) -> void
+{
+	auto kernelTls = static_cast<KernelTls *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(connection), dataIndex()));
+	if (!kernelTls)
+	{
+		return;
+	}
+
+	if (kernelTls->_previousInfoCallback)
+	{
+		kernelTls->_previousInfoCallback(connection, where, value);
+	}
+
+	if ((where & SSL_CB_HANDSHAKE_DONE) != 0)
+	{
+		kernelTls->handshakeDone(connection);
+	}
+}
+
+auto KernelTls::dataIndex() -> int
+{
+	static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+	return index;
+}
+
+auto KernelTls::connectionDataIndex() -> int
+{
+	static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+	return index;
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,58 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <openssl/ssl.h>
+
+namespace xentara::samples::webService
+{
+
+//  Lets the kernel encrypt and decrypt the TLS records of the HTTPS listener (kTLS), so that response bodies are not
+// encrypted in user space.
+//
+// After the handshake, OpenSSL hands the symmetric keys to the kernel if the kernel and the negotiated cipher support
+// it. Otherwise, the connection falls back to encryption by OpenSSL without any error. This only has an effect on
+// Linux with an OpenSSL library built with kTLS support.
+class KernelTls
+{
+public:
+	//  Enables kTLS for an OpenSSL context. This is called by libhttp once the context was created.
+	auto configure(SSL_CTX *context) -> void;
+
+	//  Writes the counters of connections using kTLS in the Prometheus text format
+	//  text the string to append the counters to
+	auto formatMetrics(std::string &text) const -> void;
+
+private:
+	//  Counts the connections that use kTLS once their handshake is complete
+	auto handshakeDone(const SSL *connection) noexcept -> void;
+
+	//  The OpenSSL info callback, which is used to detect completed handshakes
+	static auto staticInfoCallback(const SSL *connection, int where, int value) -> void;
+
+	//  Gets the index of the OpenSSL context data that points to this object
+	static auto dataIndex() -> int;
+
+	//  Gets the index of the OpenSSL connection data that marks connections that were already counted
+	static auto connectionDataIndex() -> int;
+
+	//  The info callback that was registered before, which is called from our own callback
+	void (*_previousInfoCallback)(const SSL *, int, int) { nullptr };
+
+	//  Whether kTLS was enabled
+	bool _enabled { false };
+
+	//  The number of completed handshakes
+	std::atomic<std::uint64_t> _handshakes { 0 };
+
+	//  The number of connections that send using kTLS
+	std::atomic<std::uint64_t> _kernelSend { 0 };
+
+	//  The number of connections that receive using kTLS
+	std::atomic<std::uint64_t> _kernelReceive { 0 };
+};
+
+} // namespace xentara::samples::webService
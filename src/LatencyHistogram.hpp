@@ -0,0 +1,142 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace xentara::samples::webService
+{
+
+//  A histogram of durations with logarithmic buckets, in the style of an HDR histogram. Each power of two is divided
+// into kSubBucketCount linear buckets, so that the relative error of any recorded value is below 1 / kSubBucketCount,
+// no matter how large the value is.
+//
+// The histogram has a single writer thread, which records values without any atomic read-modify-write operations.
+// Other threads may read the counts at any time, and will see values that were recorded recently, but not necessarily
+// the most recent ones.
+class LatencyHistogram
+{
+public:
+	//  The number of bits used for the linear buckets in each power of two
+	static constexpr unsigned kSubBucketBits = 4;
+
+	//  The number of linear buckets in each power of two
+	static constexpr std::uint64_t kSubBucketCount = std::uint64_t(1) << kSubBucketBits;
+
+	//  The highest power of two that can be recorded, in nanoseconds. Larger values are recorded in the last bucket.
+	static constexpr unsigned kMaxExponent = 40;
+
+	//  The number of buckets
+	static constexpr std::size_t kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+
+	//  The counts of all buckets, as collected from one or more histograms
+	struct Counts
+	{
+		//  The number of values in each bucket
+		std::array<std::uint64_t, kBucketCount> _buckets {};
+
+		//  The total number of values
+		std::uint64_t _count { 0 };
+
+		//  The sum of all values, in nanoseconds
+		std::uint64_t _sum { 0 };
+
+		//  Gets a quantile of the values
+		//  quantile the quantile, between 0 and 1
+		//  @return the highest value that falls into the same bucket as the quantile, in nanoseconds, or NaN if there
+		// are no values
+		auto quantile(double quantile) const noexcept -> double
+		{
+			if (_count == 0)
+			{
+				return std::nan("");
+			}
+
+			// Find the bucket containing the value with the requested rank
+			const auto rank = std::max<std::uint64_t>(std::uint64_t(std::ceil(quantile * double(_count))), 1);
+			std::uint64_t seen = 0;
+			for (std::size_t index = 0; index < kBucketCount; ++index)
+			{
+				seen += _buckets[index];
+				if (seen >= rank)
+				{
+					return double(bucketUpperBound(index));
+				}
+			}
+
+			return double(bucketUpperBound(kBucketCount - 1));
+		}
+	};
+
+	//  Gets the index of the bucket a value falls into
+	static constexpr auto bucketIndex(std::uint64_t value) noexcept -> std::size_t
+	{
+		// Small values each get their own bucket
+		if (value < kSubBucketCount)
+		{
+			return std::size_t(value);
+		}
+
+		// Larger values are grouped by their highest bits
+		const auto exponent = std::min<unsigned>(unsigned(std::bit_width(value)) - 1, kMaxExponent);
+		const auto shift = exponent - kSubBucketBits;
+		const auto subBucket = std::min((value >> shift) - kSubBucketCount, kSubBucketCount - 1);
+		return std::size_t((shift + 1) * kSubBucketCount + subBucket);
+	}
+
+	//  Gets the highest value that falls into a bucket
+	static constexpr auto bucketUpperBound(std::size_t index) noexcept -> std::uint64_t
+	{
+		if (index < kSubBucketCount)
+		{
+			return index;
+		}
+
+		const auto shift = index / kSubBucketCount - 1;
+		const auto subBucket = index % kSubBucketCount;
+		return ((kSubBucketCount + subBucket + 1) << shift) - 1;
+	}
+
+	//  Records a value. This must only be called by the writer thread.
+	auto record(std::chrono::nanoseconds duration) noexcept -> void
+	{
+		const auto value = std::uint64_t(std::max<std::chrono::nanoseconds::rep>(duration.count(), 0));
+		increment(_buckets[bucketIndex(value)], 1);
+		increment(_sum, value);
+	}
+
+	//  Adds the counts of this histogram to a set of counts. This may be called from any thread.
+	auto addTo(Counts &counts) const noexcept -> void
+	{
+		for (std::size_t index = 0; index < kBucketCount; ++index)
+		{
+			const auto count = _buckets[index].load(std::memory_order_relaxed);
+			counts._buckets[index] += count;
+			counts._count += count;
+		}
+		counts._sum += _sum.load(std::memory_order_relaxed);
+	}
+
+private:
+	//  Increments a counter that only the writer thread changes
+	static auto increment(std::atomic<std::uint64_t> &counter, std::uint64_t amount) noexcept -> void
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	//  The number of values in each bucket
+	std::array<std::atomic<std::uint64_t>, kBucketCount> _buckets {};
+
+	//  The sum of all values, in nanoseconds
+	std::atomic<std::uint64_t> _sum { 0 };
+};
+
+static_assert(LatencyHistogram::bucketIndex(std::uint64_t(-1)) == LatencyHistogram::kBucketCount - 1);
+
+} // namespace xentara::samples::webService
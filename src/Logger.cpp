@@ -0,0 +1,123 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/utils/string/cat.hpp>
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+auto Logger::parseSeverity(std::u8string_view name) -> std::optional<Severity>
+{
+	if (name == u8"debug"sv)
+	{
+		return Severity::Debug;
+	}
+	else if (name == u8"info"sv)
+	{
+		return Severity::Info;
+	}
+	else if (name == u8"warning"sv)
+	{
+		return Severity::Warning;
+	}
+	else if (name == u8"error"sv)
+	{
+		return Severity::Error;
+	}
+
+	return std::nullopt;
+}
+
+auto Logger::start() -> void
+{
+	_thread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+}
+
+auto Logger::stop() -> void
+{
+	if (_thread.joinable())
+	{
+		_thread.request_stop();
+		_thread.join();
+	}
+
+	// Write anything that was logged after the thread last looked
+	drain();
+}
+
+auto Logger::log(Severity severity, std::string_view message) noexcept -> void
+{
+	// Discard messages that are not important enough
+	if (severity < _minimumSeverity.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	// Copy the message into the ring buffer of this thread, or drop it if the buffer is full
+	bool queued = false;
+	try
+	{
+		queued = _rings.local().tryPush([&](Slot &slot) {
+			const auto size = std::min(message.size(), kMaxMessageSize);
+			std::memcpy(slot._text.data(), message.data(), size);
+			slot._size = std::uint16_t(size);
+		});
+	}
+	catch (...)
+	{
+		// Logging must never fail, so the message is dropped if there is no memory for a ring buffer
+	}
+
+	if (!queued)
+	{
+		_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+auto Logger::drain() -> bool
+{
+	// Collect all messages that are ready
+	_batch.clear();
+	_rings.drain([this](const Slot &slot) { _batch.append(slot._text.data(), slot._size).push_back('\n'); });
+
+	// Report dropped messages
+	if (const auto droppedMessages = _droppedMessages.load(std::memory_order_relaxed);
+		droppedMessages != _reportedDroppedMessages)
+	{
+		_batch += utils::string::cat(droppedMessages - _reportedDroppedMessages, " log messages dropped\n");
+		_reportedDroppedMessages = droppedMessages;
+	}
+
+	if (_batch.empty())
+	{
+		return false;
+	}
+
+	// Write the whole batch at once
+	std::fwrite(_batch.data(), 1, _batch.size(), _output);
+	std::fflush(_output);
+	return true;
+}
+
+auto Logger::run(std::stop_token stopToken) -> void
+{
+	// How long to wait when there was nothing to write. Logging threads never wake this thread up, because that would
+	// cost them a system call.
+	constexpr auto kIdleInterval = 20ms;
+
+	while (!stopToken.stop_requested())
+	{
+		if (!drain())
+		{
+			std::this_thread::sleep_for(kIdleInterval);
+		}
+	}
+}
+
+} // namespace xentara::samples::webService
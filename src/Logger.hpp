@@ -0,0 +1,119 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "RingBuffer.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace xentara::samples::webService
+{
+
+//  An asynchronous logger. Each thread that logs a message gets its own lock-free ring buffer, which is drained by a
+// single background thread that writes the messages in batches. Logging a message never blocks: if the ring buffer
+// of a thread is full, the message is dropped and counted, and the number of dropped messages is reported later.
+class Logger
+{
+public:
+	//  The severity of a message
+	enum class Severity : std::uint8_t
+	{
+		Debug,
+		Info,
+		Warning,
+		Error
+	};
+
+	//  Constructor
+	//  output the stream to write the messages to
+	explicit Logger(std::FILE *output = stdout) : _output(output)
+	{
+	}
+
+	//  Destructor. This stops the background thread and writes any remaining messages.
+	~Logger()
+	{
+		stop();
+	}
+
+	//  Parses a severity from the name used in the configuration
+	//  @return the severity, or std::nullopt if the name is unknown
+	static auto parseSeverity(std::u8string_view name) -> std::optional<Severity>;
+
+	//  Sets the minimum severity of messages to log. Messages with a lower severity are discarded right away.
+	auto setMinimumSeverity(Severity severity) noexcept -> void
+	{
+		_minimumSeverity.store(severity, std::memory_order_relaxed);
+	}
+
+	//  Starts the background thread
+	auto start() -> void;
+
+	//  Stops the background thread, and writes any remaining messages
+	auto stop() -> void;
+
+	//  Logs a message. Messages that are longer than kMaxMessageSize are truncated.
+	auto log(Severity severity, std::string_view message) noexcept -> void;
+
+	//  Gets the total number of messages that were dropped because a ring buffer was full
+	auto droppedMessages() const noexcept -> std::uint64_t
+	{
+		return _droppedMessages.load(std::memory_order_relaxed);
+	}
+
+	//  The maximum size of a single message
+	static constexpr std::size_t kMaxMessageSize = 256;
+
+	//  The number of messages each thread can queue before messages are dropped
+	static constexpr std::size_t kRingCapacity = 128;
+
+private:
+	//  A queued message
+	struct Slot
+	{
+		//  The size of the message
+		std::uint16_t _size;
+
+		//  The message text
+		std::array<char, kMaxMessageSize> _text;
+	};
+
+	//  Writes all queued messages to the output
+	//  @return whether any messages were written
+	auto drain() -> bool;
+
+	//  Drains the ring buffers until a stop is requested
+	auto run(std::stop_token stopToken) -> void;
+
+	//  The stream to write the messages to
+	std::FILE *_output;
+
+	//  The minimum severity of messages to log
+	std::atomic<Severity> _minimumSeverity { Severity::Info };
+
+	//  The ring buffers of the threads that log messages
+	RingBufferSet<Slot, kRingCapacity> _rings;
+
+	//  The number of messages dropped because a ring buffer was full
+	std::atomic<std::uint64_t> _droppedMessages { 0 };
+
+	//  The number of dropped messages that have already been reported
+	std::uint64_t _reportedDroppedMessages { 0 };
+
+	//  The buffer used to collect messages before writing them. This is only used by the thread draining the rings.
+	std::string _batch;
+
+	//  The background thread. This must be the last member, so that it is stopped before anything it uses is
+	// destroyed.
+	std::jthread _thread;
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,128 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "MessagePackWriter.hpp"
+
+#include <bit>
+
+namespace xentara::samples::webService::messagePack
+{
+
+namespace
+{
+	//  The type bytes used
+	constexpr std::uint8_t kFixMap = 0x80;
+	constexpr std::uint8_t kFixString = 0xa0;
+	constexpr std::uint8_t kNil = 0xc0;
+	constexpr std::uint8_t kFalse = 0xc2;
+	constexpr std::uint8_t kTrue = 0xc3;
+	constexpr std::uint8_t kExtension8 = 0xc7;
+	constexpr std::uint8_t kFloat64 = 0xcb;
+	constexpr std::uint8_t kUnsigned64 = 0xcf;
+	constexpr std::uint8_t kSigned64 = 0xd3;
+	constexpr std::uint8_t kString8 = 0xd9;
+	constexpr std::uint8_t kString16 = 0xda;
+	constexpr std::uint8_t kString32 = 0xdb;
+	constexpr std::uint8_t kMap16 = 0xde;
+	constexpr std::uint8_t kMap32 = 0xdf;
+
+	//  The extension type of timestamps, and the size of the 96 bit form
+	constexpr std::int8_t kTimestampType = -1;
+	constexpr std::uint8_t kTimestamp96Size = 12;
+
+	//  Appends an unsigned integer in big endian byte order
+	template <class Value>
+	auto appendBigEndian(std::string &data, Value value) -> void
+	{
+		for (auto shift = int(sizeof(Value) * 8) - 8; shift >= 0; shift -= 8)
+		{
+			data.push_back(char((value >> shift) & 0xff));
+		}
+	}
+} // namespace
+
+auto appendMapHeader(std::string &data, std::size_t size) -> void
+{
+	if (size < 16)
+	{
+		data.push_back(char(kFixMap | size));
+	}
+	else if (size <= 0xffff)
+	{
+		data.push_back(char(kMap16));
+		appendBigEndian(data, std::uint16_t(size));
+	}
+	else
+	{
+		data.push_back(char(kMap32));
+		appendBigEndian(data, std::uint32_t(size));
+	}
+}
+
+auto appendString(std::string &data, std::string_view value) -> void
+{
+	const auto size = value.size();
+	if (size < 32)
+	{
+		data.push_back(char(kFixString | size));
+	}
+	else if (size <= 0xff)
+	{
+		data.push_back(char(kString8));
+		appendBigEndian(data, std::uint8_t(size));
+	}
+	else if (size <= 0xffff)
+	{
+		data.push_back(char(kString16));
+		appendBigEndian(data, std::uint16_t(size));
+	}
+	else
+	{
+		data.push_back(char(kString32));
+		appendBigEndian(data, std::uint32_t(size));
+	}
+	data.append(value);
+}
+
+auto appendNumber(std::string &data, std::int64_t value) -> void
+{
+	data.push_back(char(kSigned64));
+	appendBigEndian(data, std::uint64_t(value));
+}
+
+auto appendNumber(std::string &data, std::uint64_t value) -> void
+{
+	data.push_back(char(kUnsigned64));
+	appendBigEndian(data, value);
+}
+
+auto appendNumber(std::string &data, double value) -> void
+{
+	data.push_back(char(kFloat64));
+	appendBigEndian(data, std::bit_cast<std::uint64_t>(value));
+}
+
+auto appendBoolean(std::string &data, bool value) -> void
+{
+	data.push_back(char(value ? kTrue : kFalse));
+}
+
+auto appendTime(std::string &data, std::chrono::system_clock::time_point value) -> void
+{
+	// The nanoseconds must be positive, even for times before the epoch
+	const auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(value.time_since_epoch());
+	const auto seconds = std::chrono::floor<std::chrono::seconds>(sinceEpoch);
+	const auto nanoseconds = sinceEpoch - seconds;
+
+	data.push_back(char(kExtension8));
+	data.push_back(char(kTimestamp96Size));
+	data.push_back(char(kTimestampType));
+	appendBigEndian(data, std::uint32_t(nanoseconds.count()));
+	appendBigEndian(data, std::uint64_t(seconds.count()));
+}
+
+auto appendNull(std::string &data) -> void
+{
+	data.push_back(char(kNil));
+}
+
+} // namespace xentara::samples::webService::messagePack
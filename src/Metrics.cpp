@@ -0,0 +1,232 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "Metrics.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <utility>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  The prefix of all metric names
+	constexpr auto kPrefix = "xentara_web_service_"sv;
+
+	//  The quantiles reported for each stage
+	constexpr std::array kQuantiles { std::pair { 0.5, "0.5"sv }, std::pair { 0.9, "0.9"sv },
+		std::pair { 0.99, "0.99"sv }, std::pair { 0.999, "0.999"sv } };
+
+	//  Increments a counter that only the calling thread changes
+	auto increment(std::atomic<std::uint64_t> &counter) noexcept -> void
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	//  Checks whether a stage lasts as long as a subscription stays open, so that its duration says nothing about the
+	// performance of the server
+	constexpr auto isSubscriptionStage(RequestStage stage) noexcept -> bool
+	{
+		return stage == RequestStage::Handling || stage == RequestStage::Write || stage == RequestStage::Request;
+	}
+
+	//  Appends an integer to a string
+	auto appendNumber(std::string &text, std::uint64_t value) -> void
+	{
+		char buffer[24];
+		const auto end = std::to_chars(std::begin(buffer), std::end(buffer), value).ptr;
+		text.append(std::begin(buffer), end);
+	}
+
+	//  Appends a duration in nanoseconds to a string, in seconds
+	auto appendSeconds(std::string &text, double nanoseconds) -> void
+	{
+		if (std::isnan(nanoseconds))
+		{
+			text.append("NaN"sv);
+			return;
+		}
+
+		char buffer[32];
+		const auto end = std::to_chars(std::begin(buffer), std::end(buffer), nanoseconds / 1e9).ptr;
+		text.append(std::begin(buffer), end);
+	}
+
+	//  Appends the HELP and TYPE lines of a metric
+	auto appendHeader(std::string &text, std::string_view name, std::string_view type, std::string_view help) -> void
+	{
+		text.append("# HELP "sv).append(kPrefix).append(name).append(" "sv).append(help).append("\n"sv);
+		text.append("# TYPE "sv).append(kPrefix).append(name).append(" "sv).append(type).append("\n"sv);
+	}
+} // namespace
+
+auto Metrics::local() -> ThreadMetrics &
+{
+	auto &metrics = _localMetrics.local();
+	if (!metrics)
+	{
+		// Register new statistics for this thread
+		auto newMetrics = std::make_unique<ThreadMetrics>();
+		std::scoped_lock lock(_mutex);
+		metrics = _threadMetrics.emplace_back(std::move(newMetrics)).get();
+	}
+
+	return *metrics;
+}
+
+auto Metrics::record(const RequestContext &context) noexcept -> void
+{
+	try
+	{
+		auto &metrics = local();
+
+		// Record the durations of the stages that were run
+		for (std::size_t index = 0; index < kRequestStageCount; ++index)
+		{
+			const auto stage = RequestStage(index);
+			if (context.hasStage(stage) && !(context._subscription && isSubscriptionStage(stage)))
+			{
+				metrics._stages[index].record(context.stageTime(stage));
+			}
+		}
+
+		// Only count the authentication result if the request was authenticated at all
+		if (context.hasStage(RequestStage::Authentication))
+		{
+			increment(metrics._authenticationResults[std::size_t(context._authenticationResult)]);
+		}
+
+		increment(metrics._responses[context._status <= kMaxStatus ? context._status : 0]);
+	}
+	catch (...)
+	{
+		// Recording metrics must never fail, so the request is not counted if there is no memory for the statistics
+	}
+}
+
+auto Metrics::recordEvent() noexcept -> void
+{
+	try
+	{
+		increment(local()._events);
+	}
+	catch (...)
+	{
+		// Recording metrics must never fail, so the event is not counted if there is no memory for the statistics
+	}
+}
+
+auto Metrics::format(std::string &text) -> void
+{
+	// Merge the statistics of all threads
+	std::array<LatencyHistogram::Counts, kRequestStageCount> stages;
+	std::array<std::uint64_t, kAuthenticationResultCount> authenticationResults {};
+	std::array<std::uint64_t, kMaxStatus + 1> responses {};
+	std::uint64_t events = 0;
+	{
+		std::scoped_lock lock(_mutex);
+		for (auto &&metrics : _threadMetrics)
+		{
+			for (std::size_t index = 0; index < kRequestStageCount; ++index)
+			{
+				metrics->_stages[index].addTo(stages[index]);
+			}
+			for (std::size_t index = 0; index < kAuthenticationResultCount; ++index)
+			{
+				authenticationResults[index] += metrics->_authenticationResults[index].load(std::memory_order_relaxed);
+			}
+			for (std::size_t index = 0; index <= kMaxStatus; ++index)
+			{
+				responses[index] += metrics->_responses[index].load(std::memory_order_relaxed);
+			}
+			events += metrics->_events.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Write the durations of the stages
+	appendHeader(text, "stage_duration_seconds"sv, "summary"sv, "Time spent in each stage of handling a request."sv);
+	for (std::size_t index = 0; index < kRequestStageCount; ++index)
+	{
+		const auto stageName = requestStageName(RequestStage(index));
+		const auto &counts = stages[index];
+
+		for (auto &&[quantile, quantileName] : kQuantiles)
+		{
+			text.append(kPrefix).append("stage_duration_seconds{stage=\""sv).append(stageName);
+			text.append("\",quantile=\""sv).append(quantileName).append("\"} "sv);
+			appendSeconds(text, counts.quantile(quantile));
+			text.append("\n"sv);
+		}
+
+		text.append(kPrefix).append("stage_duration_seconds_sum{stage=\""sv).append(stageName).append("\"} "sv);
+		appendSeconds(text, double(counts._sum));
+		text.append("\n"sv);
+		text.append(kPrefix).append("stage_duration_seconds_count{stage=\""sv).append(stageName).append("\"} "sv);
+		appendNumber(text, counts._count);
+		text.append("\n"sv);
+	}
+
+	// Write the authentication results
+	appendHeader(text, "authentication_results_total"sv, "counter"sv, "Number of authentication checks by result."sv);
+	for (std::size_t index = 0; index < kAuthenticationResultCount; ++index)
+	{
+		text.append(kPrefix).append("authentication_results_total{result=\""sv);
+		text.append(authenticationResultName(AuthenticationResult(index))).append("\"} "sv);
+		appendNumber(text, authenticationResults[index]);
+		text.append("\n"sv);
+	}
+
+	// Write the status codes that were sent at least once
+	appendHeader(text, "responses_total"sv, "counter"sv, "Number of responses by HTTP status code."sv);
+	for (std::size_t status = 0; status <= kMaxStatus; ++status)
+	{
+		if (responses[status] == 0)
+		{
+			continue;
+		}
+
+		text.append(kPrefix).append("responses_total{code=\""sv);
+		appendNumber(text, status);
+		text.append("\"} "sv);
+		appendNumber(text, responses[status]);
+		text.append("\n"sv);
+	}
+
+	// Write the load of the worker threads. If the peak reaches the number of worker threads, requests had to wait for
+	// a free worker thread.
+	formatGauge(text, "busy_workers"sv, "Number of worker threads currently handling a request."sv,
+		_busyWorkers.load(std::memory_order_relaxed));
+	formatGauge(text, "busy_workers_peak"sv, "Highest number of worker threads handling a request at the same time."sv,
+		_peakBusyWorkers.load(std::memory_order_relaxed));
+	if (_workerThreads != 0)
+	{
+		formatGauge(text, "worker_threads"sv, "Number of worker threads."sv, _workerThreads);
+	}
+
+	// Write the statistics about event subscriptions. Each subscription keeps a worker thread busy.
+	formatGauge(text, "event_subscriptions"sv, "Number of open event subscriptions."sv,
+		_subscriptions.load(std::memory_order_relaxed));
+	formatCounter(text, "events_total"sv, "Number of events sent to subscribers."sv, events);
+}
+
+auto Metrics::formatGauge(std::string &text, std::string_view name, std::string_view help, std::uint64_t value)
+	-> void
+{
+	appendHeader(text, name, "gauge"sv, help);
+	text.append(kPrefix).append(name).append(" "sv);
+	appendNumber(text, value);
+	text.append("\n"sv);
+}
+
+auto Metrics::formatCounter(std::string &text, std::string_view name, std::string_view help, std::uint64_t value)
+	-> void
+{
+	appendHeader(text, name, "counter"sv, help);
+	text.append(kPrefix).append(name).append(" "sv);
+	appendNumber(text, value);
+	text.append("\n"sv);
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,135 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "AuthenticationResult.hpp"
+#include "LatencyHistogram.hpp"
+#include "PerThread.hpp"
+#include "RequestContext.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xentara::samples::webService
+{
+
+//  Collects statistics about the requests handled by the server, and formats them for Prometheus.
+//
+// Each worker thread records its requests in its own set of histograms and counters, so that recording a request
+// needs no locks and no atomic read-modify-write operations. The data of all threads is only merged when the metrics
+// are scraped.
+class Metrics
+{
+public:
+	//  Records the statistics of a request. This never blocks, except the first time a thread records a request.
+	auto record(const RequestContext &context) noexcept -> void;
+
+	//  Marks the start of a request, to track how many worker threads are busy. Unlike the other statistics, this uses
+	// a counter shared by all threads.
+	auto beginRequest() noexcept -> void
+	{
+		const auto busyWorkers = _busyWorkers.fetch_add(1, std::memory_order_relaxed) + 1;
+
+		// Update the peak only if it was exceeded, which rarely happens once the server is running
+		auto peak = _peakBusyWorkers.load(std::memory_order_relaxed);
+		while (busyWorkers > peak &&
+			   !_peakBusyWorkers.compare_exchange_weak(peak, busyWorkers, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	//  Marks the end of a request
+	auto endRequest() noexcept -> void
+	{
+		_busyWorkers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	//  Marks the start of an event subscription
+	auto beginSubscription() noexcept -> void
+	{
+		_subscriptions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//  Marks the end of an event subscription
+	auto endSubscription() noexcept -> void
+	{
+		_subscriptions.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	//  Counts an event sent to a subscriber. This never blocks, except the first time a thread records anything.
+	auto recordEvent() noexcept -> void;
+
+	//  Sets the number of worker threads, for comparison with the number of busy worker threads
+	//  workerThreads the number of worker threads, or 0 if it is not known
+	auto setWorkerThreads(std::uint32_t workerThreads) noexcept -> void
+	{
+		_workerThreads = workerThreads;
+	}
+
+	//  Writes all metrics in the Prometheus text format
+	//  text the string to append the metrics to
+	auto format(std::string &text) -> void;
+
+	//  Writes a single gauge in the Prometheus text format
+	//  text the string to append the gauge to
+	static auto formatGauge(std::string &text, std::string_view name, std::string_view help, std::uint64_t value)
+		-> void;
+
+	//  Writes a single counter in the Prometheus text format
+	//  text the string to append the counter to
+	static auto formatCounter(std::string &text, std::string_view name, std::string_view help, std::uint64_t value)
+		-> void;
+
+	//  The highest HTTP status code that is counted separately
+	static constexpr std::size_t kMaxStatus = 599;
+
+private:
+	//  The statistics recorded by a single worker thread
+	struct ThreadMetrics
+	{
+		//  The durations of each stage
+		std::array<LatencyHistogram, kRequestStageCount> _stages;
+
+		//  The number of requests with each authentication result
+		std::array<std::atomic<std::uint64_t>, kAuthenticationResultCount> _authenticationResults {};
+
+		//  The number of responses with each status code. Invalid status codes are counted as 0.
+		std::array<std::atomic<std::uint64_t>, kMaxStatus + 1> _responses {};
+
+		//  The number of events sent to subscribers
+		std::atomic<std::uint64_t> _events { 0 };
+	};
+
+	//  Gets the statistics of the calling thread, creating them if necessary
+	auto local() -> ThreadMetrics &;
+
+	//  The statistics of each thread
+	PerThread<ThreadMetrics *> _localMetrics;
+
+	//  The number of requests currently being handled. This is on its own cache line, because all threads change it.
+	alignas(64) std::atomic<std::uint32_t> _busyWorkers { 0 };
+
+	//  The highest number of requests that were handled at the same time
+	alignas(64) std::atomic<std::uint32_t> _peakBusyWorkers { 0 };
+
+	//  The number of open event subscriptions
+	alignas(64) std::atomic<std::uint32_t> _subscriptions { 0 };
+
+	//  The number of worker threads, or 0 if it is not known
+	std::uint32_t _workerThreads { 0 };
+
+	//  Protects _threadMetrics
+	std::mutex _mutex;
+
+	//  The statistics of all threads. These are never removed, so that requests handled by threads that have exited
+	// are still counted.
+	std::vector<std::unique_ptr<ThreadMetrics>> _threadMetrics;
+};
+
+} // namespace xentara::samples::webService
@@ -3,28 +3,42 @@
 #include "OpenIdAuthenticationProvider.hpp"
 #include "HttpError.hpp"
 
-#ifdef _MSC_VER
-#	pragma warning(push)
-#	pragma warning(disable : 4242)
-#endif
+#include <algorithm>
+#include <functional>
 
-#ifdef __GNUC__
-#	pragma GCC diagnostic push
-#	pragma GCC diagnostic ignored "-Wold-style-cast"
-#endif
+namespace xentara::samples::webService
+{
 
-#include <jwt-cpp/jwt.h>
+namespace
+{
+	//  Gets the current time in Unix format in seconds
+	auto currentTime() -> std::int64_t
+	{
+		return std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now())
+			.time_since_epoch()
+			.count();
+	}
 
-#if defined (_MSC_VER)
-#	pragma warning(pop)
-#endif
+	//  Checks if a claim is a string with a specific value
+	auto isString(const JsonView &value, std::string_view expected, std::string &scratch) -> bool
+	{
+		return value.asString(scratch) == expected;
+	}
 
-#ifdef __GNUC__
-#	pragma GCC diagnostic pop
-#endif
+	//  Checks if a claim is a string with a specific value, or an array containing such a string
+	auto containsString(const JsonView &value, std::string_view expected, std::string &scratch) -> bool
+	{
+		if (value.isArray())
+		{
+			bool found = false;
+			value.forEachElement(
+				[&](const JsonView &element) { found = found || isString(element, expected, scratch); });
+			return found;
+		}
 
-namespace xentara::samples::webService
-{
+		return isString(value, expected, scratch);
+	}
+} // namespace
 
 auto OpenIdAuthenticationProvider::loadConfig(utils::json::decoder::Object &jsonObject) -> void
 {
@@ -79,7 +93,7 @@ auto OpenIdAuthenticationProvider::loadConfig(utils::json::decoder::Object &json
 			}
 
 			// Store issuer
-			_issuer = issuer;
+			_issuer = std::string(issuer.begin(), issuer.end());
 		}
 		else if (key == u8"audience")
 		{
@@ -94,7 +108,7 @@ auto OpenIdAuthenticationProvider::loadConfig(utils::json::decoder::Object &json
 			}
 
 			// Store audience
-			_audience = audience;
+			_audience = std::string(audience.begin(), audience.end());
 		}
 		else if (key == u8"claims")
 		{
@@ -102,7 +116,7 @@ auto OpenIdAuthenticationProvider::loadConfig(utils::json::decoder::Object &json
 			auto claims = value.asObject();
 
 			// Load Claims
-			loadClaims(claims);
+			loadClaims(claims, _claims);
 		}
 		else if (key == u8"verification")
 		{
@@ -112,6 +126,16 @@ auto OpenIdAuthenticationProvider::loadConfig(utils::json::decoder::Object &json
 			// Load verification details
 			_verification = AbstractTokenVerification::load(verification);
 		}
+		else if (key == u8"tokenCacheSize")
+		{
+			// The size of the token cache is a number, and 0 disables the cache
+			_tokenCacheSize = value.asNumber<std::size_t>();
+		}
+		else if (key == u8"rejectedTokenCacheSize")
+		{
+			// The size of the cache of rejected tokens is a number, and 0 disables the cache
+			_rejectedTokenCacheSize = value.asNumber<std::size_t>();
+		}
 		else
 		{
 			config::throwUnknownParameterError(key);
@@ -165,7 +189,38 @@ auto OpenIdAuthenticationProvider::buildAuthenticationHeader() -> void
 	return;
 }
 
-auto OpenIdAuthenticationProvider::loadClaims(utils::json::decoder::Object &jsonObject) -> void
+auto OpenIdAuthenticationProvider::buildErrorResponses() -> void
+{
+	// Adds the response for a result
+	auto add = [this](AuthenticationResult result, std::string_view responseCode, std::string_view message,
+				   std::string_view extraHeaderFiels) {
+		_errorResponses[std::size_t(result)].emplace(responseCode, message, extraHeaderFiels);
+	};
+
+	add(AuthenticationResult::MissingAuthorization,
+		"401 Unauthorized",
+		"Authentication required",
+		_wwwAuthernicateHeader);
+	add(AuthenticationResult::DuplicateAuthorization, "400 Bad Request", {},
+		_wwwAuthernicateHeader + " error_code=\"invalid_request\" error_message=\"Duplicate Authorization header\"");
+	add(AuthenticationResult::EmptyAuthorization, "400 Bad Request", {},
+		_wwwAuthernicateHeader + " error_code=\"invalid_request\" error_message=\"Empty authentication field\"");
+	add(AuthenticationResult::UnsupportedMethod, "400 Bad Request", {},
+		_wwwAuthernicateHeader +
+			" error_code=\"invalid_request\" error_message=\"Unsupported authentication method\"");
+	add(AuthenticationResult::MalformedToken, "400 invalid token", "access denied", _wwwAuthernicateHeader);
+	add(AuthenticationResult::NotYetValid, "401 invalid token", "token not valid yet", _wwwAuthernicateHeader);
+	add(AuthenticationResult::Expired, "401 invalid token", "token expired", _wwwAuthernicateHeader);
+	add(AuthenticationResult::MissingAudience, "400 invalid scope", "incorrect audience", _wwwAuthernicateHeader);
+	add(AuthenticationResult::WrongAudience, "403 invalid token", "incorrect audience", _wwwAuthernicateHeader);
+	add(AuthenticationResult::WrongIssuer, "403 invalid scope", "access denied", _wwwAuthernicateHeader);
+	add(AuthenticationResult::UnknownKey, "401 invalid token", "Jwt verification failed", _wwwAuthernicateHeader);
+	add(AuthenticationResult::InvalidSignature, "401 invalid token", "Jwt verification failed", _wwwAuthernicateHeader);
+	add(AuthenticationResult::ClaimsMismatch, "403 invalid scope", "access denied", _wwwAuthernicateHeader);
+}
+
+auto OpenIdAuthenticationProvider::loadClaims(utils::json::decoder::Object &jsonObject, StringMap<StringSet> &claims)
+	-> void
 {
 	// Go through all the parameters
 	for (auto &&[key, value] : jsonObject)
@@ -174,7 +229,7 @@ auto OpenIdAuthenticationProvider::loadClaims(utils::json::decoder::Object &json
 		std::string claimType = std::string(key.begin(), key.end());
 
 		// Check if the given key has been added already in the of claims set
-		if (_claims.count(claimType))
+		if (claims.count(claimType))
 		{
 			utils::json::decoder::throwWithLocation(value,
 				std::runtime_error(std::string("dublicated items in claims not allowed : item \"" +
@@ -182,7 +237,7 @@ auto OpenIdAuthenticationProvider::loadClaims(utils::json::decoder::Object &json
 		}
 
 		// create a set of a type claim
-		std::unordered_set<std::string> claim;
+		StringSet claim;
 
 		// value is an array
 		auto titleArray = value.asArray();
@@ -199,7 +254,7 @@ auto OpenIdAuthenticationProvider::loadClaims(utils::json::decoder::Object &json
 		}
 
 		// add the claim to claims
-		_claims.emplace(claimType, std::move(claim));
+		claims.emplace(claimType, std::move(claim));
 	}
 
 	return;
@@ -270,221 +325,352 @@ std::optional<std::string> OpenIdAuthenticationProvider::getRealmError(std::u8st
 	return std::nullopt;
 }
 
-auto OpenIdAuthenticationProvider::decodeJwt(const std::string &encodedToken) -> JwtToken
+auto OpenIdAuthenticationProvider::extractClaims(const DecodedJwt &token) -> std::optional<TokenClaims>
 {
-	try
-	{
-		// Decode the token
-		return jwt::decode(encodedToken);
-	}
-	catch (...)
-	{
-		// Thows exeption if the token after decoding is not valid
-		throw HttpError("400 invalid token", "access denied" , _wwwAuthernicateHeader);
-	}
-}
+	using namespace std::literals;
 
-auto OpenIdAuthenticationProvider::checkDate(const JwtToken &token) -> void
-{
-	std::optional<std::uint64_t> expirationTime;
-	std::optional<std::uint64_t> notBefore;
+	TokenClaims claims;
+	bool validDates = true;
 
-	// Get the current time in Unix format to seconds
-	auto now =
-		std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now()).time_since_epoch().count();
+	// Buffer for unescaping strings, if they contain escape sequences
+	thread_local std::string scratch;
 
-	// Go through all the claims
-	for (auto &&[key, value] : token.get_payload_claims())
-	{
-		// If not before found
-		if (key == "nbf")
+	// Go through all the claims once
+	token.payload().forEachMember([&](const JsonView &key, const JsonView &value) {
+		// If not before or expiration time found
+		if (key.text() == "nbf"sv || key.text() == "exp"sv)
 		{
-			notBefore = value.as_int();
-		}
+			auto date = value.asInteger();
 
-		// If expiration time found
-		if (key == "exp")
+			// The dates must be numbers
+			if (!date)
+			{
+				validDates = false;
+			}
+
+			(key.text() == "nbf"sv ? claims._notBefore : claims._expirationTime) = date;
+		}
+		// If the issuer is found
+		else if (key.text() == "iss"sv)
 		{
-			expirationTime = value.as_int();
+			claims._hasIssuer = true;
+			claims._issuerMatches = isString(value, _issuer, scratch);
 		}
-	}
-
-	// If not before found
-	if (notBefore.has_value())
-	{
-		// Through exeption if the token is not valid yet
-		if (now < notBefore)
+		// If the audience is found. The audience may be a single string or an array of strings.
+		else if (key.text() == "aud"sv)
 		{
-			throw HttpError("401 invalid token", "token not valid yet", _wwwAuthernicateHeader);
+			claims._hasAudience = true;
+			claims._audienceMatches = containsString(value, _audience, scratch);
 		}
-	}
-
-	// If expiration time is found
-	if (expirationTime.has_value())
-	{		
-		// Through exeptio if the token expired
-		if (now > expirationTime)
+		// If the subject is found, remember it for the access log, and hash all of it for the rate limiter, because
+		// the subject kept for the access log may be truncated
+		else if (key.text() == "sub"sv)
 		{
-			throw HttpError("401 invalid token", "token expired", _wwwAuthernicateHeader);
+			if (const auto subject = value.asString(scratch))
+			{
+				claims._subject.assign(*subject);
+				if (!subject->empty())
+				{
+					const auto hash = std::uint64_t(std::hash<std::string_view>()(*subject));
+					claims._subjectHash = hash != 0 ? hash : 1;
+				}
+			}
 		}
-	}
-	return;
-}
 
-auto OpenIdAuthenticationProvider::checkAudience(const JwtToken &token) -> void
-{
+		// Only look at the name of the claim if there are claims left to check. The rate limits only need to be
+		// checked up to the first one that already matched.
+		const auto rateLimitCount = claims._rateLimit > 0 ? claims._rateLimit - 1 : _rateLimitClaims.size();
+		if ((claims._claimsMatch || _claims.empty()) && rateLimitCount == 0)
+		{
+			return;
+		}
+		const auto claimName = key.asString(scratch);
+		if (!claimName)
+		{
+			return;
+		}
 
-	// Go through all the claims
-	for (auto &&[key, value] : token.get_payload_claims())
-	{
-		// if the audience is found
-		if (key == "aud")
+		// Check if this is one of the configured claims. These can also be standard claims like "sub".
+		if (!claims._claimsMatch && !_claims.empty())
 		{
-			// Check if the audience matches matches with servers otherwise throw exeption
-			if (value.to_json().to_str() == std::string(_audience.begin(), _audience.end()))
+			if (auto allowedValues = _claims.find(*claimName); allowedValues != _claims.end())
 			{
-				return;
+				claims._claimsMatch = checkClaimValue(value, allowedValues->second);
 			}
-			else
+		}
+
+		// Check if the claim selects a rate limit
+		for (std::size_t index = 0; index < rateLimitCount; ++index)
+		{
+			const auto &limitClaims = _rateLimitClaims[index];
+			if (auto allowedValues = limitClaims.find(*claimName);
+				allowedValues != limitClaims.end() && checkClaimValue(value, allowedValues->second))
 			{
-				throw HttpError("403 invalid token", "incorrect audience", _wwwAuthernicateHeader);
+				claims._rateLimit = index + 1;
+				break;
 			}
 		}
+	});
+
+	// The token is malformed if the dates are invalid
+	if (!validDates)
+	{
+		return std::nullopt;
 	}
 
-	// Throw exeption when the audience is missing from the client's token
-	throw HttpError("400 invalid scope", "incorrect audience", _wwwAuthernicateHeader);
+	return claims;
 }
 
-auto OpenIdAuthenticationProvider::checkIssuer(const JwtToken &token) -> void
+auto OpenIdAuthenticationProvider::checkDate(const VerifiedToken &verifiedToken, std::int64_t now)
+	-> AuthenticationResult
 {
-	// Go through all the claims
-	for (auto &&[key, value] : token.get_payload_claims())
-	{			
-		// if issuer found
-		if (key == "iss")
-		{			
-			// check if the issuer matches with servers issuer otherwise throw exeption
-			if (value.to_json().to_str() == std::string(_issuer.begin(), _issuer.end()))
-			{
-				return;
-			}
-			else
-			{
-				throw HttpError("403 invalid scope", "access denied", _wwwAuthernicateHeader);
-			}
+	// If not before found
+	if (verifiedToken._notBefore.has_value())
+	{
+		// Reject the token if it is not valid yet
+		if (now < *verifiedToken._notBefore)
+		{
+			return AuthenticationResult::NotYetValid;
 		}
+	}
 
+	// If expiration time is found
+	if (verifiedToken._expirationTime.has_value())
+	{
+		// Reject the token if it expired
+		if (now > *verifiedToken._expirationTime)
+		{
+			return AuthenticationResult::Expired;
+		}
 	}
 
-	// Throw exeption when the issuer is missing from the client's token
-	throw HttpError("403 invalid scope", "access denied", _wwwAuthernicateHeader);
+	return AuthenticationResult::Success;
 }
 
-auto OpenIdAuthenticationProvider::checkSignature(const JwtToken &token) -> void
+auto OpenIdAuthenticationProvider::checkAudience(const TokenClaims &claims) -> AuthenticationResult
 {
-	try
+	// Reject the token when the audience is missing from the client's token
+	if (!claims._hasAudience)
 	{
-		// Verifies if the signature is valid
-		_verification.get()->verify(token);
+		return AuthenticationResult::MissingAudience;
 	}
-	catch (...)
+
+	// Check if the audience matches matches with servers
+	if (!claims._audienceMatches)
 	{
-		// Throw exeption if any verification issue
-		throw HttpError("401 invalid token", "Jwt verification failed", _wwwAuthernicateHeader);
+		return AuthenticationResult::WrongAudience;
 	}
+
+	return AuthenticationResult::Success;
 }
 
-auto OpenIdAuthenticationProvider::checkClaims(const JwtToken &token) -> void
+auto OpenIdAuthenticationProvider::checkIssuer(const TokenClaims &claims) -> AuthenticationResult
 {
-	// If no claims were specified, all tokens pass
-	if (_claims.empty())
+	// Reject the token when the issuer is missing from the client's token, or does not match the servers issuer
+	if (!claims._hasIssuer || !claims._issuerMatches)
 	{
-		return;
+		return AuthenticationResult::WrongIssuer;
 	}
 
-	// Check if at least one claim title is present
-	for (auto &&claim : _claims)
+	return AuthenticationResult::Success;
+}
+
+auto OpenIdAuthenticationProvider::checkSignature(const DecodedJwt &token) -> AuthenticationResult
+{
+	// Verifies if the signature is valid
+	return _verification->verify(token);
+}
+
+auto OpenIdAuthenticationProvider::checkClaims(const TokenClaims &claims) -> AuthenticationResult
+{
+	// If no claims were specified, all tokens pass. Otherwise, at least one claim must match.
+	if (!_claims.empty() && !claims._claimsMatch)
 	{
-		// Check the names for this title
-		if (checkClaim(token, claim.first, claim.second))
-		{
-			return;
-		}
+		return AuthenticationResult::ClaimsMismatch;
 	}
 
-	// No matching claims were found
-	throw HttpError("403 invalid scope", "access denied" , _wwwAuthernicateHeader);
+	return AuthenticationResult::Success;
 }
 
-auto OpenIdAuthenticationProvider::checkClaim(
-	const JwtToken &token, const std::string &claim, const std::unordered_set<std::string> &allowedValues) -> bool
+auto OpenIdAuthenticationProvider::checkClaimValue(const JsonView &value, const StringSet &allowedValues) -> bool
 {
-
-	// Get the token
-	if (!token.has_payload_claim(claim))
+	// Handle array separately
+	if (value.isArray())
 	{
-		return false;
+		bool found = false;
+		value.forEachElement(
+			[&](const JsonView &element) { found = found || checkClaimValue(element, allowedValues); });
+		return found;
 	}
 
-	// Get the claim's value
-	auto value = token.get_payload_claim(claim).to_json();
+	// Buffer for unescaping strings, if they contain escape sequences
+	thread_local std::string scratch;
 
-	// Handle array separately
-	if (value.is<picojson::array>())
+	// check if the claim value is found in the server
+	const auto string = value.asString(scratch);
+	return string && allowedValues.find(*string) != allowedValues.end();
+}
+
+auto OpenIdAuthenticationProvider::checkJwt(std::string_view encodedToken, RequestContext &context)
+	-> AuthenticationResult
+{
+	const auto now = currentTime();
+	auto stageStart = std::chrono::steady_clock::now();
+
+	// If the token has already been verified with the current keys, only the dates need to be checked. Tokens
+	// verified with older keys are verified again, because the key that signed them may have been removed.
+	const auto keyGeneration = _verification->keyGeneration();
+	if (_tokenCache)
 	{
-		for (auto &&element : value.get<picojson::array>())
+		if (auto verifiedToken = _tokenCache->find(encodedToken, now);
+			verifiedToken && verifiedToken->_keyGeneration == keyGeneration)
 		{
-			if (checkClaimValue(element, allowedValues))
+			context.recordStage(RequestStage::TokenCache, stageStart);
+			const auto result = checkDate(*verifiedToken, now);
+			context.recordStage(RequestStage::DateCheck, stageStart);
+			if (result == AuthenticationResult::Success)
 			{
-				return true;
+				context._subject = verifiedToken->_subject;
+				context._subjectHash = verifiedToken->_subjectHash;
+				context._rateLimit = verifiedToken->_rateLimit;
 			}
+			return result;
 		}
 	}
-	else
+
+	// If the token was rejected recently, reject it again right away, unless the keys changed in the meantime
+	if (_rejectedTokenCache)
 	{
-		if (checkClaimValue(value, allowedValues))
+		if (auto rejectedToken = _rejectedTokenCache->find(encodedToken, now);
+			rejectedToken && rejectedToken->_keyGeneration == keyGeneration)
 		{
-			return true;
+			context.recordStage(RequestStage::TokenCache, stageStart);
+			return rejectedToken->_result;
 		}
 	}
-	// nothing matched
-	return false;
-}
+	if (_tokenCache || _rejectedTokenCache)
+	{
+		context.recordStage(RequestStage::TokenCache, stageStart);
+	}
 
-auto OpenIdAuthenticationProvider::checkClaimValue(
-	const JwtClaimValue &value, const std::unordered_set<std::string> &allowedValues) -> bool
-{
-	// check if the claim value is found in the server
-	return value.is<std::string>() && allowedValues.find(value.get<std::string>()) != allowedValues.end();
+	// Verify the token, and remember it if it is rejected
+	auto retryTime = now + kRejectionLifetime;
+	const auto result = verifyJwt(encodedToken, now, keyGeneration, retryTime, context, stageStart);
+	if (result != AuthenticationResult::Success && _rejectedTokenCache && retryTime >= now)
+	{
+		_rejectedTokenCache->insert(encodedToken, RejectedToken { result, keyGeneration }, retryTime, now);
+	}
+
+	return result;
 }
 
-auto OpenIdAuthenticationProvider::checkJwt(const std::string &encodedToken) -> void
+auto OpenIdAuthenticationProvider::verifyJwt(std::string_view encodedToken,
+	std::int64_t now,
+	std::uint64_t keyGeneration,
+	std::int64_t &retryTime,
+	RequestContext &context,
+	std::chrono::steady_clock::time_point &stageStart) -> AuthenticationResult
 {
+	// Decode the header of the token. The buffer is reused for all tokens decoded on this thread.
+	thread_local std::string buffer;
+	auto token = DecodedJwt::decodeHeader(encodedToken, buffer);
+	if (!token)
+	{
+		context.recordStage(RequestStage::Decode, stageStart);
+		return AuthenticationResult::MalformedToken;
+	}
 
-	// Decode the token
-	auto token = decodeJwt(encodedToken);
+	// Reject tokens with an unknown key ID or algorithm before decoding the rest of the token
+	if (!_verification->precheck(*token))
+	{
+		context.recordStage(RequestStage::Decode, stageStart);
+		return AuthenticationResult::UnknownKey;
+	}
+
+	// Decode the rest of the token
+	if (!token->decodeBody())
+	{
+		context.recordStage(RequestStage::Decode, stageStart);
+		return AuthenticationResult::MalformedToken;
+	}
+
+	// Collect the claims that need to be checked
+	const auto claims = extractClaims(*token);
+	context.recordStage(RequestStage::Decode, stageStart);
+	if (!claims)
+	{
+		return AuthenticationResult::MalformedToken;
+	}
+	// A token that is not valid yet must not be rejected any longer than until it becomes valid
+	if (claims->_notBefore && *claims->_notBefore > now)
+	{
+		retryTime = std::min(retryTime, *claims->_notBefore - 1);
+	}
 
 	// Check the not before and expiration Time
-	checkDate(token); 
-	
-	// Check if the audience is found and if it matches with the servers
-	checkAudience(token);
+	const VerifiedToken verifiedToken { claims->_notBefore, claims->_expirationTime, claims->_subject,
+		claims->_subjectHash, claims->_rateLimit, keyGeneration };
+	const auto dateResult = checkDate(verifiedToken, now);
+	context.recordStage(RequestStage::DateCheck, stageStart);
+	if (dateResult != AuthenticationResult::Success)
+	{
+		return dateResult;
+	}
 
 	// Check if the audience is found and if it matches with the servers
-	checkIssuer(token);
+	const auto audienceResult = checkAudience(*claims);
+	context.recordStage(RequestStage::AudienceCheck, stageStart);
+	if (audienceResult != AuthenticationResult::Success)
+	{
+		return audienceResult;
+	}
+
+	// Check if the issuer is found and if it matches with the servers
+	const auto issuerResult = checkIssuer(*claims);
+	context.recordStage(RequestStage::IssuerCheck, stageStart);
+	if (issuerResult != AuthenticationResult::Success)
+	{
+		return issuerResult;
+	}
 
 	// Check if the signature is valid
-	checkSignature(token);
+	const auto signatureResult = checkSignature(*token);
+	context.recordStage(RequestStage::Signature, stageStart);
+	if (signatureResult != AuthenticationResult::Success)
+	{
+		return signatureResult;
+	}
 
 	// Check if any claims are found and if it matches with the servers
-	checkClaims(token);
+	const auto claimsResult = checkClaims(*claims);
+	context.recordStage(RequestStage::ClaimsCheck, stageStart);
+	if (claimsResult != AuthenticationResult::Success)
+	{
+		return claimsResult;
+	}
+
+	// Only take the subject from a token that passed all checks, so that rejected tokens cannot put an arbitrary
+	// subject into the access log
+	context._subject = claims->_subject;
+	context._subjectHash = claims->_subjectHash;
+	context._rateLimit = claims->_rateLimit;
+
+	// Remember the token until it expires. Tokens without an expiration time are not cached, because
+	// they would never be removed again.
+	if (_tokenCache && verifiedToken._expirationTime)
+	{
+		_tokenCache->insert(encodedToken, verifiedToken, *verifiedToken._expirationTime, now);
+	}
+
+	return AuthenticationResult::Success;
 }
 
-auto OpenIdAuthenticationProvider::checkAuthentication(const lh_rqi_t *request) -> void
+auto OpenIdAuthenticationProvider::checkAuthentication(const lh_rqi_t *request, RequestContext &context)
+	-> AuthenticationResult
 {
 	using namespace std::literals;
 
+	const auto scanStart = std::chrono::steady_clock::now();
 	std::optional<std::string_view> authorization;
 
 	// Iterate through all the headers received
@@ -497,45 +683,36 @@ auto OpenIdAuthenticationProvider::checkAuthentication(const lh_rqi_t *request)
 			// check if the authorization header is already stored
 			if (authorization)
 			{
-				throw HttpError("400 Bad Request",
-					{},
-					_wwwAuthernicateHeader +
-						" error_code=\"invalid_request\" error_message=\"Duplicate Authorization header\"");
+				return AuthenticationResult::DuplicateAuthorization;
 			}
 
 			// store the content of the authorization header
 			authorization = request->http_headers[i].value;
 		}
 	}
+	context.recordStage(RequestStage::HeaderScan, std::chrono::steady_clock::now() - scanStart);
 
 	// check if the content is empty
 	if (!authorization)
 	{
-		throw HttpError("401 Unauthorized", "Authentication required", _wwwAuthernicateHeader);
+		return AuthenticationResult::MissingAuthorization;
 	}
 
 	// check if authentication header is found
 	if (authorization->empty())
 	{
-		throw HttpError("400 Bad Request",
-			{},
-			_wwwAuthernicateHeader + " error_code=\"invalid_request\" error_message=\"Empty authentication field\"");
+		return AuthenticationResult::EmptyAuthorization;
 	}
 
 	// check if Bearer authentication header is found
 	static const auto kTokenKey = "Bearer "sv;
 	if (!authorization->starts_with(kTokenKey))
 	{
-		throw HttpError("400 Bad Request",
-			{},
-			_wwwAuthernicateHeader +
-				" error_code=\"invalid_request\" error_message=\"Unsupported authentication method\"");
+		return AuthenticationResult::UnsupportedMethod;
 	}
 
 	// check if the JWT token is valid
-	checkJwt(authorization->substr(kTokenKey.size()).data());
-
-	return;
+	return checkJwt(authorization->substr(kTokenKey.size()), context);
 }
 
 auto OpenIdAuthenticationProvider::makeRealm(std::u8string_view string) const -> const std::u8string
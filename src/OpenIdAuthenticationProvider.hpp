@@ -8,16 +8,24 @@
 #include <xentara/utils/json/decoder/Errors.hpp>
 #include <xentara/utils/json/decoder/String.hpp>
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <libhttp.h>
 
 #include "AbstractAuthenticationProvider.hpp"
 #include "AbstractTokenVerification.hpp"
+#include "DecodedJwt.hpp"
+#include "HttpError.hpp"
+#include "JsonView.hpp"
+#include "StringHash.hpp"
+#include "TokenCache.hpp"
 
 
 namespace xentara::samples::webService
@@ -32,22 +40,114 @@ public:
 	// from json file which are required for OpenID authentication
 	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void final;
 
+	// override function from AbstractAuthenticationProvider::setRateLimitClaims(...)
+	auto setRateLimitClaims(std::vector<StringMap<StringSet>> claims) -> void final
+	{
+		_rateLimitClaims = std::move(claims);
+	}
+
 	// override function from AbstractAuthenticationProvider::initialize(). This function initializes the verifiers and
 	// build
-	auto initialize() -> void final
+	auto initialize(Logger &logger) -> void final
 	{
 		// verify the token
-		_verification->initialize();
+		_verification->initialize(logger);
 
 		buildAuthenticationHeader();
+		buildErrorResponses();
+
+		// Create the cache for verified tokens, if enabled
+		if (_tokenCacheSize > 0)
+		{
+			_tokenCache.emplace(_tokenCacheSize);
+		}
+
+		// Create the cache for rejected tokens, if enabled
+		if (_rejectedTokenCacheSize > 0)
+		{
+			_rejectedTokenCache.emplace(_rejectedTokenCacheSize);
+		}
 	}
 
 	// override function from AbstractAuthenticationProvider::checkAuthentication(...)
-	auto checkAuthentication(const lh_rqi_t *request) -> void final;
+	auto checkAuthentication(const lh_rqi_t *request, RequestContext &context) -> AuthenticationResult final;
+
+	// override function from AbstractAuthenticationProvider::errorResponse(...)
+	auto errorResponse(AuthenticationResult result) const -> const HttpError & final
+	{
+		return *_errorResponses[std::size_t(result)];
+	}
+
+	//  Loads claims from a Json Object. Each member is the name of a claim, with an array of the allowed values.
+	//  claims receives the claims
+	static auto loadClaims(utils::json::decoder::Object &jsonObject, StringMap<StringSet> &claims) -> void;
 
 private:
-	//  Load the Claims details from Json Object
-	auto loadClaims(utils::json::decoder::Object &jsonObject) -> void;
+	//  The information about a successfully verified token that is kept in the token cache
+	struct VerifiedToken
+	{
+		//  The not before time of the token, in seconds since the Unix epoch
+		std::optional<std::int64_t> _notBefore;
+
+		//  The expiration time of the token, in seconds since the Unix epoch
+		std::optional<std::int64_t> _expirationTime;
+
+		//  The subject of the token
+		TokenSubject _subject;
+
+		//  The hash of the complete subject of the token, or 0 if the token has no subject
+		std::uint64_t _subjectHash { 0 };
+
+		//  The number of the rate limit selected by the claims of the token, or 0 for the default limit
+		std::size_t _rateLimit { 0 };
+
+		//  The key generation of the verification at the time the token was verified
+		std::uint64_t _keyGeneration { 0 };
+	};
+
+	//  The information about a rejected token that is kept in the cache of rejected tokens
+	struct RejectedToken
+	{
+		//  The reason the token was rejected
+		AuthenticationResult _result;
+
+		//  The key generation of the verification at the time the token was rejected
+		std::uint64_t _keyGeneration;
+	};
+
+	//  The claims of a token that are relevant to the checks
+	struct TokenClaims
+	{
+		//  The not before time of the token, in seconds since the Unix epoch
+		std::optional<std::int64_t> _notBefore;
+
+		//  The expiration time of the token, in seconds since the Unix epoch
+		std::optional<std::int64_t> _expirationTime;
+
+		//  Whether the token contains an issuer
+		bool _hasIssuer { false };
+
+		//  Whether the issuer of the token matches the configured issuer
+		bool _issuerMatches { false };
+
+		//  Whether the token contains an audience
+		bool _hasAudience { false };
+
+		//  Whether the configured audience is one of the audiences of the token
+		bool _audienceMatches { false };
+
+		//  Whether at least one of the configured claims matched
+		bool _claimsMatch { false };
+
+		//  The subject of the token
+		TokenSubject _subject;
+
+		//  The hash of the complete subject of the token, or 0 if the token has no subject
+		std::uint64_t _subjectHash { 0 };
+
+		//  The number of the first rate limit with a matching claim, or 0 for the default limit
+		std::size_t _rateLimit { 0 };
+	};
 
 	//  Checks if the string is empty an all the characters on a string in asci table and accepts
 	// all characters between 0x21 to 0x7F exept 0x22(""") and 0x5C("/")
@@ -64,54 +164,93 @@ private:
 	//  Built the authentication header for error message responce
 	auto buildAuthenticationHeader() -> void;
 
-	//  decode the token
-	auto decodeJwt(const std::string &encodedToken) -> JwtToken;
+	//  Builds the error responses for all authentication results
+	auto buildErrorResponses() -> void;
 
-	//  check the not before and expiration date are valid
-	auto checkDate(const JwtToken &token) -> void;
+	//  Collects all the claims that are checked by the provider in a single pass over the payload
+	//  @return the claims, or std::nullopt if the dates in the token are invalid
+	auto extractClaims(const DecodedJwt &token) -> std::optional<TokenClaims>;
+
+	//  check the not before and expiration date against the current time
+	auto checkDate(const VerifiedToken &verifiedToken, std::int64_t now) -> AuthenticationResult;
 
 	//  check if the audience is valid
-	auto checkAudience(const JwtToken &token) -> void;
+	auto checkAudience(const TokenClaims &claims) -> AuthenticationResult;
 
 	//  Check if the issuer is valid
-	auto checkIssuer(const JwtToken &token) -> void;
+	auto checkIssuer(const TokenClaims &claims) -> AuthenticationResult;
 
 	//  verify the signature
-	auto checkSignature(const JwtToken &token) -> void;
+	auto checkSignature(const DecodedJwt &token) -> AuthenticationResult;
 
 	//  Check the Claim titles
-	auto checkClaims(const JwtToken &token) -> void;
-
-	//  Check if the claim name
-	auto checkClaim(
-		const JwtToken &token, const std::string &claim, const std::unordered_set<std::string> &allowedValues) -> bool;
+	auto checkClaims(const TokenClaims &claims) -> AuthenticationResult;
 
 	//  Check if any claims value found
-	auto checkClaimValue(const JwtClaimValue &value, const std::unordered_set<std::string> &allowedValues) -> bool;
-
-	//  Checks the tokens validity
-	auto checkJwt(const std::string &encodedToken) -> void;
+	auto checkClaimValue(const JsonView &value, const StringSet &allowedValues) -> bool;
+
+	//  Checks the tokens validity, using the caches of verified and rejected tokens
+	//  context receives the subject of the token, if the token is valid, and the durations of the stages
+	auto checkJwt(std::string_view encodedToken, RequestContext &context) -> AuthenticationResult;
+
+	//  Fully verifies a token that is not in any cache. Tokens whose header shows that they cannot be verified are
+	// rejected before the payload is decoded.
+	//  now the current time in seconds since the Unix epoch
+	//  retryTime the time until which a rejection of the token may be remembered. This is lowered if the token may
+	// become valid earlier.
+	//  context receives the subject of the token, if the token is valid, and the durations of the stages
+	//  keyGeneration the key generation of the verification before the token was verified
+	//  stageStart the time the first stage started. This is updated whenever a stage is recorded.
+	auto verifyJwt(std::string_view encodedToken,
+		std::int64_t now,
+		std::uint64_t keyGeneration,
+		std::int64_t &retryTime,
+		RequestContext &context,
+		std::chrono::steady_clock::time_point &stageStart) -> AuthenticationResult;
+
+	//  How long rejected tokens are remembered, in seconds
+	static constexpr std::int64_t kRejectionLifetime = 60;
 
 	//  realm
 	std::optional<std::u8string> _realm;
 
 	//  issuer
-	std::u8string _issuer;
+	std::string _issuer;
 
 	//  audience
-	std::u8string _audience;
+	std::string _audience;
 
 	//  list of scopes
 	std::unordered_set<std::u8string> _scopes;
 
 	//  list of the claims
-	std::unordered_map<std::string, std::unordered_set<std::string>> _claims;
+	StringMap<StringSet> _claims;
+
+	//  The claims that select each rate limit after the default limit
+	std::vector<StringMap<StringSet>> _rateLimitClaims;
 
 	//  authentication header for the error responce
 	std::string _wwwAuthernicateHeader;
 
+	//  The error responses, indexed by the authentication result. There is no response for
+	// AuthenticationResult::Success.
+	std::array<std::optional<HttpError>, kAuthenticationResultCount> _errorResponses;
+
 	//  Verifies the token
 	std::unique_ptr<AbstractTokenVerification> _verification;
+
+	//  The maximum number of verified tokens to keep in the cache, or 0 to disable the cache
+	std::size_t _tokenCacheSize { 4096 };
+
+	//  The cache of verified tokens, so that tokens that are used repeatedly need not be verified again
+	std::optional<TokenCache<VerifiedToken>> _tokenCache;
+
+	//  The maximum number of rejected tokens to keep in the cache, or 0 to disable the cache
+	std::size_t _rejectedTokenCacheSize { 4096 };
+
+	//  The cache of rejected tokens, so that clients sending the same bad token over and over again are rejected
+	// without decoding the token again
+	std::optional<TokenCache<RejectedToken>> _rejectedTokenCache;
 };
 
 } // namespace xentara::samples::webService
@@ -0,0 +1,35 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+namespace xentara::samples::webService
+{
+
+//  Holds a separate instance of a value for each thread that accesses it. The instances are default constructed the
+// first time a thread accesses them, and are destroyed when the thread exits. This is used for objects that are not
+// safe or not efficient to share between the worker threads of the server.
+template <class Value>
+class PerThread
+{
+public:
+	//  Gets the instance for the calling thread
+	auto local() -> Value &
+	{
+		// Each thread has a map of instances for all the PerThread objects of this type
+		thread_local std::unordered_map<std::uint64_t, Value> instances;
+		return instances[_id];
+	}
+
+private:
+	//  The next free ID
+	inline static std::atomic<std::uint64_t> _nextId { 0 };
+
+	//  The unique ID of this object. This is used instead of the address, so that a new object that happens to be
+	// created at the same address does not inherit the instances of an old one.
+	const std::uint64_t _id { _nextId++ };
+};
+
+} // namespace xentara::samples::webService
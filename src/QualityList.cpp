@@ -0,0 +1,83 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "QualityList.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+auto QualityList::next() -> std::optional<Element>
+{
+	while (!_remaining.empty())
+	{
+		// Get the next element
+		const auto end = _remaining.find(',');
+		const auto element = _remaining.substr(0, end);
+		_remaining = end == std::string_view::npos ? std::string_view() : _remaining.substr(end + 1);
+
+		// Split off the parameters
+		const auto parametersStart = element.find(';');
+		const auto value = trim(element.substr(0, parametersStart));
+		if (value.empty())
+		{
+			continue;
+		}
+
+		return Element { ._value = value,
+			._quality =
+				parametersStart == std::string_view::npos ? 1000 : quality(element.substr(parametersStart + 1)) };
+	}
+
+	return std::nullopt;
+}
+
+auto QualityList::trim(std::string_view text) -> std::string_view
+{
+	const auto start = text.find_first_not_of(" \t"sv);
+	if (start == std::string_view::npos)
+	{
+		return {};
+	}
+	return text.substr(start, text.find_last_not_of(" \t"sv) - start + 1);
+}
+
+auto QualityList::equalsIgnoringCase(std::string_view left, std::string_view right) -> bool
+{
+	return std::ranges::equal(left, right, [](char leftCharacter, char rightCharacter) {
+		return std::tolower(static_cast<unsigned char>(leftCharacter)) ==
+			std::tolower(static_cast<unsigned char>(rightCharacter));
+	});
+}
+
+auto QualityList::quality(std::string_view parameters) -> int
+{
+	while (!parameters.empty())
+	{
+		const auto end = parameters.find(';');
+		const auto parameter = trim(parameters.substr(0, end));
+		parameters = end == std::string_view::npos ? std::string_view() : parameters.substr(end + 1);
+
+		if (parameter.size() < 2 || std::tolower(static_cast<unsigned char>(parameter[0])) != 'q' ||
+			parameter[1] != '=')
+		{
+			continue;
+		}
+
+		// The quality has at most three decimals. Values that cannot be parsed are ignored.
+		double value = 1.0;
+		const auto text = parameter.substr(2);
+		const auto [valueEnd, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error == std::errc() && valueEnd == text.data() + text.size() && value >= 0.0 && value <= 1.0)
+		{
+			return int(value * 1000.0 + 0.5);
+		}
+	}
+
+	return 1000;
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,49 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  Goes through the elements of a header value that is a comma separated list of values with optional quality values,
+// like the Accept and Accept-Encoding headers. Other parameters of the elements are ignored.
+class QualityList
+{
+public:
+	//  An element of the list
+	struct Element
+	{
+		//  The value, without parameters and surrounding white space
+		std::string_view _value;
+
+		//  The quality in thousandths, from 0 to 1000. Elements without a valid quality value have a quality of 1000.
+		int _quality;
+	};
+
+	//  Constructor
+	//  header the value of the header. The value is not copied, and must stay valid while the list is used.
+	QualityList(std::string_view header) : _remaining(header)
+	{
+	}
+
+	//  Gets the next element. Empty elements are skipped.
+	//  @return the element, or std::nullopt if there are no more elements
+	auto next() -> std::optional<Element>;
+
+	//  Removes spaces and tabs from both ends of a string
+	static auto trim(std::string_view text) -> std::string_view;
+
+	//  Compares two strings, ignoring the case of ASCII letters
+	static auto equalsIgnoringCase(std::string_view left, std::string_view right) -> bool;
+
+private:
+	//  Gets the quality from the parameters of an element
+	static auto quality(std::string_view parameters) -> int;
+
+	//  The part of the header that was not read yet
+	std::string_view _remaining;
+};
+
+} // namespace xentara::samples::webService
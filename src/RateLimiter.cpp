@@ -0,0 +1,304 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/config/Errors.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "RateLimiter.hpp"
+#include "Metrics.hpp"
+#include "OpenIdAuthenticationProvider.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  Distinguishes the keys of subjects from the keys of addresses that happen to be the same string
+	constexpr std::uint64_t kSubjectSeed = 0x5375626a65637421;
+	constexpr std::uint64_t kAddressSeed = 0x4164647265737321;
+
+	//  Makes the key of a client from a hash. All bits of the key are mixed, because the key is used both to select
+	// the shard and the slot. The key is never 0, which marks free slots.
+	auto makeKey(std::uint64_t hash, std::uint64_t seed) noexcept -> std::uint64_t
+	{
+		// Use the finalizer of SplitMix64 to mix the bits
+		auto key = hash ^ seed;
+		key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+		key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+		key ^= key >> 31;
+		return key != 0 ? key : 1;
+	}
+
+	//  Gets the current time in nanoseconds of the steady clock
+	auto currentTime() noexcept -> std::uint64_t
+	{
+		const auto time = std::chrono::steady_clock::now().time_since_epoch();
+		return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+	}
+} // namespace
+
+auto RateLimiter::loadConfig(utils::json::decoder::Object &jsonObject) -> void
+{
+	// Go through all parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"requestsPerSecond")
+		{
+			_limits.front()._requestsPerSecond = value.asNumber<double>();
+		}
+		else if (key == u8"burst")
+		{
+			_limits.front()._burst = value.asNumber<std::uint32_t>();
+		}
+		else if (key == u8"tableSize")
+		{
+			// The table must be able to hold at least one bucket per shard
+			_tableSize = value.asNumber<std::size_t>();
+			if (_tableSize < kShardCount)
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("tableSize of the rate limit of the Web Service Server must be at least 64"));
+			}
+		}
+		else if (key == u8"limits")
+		{
+			// The limits are an array of objects
+			for (auto &&limit : value.asArray())
+			{
+				auto limitObject = limit.asObject();
+				loadLimit(limitObject);
+			}
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+
+	checkLimit(_limits.front(), jsonObject);
+	_enabled = true;
+}
+
+auto RateLimiter::loadLimit(utils::json::decoder::Object &jsonObject) -> void
+{
+	Limit limit;
+	StringMap<StringSet> claims;
+
+	// Go through all parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"claims")
+		{
+			// The claims have the same form as the claims of the authentication provider
+			auto claimsObject = value.asObject();
+			OpenIdAuthenticationProvider::loadClaims(claimsObject, claims);
+		}
+		else if (key == u8"requestsPerSecond")
+		{
+			limit._requestsPerSecond = value.asNumber<double>();
+		}
+		else if (key == u8"burst")
+		{
+			limit._burst = value.asNumber<std::uint32_t>();
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+
+	// A limit without claims could never be selected
+	if (claims.empty())
+	{
+		utils::json::decoder::throwWithLocation(
+			jsonObject, std::runtime_error("missing claims for a rate limit of the Web Service Server"));
+	}
+	checkLimit(limit, jsonObject);
+
+	_limits.push_back(limit);
+	_claims.push_back(std::move(claims));
+}
+
+auto RateLimiter::checkLimit(Limit &limit, utils::json::decoder::Object &jsonObject) -> void
+{
+	if (!(limit._requestsPerSecond > 0) || !std::isfinite(limit._requestsPerSecond))
+	{
+		utils::json::decoder::throwWithLocation(jsonObject,
+			std::runtime_error("missing or invalid requestsPerSecond for a rate limit of the Web Service Server"));
+	}
+
+	// By default, allow one second worth of requests at once
+	if (limit._burst == 0)
+	{
+		limit._burst = std::uint32_t(std::clamp(std::ceil(limit._requestsPerSecond), 1.0, 4294967295.0));
+	}
+
+	// The time it takes to refill the whole bucket must fit into the times of the buckets, with room to spare for
+	// adding it to the current time
+	if (1e9 / limit._requestsPerSecond * limit._burst > double(kMaxRefillTime))
+	{
+		utils::json::decoder::throwWithLocation(jsonObject,
+			std::runtime_error("requestsPerSecond too low for the burst of a rate limit of the Web Service Server"));
+	}
+}
+
+auto RateLimiter::initialize() -> void
+{
+	// Convert the limits to times
+	_intervals.clear();
+	for (auto &&limit : _limits)
+	{
+		const auto emission = std::max(std::uint64_t(1e9 / limit._requestsPerSecond), std::uint64_t(1));
+		_intervals.push_back({ ._emission = emission, ._tolerance = emission * (limit._burst - 1) });
+	}
+
+	// Create the shards, with a power of two slots each, so that the slot can be selected with a mask
+	const auto slotCount = std::bit_ceil(std::max(_tableSize / kShardCount, kProbeLength));
+	_slotMask = slotCount - 1;
+	_shards = std::make_unique<Shard[]>(kShardCount);
+	for (std::size_t index = 0; index < kShardCount; ++index)
+	{
+		_shards[index]._slots = std::make_unique<Slot[]>(slotCount);
+	}
+}
+
+auto RateLimiter::claims() const -> std::vector<StringMap<StringSet>>
+{
+	return _claims;
+}
+
+auto RateLimiter::retryAfter(std::size_t limit) const noexcept -> std::uint32_t
+{
+	// A client has to wait for one token to be refilled
+	return std::uint32_t(std::clamp(std::ceil(1.0 / _limits[limit]._requestsPerSecond), 1.0, 4294967295.0));
+}
+
+auto RateLimiter::acquire(const lh_rqi_t &request, const RequestContext &context) -> std::optional<std::size_t>
+{
+	// Use the hash of the complete subject of the token if the client was authenticated, and its address otherwise.
+	// Clients that were not authenticated always get the default limit.
+	std::uint64_t key;
+	std::size_t limit = 0;
+	if (context._authenticationResult == AuthenticationResult::Success && context._subjectHash != 0)
+	{
+		key = makeKey(context._subjectHash, kSubjectSeed);
+		limit = std::min(context._rateLimit, _intervals.size() - 1);
+	}
+	else
+	{
+		key = makeKey(std::hash<std::string_view>()(request.remote_addr), kAddressSeed);
+	}
+
+	// The shard is selected by other bits of the key than the slot
+	auto &shard = _shards[(key >> 32) & (kShardCount - 1)];
+	const auto now = currentTime();
+
+	// If no slot can be taken for the client, let the request through rather than rejecting a client that might
+	// not have exceeded its limit
+	auto slot = find(shard, key, now);
+	if (!slot || take(*slot, _intervals[limit], now))
+	{
+		return std::nullopt;
+	}
+
+	shard._rejectedRequests.fetch_add(1, std::memory_order_relaxed);
+	return limit;
+}
+
+auto RateLimiter::find(Shard &shard, std::uint64_t key, std::uint64_t now) -> Slot *
+{
+	// Look for the bucket of the client, and remember the best slot to take if it has none. Free slots are best,
+	// followed by the bucket that is the fullest.
+	Slot *candidate = nullptr;
+	std::uint64_t candidateKey = 0;
+	auto candidateFullTime = std::numeric_limits<std::uint64_t>::max();
+	for (std::size_t probe = 0; probe < kProbeLength; ++probe)
+	{
+		auto &slot = shard._slots[(key + probe) & _slotMask];
+		const auto slotKey = slot._key.load(std::memory_order_relaxed);
+		if (slotKey == key)
+		{
+			return &slot;
+		}
+
+		const auto fullTime = slotKey == 0 ? 0 : slot._fullTime.load(std::memory_order_relaxed);
+		if (fullTime < candidateFullTime)
+		{
+			candidate = &slot;
+			candidateKey = slotKey;
+			candidateFullTime = fullTime;
+		}
+	}
+
+	// Take the slot. If another thread took it first, it may have done so for the same client.
+	if (!candidate->_key.compare_exchange_strong(candidateKey, key, std::memory_order_relaxed))
+	{
+		return candidateKey == key ? candidate : nullptr;
+	}
+
+	// Give the client a full bucket, unless the bucket was used in the meantime, in which case the client just
+	// starts with fewer tokens
+	if (candidateKey != 0)
+	{
+		if (candidateFullTime > now)
+		{
+			candidate->_fullTime.compare_exchange_strong(candidateFullTime, 0, std::memory_order_relaxed);
+		}
+		shard._evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return candidate;
+}
+
+auto RateLimiter::take(Slot &slot, const Interval &interval, std::uint64_t now) -> bool
+{
+	// A bucket with n tokens missing is full again n emission intervals from now. A token can be taken as long as
+	// at least one is left.
+	auto fullTime = slot._fullTime.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		const auto start = std::max(fullTime, now);
+		if (start - now > interval._tolerance)
+		{
+			return false;
+		}
+
+		// Saturate the time rather than letting it wrap around
+		const auto emission = std::min(interval._emission, std::numeric_limits<std::uint64_t>::max() - start);
+		if (slot._fullTime.compare_exchange_weak(
+				fullTime, start + emission, std::memory_order_relaxed, std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+}
+
+auto RateLimiter::formatMetrics(std::string &text) const -> void
+{
+	std::uint64_t rejectedRequests = 0;
+	std::uint64_t evictions = 0;
+	if (_shards)
+	{
+		for (std::size_t index = 0; index < kShardCount; ++index)
+		{
+			rejectedRequests += _shards[index]._rejectedRequests.load(std::memory_order_relaxed);
+			evictions += _shards[index]._evictions.load(std::memory_order_relaxed);
+		}
+	}
+
+	Metrics::formatCounter(text, "rate_limited_requests_total"sv,
+		"Number of requests rejected because the client exceeded its rate limit."sv, rejectedRequests);
+	Metrics::formatCounter(text, "rate_limit_evictions_total"sv,
+		"Number of token buckets reused for a different client because the table was full."sv, evictions);
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,166 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "RequestContext.hpp"
+#include "StringHash.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libhttp.h>
+
+namespace xentara::samples::webService
+{
+
+//  Limits the rate of requests of each client, so that a single client cannot keep all worker threads busy.
+//
+// Each client has a token bucket, which is keyed by the subject of its token, or by its IP address if the request
+// was not authenticated successfully. The buckets are kept in a table of fixed size that is split into shards, and
+// that is accessed without locks. A bucket is stored as a single number, the time at which it will be full again, so
+// that taking a token is a single compare-and-swap. A client's bucket can only be in one of the kProbeLength slots
+// following the position given by its key. If none of them is free, the fullest bucket among them is reused.
+//
+// Clients can get different limits depending on the claims of their token. The claims have the same form as the
+// claims of the authentication provider, and the first limit with a matching claim is used.
+class RateLimiter
+{
+public:
+	//  The rate and burst size of a limit
+	struct Limit
+	{
+		//  The number of requests per second that are allowed in the long run
+		double _requestsPerSecond { 0 };
+
+		//  The number of requests that are allowed at once
+		std::uint32_t _burst { 0 };
+	};
+
+	//  Loads the configuration from the JSON Object
+	//  jsonObject the object from the json file
+	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Creates the table of buckets. This must be called before the first call to acquire().
+	auto initialize() -> void;
+
+	//  Checks whether rate limiting was configured
+	auto enabled() const noexcept -> bool
+	{
+		return _enabled;
+	}
+
+	//  Gets the claims that select the limits after the default limit, for the authentication provider
+	auto claims() const -> std::vector<StringMap<StringSet>>;
+
+	//  Gets the number of limits, including the default limit
+	auto limitCount() const noexcept -> std::size_t
+	{
+		return _limits.size();
+	}
+
+	//  Gets the number of whole seconds after which a client that exceeded a limit can send another request
+	//  limit the index of the limit, with 0 being the default limit
+	auto retryAfter(std::size_t limit) const noexcept -> std::uint32_t;
+
+	//  Takes a token from the bucket of the client that sent a request
+	//  request the request
+	//  context the context of the request, after the authentication check
+	//  @return the index of the limit whose bucket was empty, or std::nullopt if the request may be handled
+	auto acquire(const lh_rqi_t &request, const RequestContext &context) -> std::optional<std::size_t>;
+
+	//  Writes the rate limiting counters in the Prometheus text format
+	//  text the string to append the counters to
+	auto formatMetrics(std::string &text) const -> void;
+
+private:
+	//  A limit, converted to times
+	struct Interval
+	{
+		//  The time it takes to refill one token
+		std::uint64_t _emission;
+
+		//  How far the time at which the bucket will be full may be in the future. This is the time it takes to
+		// refill all tokens except one.
+		std::uint64_t _tolerance;
+	};
+
+	//  A bucket in the table
+	struct Slot
+	{
+		//  The hash of the key of the client, or 0 if the slot is free
+		std::atomic<std::uint64_t> _key { 0 };
+
+		//  The time at which the bucket will be full again, in nanoseconds of the steady clock
+		std::atomic<std::uint64_t> _fullTime { 0 };
+	};
+
+	//  A part of the table. The shards are aligned to cache lines, so that the counters of different shards do not
+	// share a cache line.
+	struct alignas(64) Shard
+	{
+		//  The slots of the shard
+		std::unique_ptr<Slot[]> _slots;
+
+		//  The number of requests that were rejected
+		std::atomic<std::uint64_t> _rejectedRequests { 0 };
+
+		//  The number of buckets that were reused for a different client
+		std::atomic<std::uint64_t> _evictions { 0 };
+	};
+
+	//  Loads a limit with its claims
+	auto loadLimit(utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Checks that a limit is valid
+	//  jsonObject the object the limit was loaded from, for error messages
+	static auto checkLimit(Limit &limit, utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Finds the bucket of a client, or takes a slot for it
+	//  @return the slot, or nullptr if no slot could be taken because other threads were taking the same slots
+	auto find(Shard &shard, std::uint64_t key, std::uint64_t now) -> Slot *;
+
+	//  Takes a token from a bucket
+	//  @return whether the bucket contained a token
+	static auto take(Slot &slot, const Interval &interval, std::uint64_t now) -> bool;
+
+	//  Whether rate limiting was configured
+	bool _enabled { false };
+
+	//  The limits, starting with the default limit
+	std::vector<Limit> _limits { Limit {} };
+
+	//  The claims that select each limit after the default limit
+	std::vector<StringMap<StringSet>> _claims;
+
+	//  The limits converted to times, in the same order
+	std::vector<Interval> _intervals;
+
+	//  The number of buckets in the table
+	std::size_t _tableSize { 16384 };
+
+	//  The number of slots in each shard, minus one, as a mask
+	std::uint64_t _slotMask { 0 };
+
+	//  The shards of the table
+	std::unique_ptr<Shard[]> _shards;
+
+	//  The number of shards, which must be a power of two
+	static constexpr std::size_t kShardCount = 64;
+
+	//  The number of slots that are searched for the bucket of a client
+	static constexpr std::size_t kProbeLength = 8;
+
+	//  The longest time it may take to refill a whole bucket, in nanoseconds. This is about 146 years, and leaves
+	// the top bit of the times free, so that adding it to the current time cannot overflow.
+	static constexpr std::uint64_t kMaxRefillTime = std::uint64_t(1) << 62;
+};
+
+} // namespace xentara::samples::webService
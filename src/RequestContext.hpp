@@ -0,0 +1,188 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "AuthenticationResult.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace xentara::samples::webService
+{
+
+//  The subject of a token, stored in place so that it can be copied without allocating memory. Subjects that are
+// longer than kMaxSize are truncated.
+class TokenSubject
+{
+public:
+	//  The maximum size of a subject
+	static constexpr std::size_t kMaxSize = 64;
+
+	//  Sets the subject
+	auto assign(std::string_view subject) noexcept -> void
+	{
+		_size = std::uint8_t(std::min(subject.size(), kMaxSize));
+		std::copy_n(subject.data(), _size, _text.data());
+	}
+
+	//  Gets the subject, or an empty string if the token had no subject
+	auto view() const noexcept -> std::string_view
+	{
+		return { _text.data(), _size };
+	}
+
+private:
+	//  The size of the subject
+	std::uint8_t _size { 0 };
+
+	//  The subject
+	std::array<char, kMaxSize> _text;
+};
+
+//  The stages of handling a request whose duration is measured
+enum class RequestStage : std::uint8_t
+{
+	//  Finding the Authorization header
+	HeaderScan,
+
+	//  Looking up the token in the caches of verified and rejected tokens
+	TokenCache,
+
+	//  Decoding the token and collecting its claims
+	Decode,
+
+	//  Checking the not before and expiration time
+	DateCheck,
+
+	//  Checking the audience
+	AudienceCheck,
+
+	//  Checking the issuer
+	IssuerCheck,
+
+	//  Verifying the signature
+	Signature,
+
+	//  Checking the configured claims
+	ClaimsCheck,
+
+	//  The complete authentication check, including all the stages above
+	Authentication,
+
+	//  Handling the request after it was authenticated
+	Handling,
+
+	//  Writing the response
+	Write,
+
+	//  The complete request, from receiving it to writing the response
+	Request
+};
+
+//  The number of different request stages
+constexpr std::size_t kRequestStageCount = std::size_t(RequestStage::Request) + 1;
+
+//  Gets a name for a request stage, for use in metrics
+constexpr auto requestStageName(RequestStage stage) noexcept -> std::string_view
+{
+	using namespace std::literals;
+
+	switch (stage)
+	{
+	case RequestStage::HeaderScan:
+		return "header_scan"sv;
+	case RequestStage::TokenCache:
+		return "token_cache"sv;
+	case RequestStage::Decode:
+		return "decode"sv;
+	case RequestStage::DateCheck:
+		return "date_check"sv;
+	case RequestStage::AudienceCheck:
+		return "audience_check"sv;
+	case RequestStage::IssuerCheck:
+		return "issuer_check"sv;
+	case RequestStage::Signature:
+		return "signature"sv;
+	case RequestStage::ClaimsCheck:
+		return "claims_check"sv;
+	case RequestStage::Authentication:
+		return "authentication"sv;
+	case RequestStage::Handling:
+		return "handling"sv;
+	case RequestStage::Write:
+		return "write"sv;
+	case RequestStage::Request:
+		return "request"sv;
+	}
+
+	return "unknown"sv;
+}
+
+//  Information about a request that is collected while the request is handled, for use by the access log and the
+// metrics
+struct RequestContext
+{
+	//  Records the duration of a stage
+	auto recordStage(RequestStage stage, std::chrono::nanoseconds duration) noexcept -> void
+	{
+		_stageTimes[std::size_t(stage)] = duration;
+		_recordedStages |= std::uint16_t(1u << std::size_t(stage));
+	}
+
+	//  Records the time since the start of a stage, and sets the start to the current time so that the next stage can
+	// be measured from there
+	auto recordStage(RequestStage stage, std::chrono::steady_clock::time_point &start) noexcept -> void
+	{
+		const auto now = std::chrono::steady_clock::now();
+		recordStage(stage, now - start);
+		start = now;
+	}
+
+	//  Checks whether a stage was run for this request
+	auto hasStage(RequestStage stage) const noexcept -> bool
+	{
+		return (_recordedStages & (1u << std::size_t(stage))) != 0;
+	}
+
+	//  Gets the duration of a stage, or 0 if the stage was not run
+	auto stageTime(RequestStage stage) const noexcept -> std::chrono::nanoseconds
+	{
+		return _stageTimes[std::size_t(stage)];
+	}
+
+	//  The time the request was received
+	std::chrono::system_clock::time_point _receiveTime;
+
+	//  The result of the authentication check
+	AuthenticationResult _authenticationResult { AuthenticationResult::Success };
+
+	//  The subject of the token, if the token is valid. This may be truncated, and is only meant for the access log.
+	TokenSubject _subject;
+
+	//  The hash of the complete subject of the token, if the token is valid, or 0 otherwise. This is used to identify
+	// the client for the rate limiter.
+	std::uint64_t _subjectHash { 0 };
+
+	//  The number of the rate limit selected by the claims of the token, or 0 for the default limit
+	std::size_t _rateLimit { 0 };
+
+	//  The HTTP status code of the response
+	std::uint16_t _status { 0 };
+
+	//  The size of the complete response, including the status line and headers
+	std::size_t _responseSize { 0 };
+
+	//  Whether the request opened an event subscription, which lasts until the client disconnects
+	bool _subscription { false };
+
+	//  The duration of each stage
+	std::array<std::chrono::nanoseconds, kRequestStageCount> _stageTimes {};
+
+	//  A bit for each stage that was run
+	std::uint16_t _recordedStages { 0 };
+};
+
+} // namespace xentara::samples::webService
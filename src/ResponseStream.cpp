@@ -0,0 +1,75 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "ResponseStream.hpp"
+
+#include <algorithm>
+
+namespace xentara::samples::webService
+{
+
+namespace
+{
+	//  Gets the buffer of the calling thread
+	auto threadBuffer() -> std::string &
+	{
+		thread_local std::string buffer;
+		buffer.clear();
+		buffer.reserve(ResponseStream::kChunkSize);
+		return buffer;
+	}
+} // namespace
+
+ResponseStream::ResponseStream(const lh_ctx_t *context, lh_con_t *connection) :
+	_context(context), _connection(connection), _buffer(threadBuffer())
+{
+}
+
+auto ResponseStream::append(std::string_view data) -> void
+{
+	_size += data.size();
+
+	while (!data.empty())
+	{
+		// Write large blocks of data directly if there is nothing buffered
+		if (_buffer.empty() && data.size() >= kChunkSize)
+		{
+			write(data);
+			return;
+		}
+
+		// Fill up the buffer
+		const auto count = std::min(data.size(), kChunkSize - _buffer.size());
+		_buffer.append(data.substr(0, count));
+		data.remove_prefix(count);
+
+		// Write the buffer once it is full
+		if (_buffer.size() == kChunkSize)
+		{
+			flush();
+		}
+	}
+}
+
+auto ResponseStream::flush() -> void
+{
+	if (!_buffer.empty())
+	{
+		write(_buffer);
+		_buffer.clear();
+	}
+}
+
+auto ResponseStream::write(std::string_view data) -> void
+{
+	// Don't write anything more if the client is gone
+	if (_failed)
+	{
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	_failed = httplib_write(_context, _connection, data.data(), data.size()) <= 0;
+	_writeTime += std::chrono::steady_clock::now() - start;
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,80 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <libhttp.h>
+
+namespace xentara::samples::webService
+{
+
+//  Writes a response to a connection in chunks, so that large responses do not need to be built in memory first.
+//
+// The data is collected in a buffer that is reused for all responses of the calling thread, and written to the
+// connection whenever the buffer is full. Only one stream may be used by a thread at the same time.
+class ResponseStream
+{
+public:
+	//  The size of the chunks written to the connection
+	static constexpr std::size_t kChunkSize = 16 * 1024;
+
+	//  Constructor
+	ResponseStream(const lh_ctx_t *context, lh_con_t *connection);
+
+	//  Destructor. Writes any data that is still buffered.
+	~ResponseStream()
+	{
+		flush();
+	}
+
+	//  Appends data to the response
+	auto append(std::string_view data) -> void;
+
+	//  Writes any data that is still buffered
+	auto flush() -> void;
+
+	//  Gets the number of bytes appended so far
+	auto size() const noexcept -> std::size_t
+	{
+		return _size;
+	}
+
+	//  Checks whether writing to the connection failed. No more data is written once this happens.
+	auto failed() const noexcept -> bool
+	{
+		return _failed;
+	}
+
+	//  Gets the time spent writing to the connection
+	auto writeTime() const noexcept -> std::chrono::nanoseconds
+	{
+		return _writeTime;
+	}
+
+private:
+	//  Writes data to the connection
+	auto write(std::string_view data) -> void;
+
+	//  The libhttp context
+	const lh_ctx_t *_context;
+
+	//  The connection
+	lh_con_t *_connection;
+
+	//  The buffer of the calling thread
+	std::string &_buffer;
+
+	//  The number of bytes appended so far
+	std::size_t _size { 0 };
+
+	//  Whether writing to the connection failed
+	bool _failed { false };
+
+	//  The time spent writing to the connection
+	std::chrono::nanoseconds _writeTime { 0 };
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,115 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "PerThread.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace xentara::samples::webService
+{
+
+//  A lock-free ring buffer with a single producer thread and a single consumer thread. The read and write positions
+// count up forever, and are on separate cache lines so that the two threads do not contend.
+template <class Value, std::size_t kCapacity>
+class RingBuffer
+{
+public:
+	//  Adds a value if there is room. This must only be called by the producer thread.
+	//  fill a function that fills in the value in place, so that it need not be copied
+	//  @return false if the buffer was full
+	template <class Fill>
+	auto tryPush(Fill &&fill) -> bool
+	{
+		const auto writePosition = _writePosition.load(std::memory_order_relaxed);
+		if (writePosition - _readPosition.load(std::memory_order_acquire) >= kCapacity)
+		{
+			return false;
+		}
+
+		// Fill in the value, and only then make it visible to the consumer
+		fill(_values[writePosition % kCapacity]);
+		_writePosition.store(writePosition + 1, std::memory_order_release);
+		return true;
+	}
+
+	//  Removes all values that are ready. This must only be called by the consumer thread.
+	//  consume a function that is called for each value
+	template <class Consume>
+	auto drain(Consume &&consume) -> void
+	{
+		const auto readPosition = _readPosition.load(std::memory_order_relaxed);
+		const auto writePosition = _writePosition.load(std::memory_order_acquire);
+		for (auto position = readPosition; position != writePosition; ++position)
+		{
+			consume(static_cast<const Value &>(_values[position % kCapacity]));
+		}
+
+		// Free the values for the producer
+		_readPosition.store(writePosition, std::memory_order_release);
+	}
+
+private:
+	//  The position the next value will be written to
+	alignas(64) std::atomic<std::uint64_t> _writePosition { 0 };
+
+	//  The position the next value will be read from
+	alignas(64) std::atomic<std::uint64_t> _readPosition { 0 };
+
+	//  The values
+	std::array<Value, kCapacity> _values;
+};
+
+//  A set of ring buffers, one for each thread that produces values, which are all drained by a single consumer
+// thread. The producers only take a lock the first time they use the set.
+template <class Value, std::size_t kCapacity>
+class RingBufferSet
+{
+public:
+	//  The type of the ring buffers
+	using Ring = RingBuffer<Value, kCapacity>;
+
+	//  Gets the ring buffer of the calling thread, creating it if necessary
+	auto local() -> Ring &
+	{
+		auto &ring = _localRings.local();
+		if (!ring)
+		{
+			// Register a new ring for this thread
+			auto newRing = std::make_unique<Ring>();
+			std::scoped_lock lock(_mutex);
+			ring = _rings.emplace_back(std::move(newRing)).get();
+		}
+
+		return *ring;
+	}
+
+	//  Removes all values that are ready from all the ring buffers. This must only be called by the consumer thread.
+	//  consume a function that is called for each value
+	template <class Consume>
+	auto drain(Consume &&consume) -> void
+	{
+		std::scoped_lock lock(_mutex);
+		for (auto &&ring : _rings)
+		{
+			ring->drain(consume);
+		}
+	}
+
+private:
+	//  The ring buffer of each thread
+	PerThread<Ring *> _localRings;
+
+	//  Protects _rings
+	std::mutex _mutex;
+
+	//  All ring buffers. Rings are never removed, so that values from threads that have exited are still consumed.
+	std::vector<std::unique_ptr<Ring>> _rings;
+};
+
+} // namespace xentara::samples::webService
@@ -12,17 +12,28 @@
 #include <xentara/config/Errors.hpp>
 
 #include "Server.hpp"
+#include "CborWriter.hpp"
+#include "JsonReader.hpp"
+#include "JsonWriter.hpp"
+#include "MessagePackWriter.hpp"
 #include "OpenIdAuthenticationProvider.hpp"
+#include "QualityList.hpp"
 
+#include <algorithm>
 #include <any>
+#include <cctype>
+#include <charconv>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
 #include <list>
 #include <optional>
+#include <random>
 #include <ranges>
 #include <sstream>
+#include <utility>
 #include <string_view>
 #include <vector>
 
@@ -33,6 +44,179 @@ Server::Class Server::Class::_instance;
 
 using namespace std::literals;
 
+namespace
+{
+	//  The prefix of the paths the attributes are served on
+	constexpr std::string_view kDataPrefix = "/data/"sv;
+
+	//  The path lists of attributes are requested on
+	constexpr std::string_view kBatchPath = "/data"sv;
+
+	//  The prefix of the paths the groups of attributes are served on
+	constexpr std::string_view kGroupPrefix = "/groups/"sv;
+
+	//  The maximum size of a request body
+	constexpr std::int64_t kMaxRequestBodySize = 1024 * 1024;
+
+	//  The path changes of attributes are subscribed to on
+	constexpr std::string_view kEventsPath = "/events"sv;
+
+	//  The maximum number of open event subscriptions if neither the maximum nor the number of worker threads were
+	// configured
+	constexpr std::uint32_t kDefaultMaxSubscriptions = 16;
+
+	//  The path WebSocket clients connect to
+	constexpr std::string_view kWebSocketPath = "/ws"sv;
+
+	//  The header sent with responses of values, whose encoding depends on the Accept header and whose content coding
+	// depends on the Accept-Encoding header, so that caches keep them apart
+	constexpr std::string_view kVaryHeader = "Vary: Accept, Accept-Encoding\r\n"sv;
+
+	//  The header sent with other responses that may be compressed
+	constexpr std::string_view kVaryEncodingHeader = "Vary: Accept-Encoding\r\n"sv;
+
+	//  Gets the value of a request header
+	//  @return the value, or an empty string if the request does not have the header
+	auto headerValue(const lh_con_t *connection, const char *name) -> std::string_view
+	{
+		const auto value = httplib_get_header(connection, name);
+		return value ? std::string_view(value) : std::string_view();
+	}
+
+	//  Builds the extra headers of a compressed response
+	//  @return the headers, which are valid until the next call from the same thread
+	auto compressedHeaders(std::string_view extraHeaders, ContentCoding coding) -> std::string_view
+	{
+		thread_local std::string headers;
+		headers.assign(extraHeaders)
+			.append("Content-Encoding: "sv)
+			.append(Compression::headerValue(coding))
+			.append("\r\n"sv);
+		return headers;
+	}
+
+	//  Checks whether an If-None-Match header matches an entity tag, using the weak comparison
+	//  tag the opaque tag, including the quotes
+	auto matchesEntityTag(std::string_view ifNoneMatch, std::string_view tag) -> bool
+	{
+		while (!ifNoneMatch.empty())
+		{
+			const auto end = ifNoneMatch.find(',');
+			auto candidate = QualityList::trim(ifNoneMatch.substr(0, end));
+			ifNoneMatch = end == std::string_view::npos ? std::string_view() : ifNoneMatch.substr(end + 1);
+
+			if (candidate == "*"sv)
+			{
+				return true;
+			}
+			if (candidate.starts_with("W/"sv))
+			{
+				candidate.remove_prefix(2);
+			}
+			if (candidate == tag)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	//  Gets the character that identifies an encoding in entity tags
+	auto encodingTag(Encoding encoding) -> char
+	{
+		switch (encoding)
+		{
+		case Encoding::Cbor:
+			return 'c';
+		case Encoding::MessagePack:
+			return 'm';
+		case Encoding::Json:
+		default:
+			return 'j';
+		}
+	}
+
+	//  Selects the encoding of the values in a response from the Accept header of the request
+	auto responseEncoding(const lh_con_t *connection) -> Encoding
+	{
+		const auto encoding = negotiateEncoding(headerValue(connection, "Accept"));
+		if (!encoding)
+		{
+			throw HttpError("406 Not Acceptable"sv,
+				"values can be sent as application/json, application/cbor or application/msgpack"sv);
+		}
+		return *encoding;
+	}
+
+	//  Checks whether a request asks for a WebSocket connection
+	auto isWebSocketRequest(const lh_con_t *connection, const lh_rqi_t *request) -> bool
+	{
+		const auto upgrade = httplib_get_header(connection, "Upgrade");
+		return upgrade && request->uri == kWebSocketPath &&
+			std::ranges::equal(std::string_view(upgrade), "websocket"sv,
+				[](char left, char right) { return std::tolower(static_cast<unsigned char>(left)) == right; });
+	}
+
+	//  The longest time an event stream may stay silent. A comment is sent after this time, so that connections to
+	// clients that are gone are noticed.
+	constexpr std::chrono::seconds kEventKeepAliveInterval { 15 };
+
+	//  Decodes a value from a query string, replacing escape sequences and '+'
+	//  value receives the decoded value. Any previous contents are replaced.
+	auto decodeQueryValue(std::string_view encoded, std::string &value) -> void
+	{
+		value.clear();
+		for (std::size_t index = 0; index < encoded.size(); ++index)
+		{
+			const auto character = encoded[index];
+			if (character == '+')
+			{
+				value.push_back(' ');
+			}
+			else if (character == '%')
+			{
+				// The escape sequence consists of two hex digits
+				unsigned char decoded = 0;
+				const auto digits = encoded.substr(index + 1, 2);
+				const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), decoded, 16);
+				if (digits.size() != 2 || error != std::errc() || end != digits.data() + digits.size())
+				{
+					throw HttpError("400 Bad Request"sv, "invalid escape sequence in query string"sv);
+				}
+				value.push_back(char(decoded));
+				index += 2;
+			}
+			else
+			{
+				value.push_back(character);
+			}
+		}
+	}
+
+	//  Releases the slot of an event subscription when the subscription ends, even if sending the events failed
+	class SubscriptionSlot
+	{
+	public:
+		//  Constructor
+		//  openSubscriptions the counter of open subscriptions, which must already contain this subscription
+		explicit SubscriptionSlot(std::atomic<std::uint32_t> &openSubscriptions) noexcept :
+			_openSubscriptions(openSubscriptions)
+		{
+		}
+
+		//  Destructor
+		~SubscriptionSlot()
+		{
+			_openSubscriptions.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+	private:
+		//  The counter of open subscriptions
+		std::atomic<std::uint32_t> &_openSubscriptions;
+	};
+} // namespace
+
 auto Server::loadConfig(const ConfigIntializer &initializer,
 	utils::json::decoder::Object &jsonObject,
 	config::Resolver &resolver,
@@ -68,6 +252,111 @@ auto Server::loadConfig(const ConfigIntializer &initializer,
 			loadAuthenticationProvider(authentication);
 			readAuthentication = true;
 		}
+		else if (key == u8"logLevel")
+		{
+			// The log level is a string
+			auto logLevel = value.asString<std::u8string>();
+
+			// Get the minimum severity
+			const auto severity = Logger::parseSeverity(logLevel);
+			if (!severity)
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("invalid logLevel for webService Server : must be \"debug\", \"info\", "
+									   "\"warning\" or \"error\""));
+			}
+
+			// store the log level
+			_logger.setMinimumSeverity(*severity);
+		}
+		else if (key == u8"accessLog")
+		{
+			// The access log is an object
+			auto accessLog = value.asObject();
+
+			// Load the access log
+			_accessLog = std::make_unique<AccessLog>();
+			_accessLog->loadConfig(accessLog);
+		}
+		else if (key == u8"connections")
+		{
+			// The connection options are an object
+			auto connections = value.asObject();
+
+			// Load the connection options
+			_connectionOptions.loadConfig(connections);
+		}
+		else if (key == u8"tlsSessions")
+		{
+			// The TLS session options are an object
+			auto tlsSessions = value.asObject();
+
+			// Load the TLS session options
+			_tlsSessions.loadConfig(tlsSessions);
+		}
+		else if (key == u8"kernelTls")
+		{
+			// Whether to use kernel TLS is a boolean
+			_kernelTlsEnabled = value.asBool();
+		}
+		else if (key == u8"data")
+		{
+			// The data is an array of elements with their attributes
+			auto data = value.asArray();
+
+			// Load the attributes to serve
+			_dataSnapshot.loadConfig(data, resolver);
+		}
+		else if (key == u8"groups")
+		{
+			// The groups are an object with a member for each group
+			auto groups = value.asObject();
+
+			// Load the groups
+			_dataSnapshot.loadGroups(groups, resolver);
+		}
+		else if (key == u8"compression")
+		{
+			// The compression options are an object
+			auto compression = value.asObject();
+
+			// Load the compression options
+			_compression.loadConfig(compression);
+		}
+		else if (key == u8"rateLimit")
+		{
+			// The rate limit options are an object
+			auto rateLimit = value.asObject();
+
+			// Load the rate limits
+			_rateLimiter.loadConfig(rateLimit);
+		}
+		else if (key == u8"eventInterval")
+		{
+			// The event interval is a number of milliseconds
+			_eventInterval = std::chrono::milliseconds(value.asNumber<std::uint32_t>());
+		}
+		else if (key == u8"maxSubscriptions")
+		{
+			// The maximum number of subscriptions is a number
+			_maxSubscriptions = value.asNumber<std::uint32_t>();
+		}
+		else if (key == u8"metricsPath")
+		{
+			// The metrics path is a string
+			auto metricsPath = value.asString<std::u8string>();
+
+			// The metrics path must be empty or absolute
+			if (!metricsPath.empty() && !metricsPath.starts_with(u8'/'))
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("invalid metricsPath for webService Server : must start with \"/\", or be "
+									   "empty to disable the metrics"));
+			}
+
+			// store the metrics path
+			_metricsPath = std::string(metricsPath.begin(), metricsPath.end());
+		}
 		else if (key == u8"serverCertificate")
 		{
 			// The serverCertificate is a string
@@ -167,11 +456,70 @@ auto Server::loadAuthenticationProvider(utils::json::decoder::Object &jsonObject
 	return;
 }
 
+auto Server::resolveTask(std::u16string_view name) -> std::shared_ptr<process::Task>
+{
+	if (name == u"collect"sv)
+	{
+		return std::shared_ptr<process::Task>(sharedFromThis(), &_collectTask);
+	}
+	if (name == u"write"sv)
+	{
+		return std::shared_ptr<process::Task>(sharedFromThis(), &_writeTask);
+	}
+
+	return nullptr;
+}
+
+auto Server::CollectTask::preOperational(const process::ExecutionContext &context) -> Status
+{
+	// Take snapshots before the operational stage as well, so that data is available as early as possible
+	_server.get()._dataSnapshot.collect(context.scheduledTime());
+	return Status::Ready;
+}
+
+auto Server::CollectTask::operational(const process::ExecutionContext &context) -> void
+{
+	_server.get()._dataSnapshot.collect(context.scheduledTime());
+}
+
+auto Server::WriteTask::operational(const process::ExecutionContext &context) -> void
+{
+	auto &server = _server.get();
+	server._writeQueue.apply(server._dataSnapshot);
+}
+
 auto Server::prepare() -> void
 {
 
+	// Let the authentication provider select the rate limit of each client from its claims
+	if (_rateLimiter.enabled())
+	{
+		_rateLimiter.initialize();
+		_authentication->setRateLimitClaims(_rateLimiter.claims());
+	}
+
 	// Inintiate all the verifires required
-	_authentication->initialize();
+	_authentication->initialize(_logger);
+
+	// Create a cache for the compressed values of each group
+	_groupCaches = std::make_unique<CompressedCache[]>(_dataSnapshot.groupCount());
+
+	// Choose a random tag for this run of the server
+	std::random_device random;
+	char instanceTag[16];
+	const auto instanceTagEnd =
+		std::to_chars(std::begin(instanceTag), std::end(instanceTag), std::uint32_t(random()), 16).ptr;
+	_instanceTag.assign(std::begin(instanceTag), instanceTagEnd);
+
+	// Build the responses that never change
+	prepareResponses();
+
+	// Start writing log messages and access log records
+	_logger.start();
+	if (_accessLog)
+	{
+		_accessLog->start();
+	}
 
 	// add character 's' after port to enable security (https)
 	auto portNumberString = std::to_string(_portNumber) + "s";
@@ -179,17 +527,36 @@ auto Server::prepare() -> void
 	// convert server certificate path to * char
 	const std::string localPath = _serverCertificatePath.string();
 
+	// Choose the options for the worker threads and connections, and report them
+	_connectionOptions.resolve();
+	_logger.log(Logger::Severity::Info, utils::string::cat("Web Service Server ", _connectionOptions.description()));
+	_metrics.setWorkerThreads(_connectionOptions.workerThreads().value_or(0));
+
+	// Leave at least half the worker threads for other requests, unless the maximum number of subscriptions was set
+	if (!_maxSubscriptions)
+	{
+		const auto workerThreads = _connectionOptions.workerThreads();
+		_maxSubscriptions = workerThreads ? std::max(*workerThreads / 2, 1u) : kDefaultMaxSubscriptions;
+	}
+
 	// Set the initiation options for the server
-	const lh_opt_t options[] = {
-		{ "listening_ports", portNumberString.c_str() }, { "ssl_certificate", localPath.c_str() }, { nullptr, nullptr }
+	std::vector<lh_opt_t> options {
+		{ "listening_ports", portNumberString.c_str() }, { "ssl_certificate", localPath.c_str() }
 	};
+	std::ranges::copy(_connectionOptions.options(), std::back_inserter(options));
+	options.push_back({ nullptr, nullptr });
 
 	// set the callback functions for the server
 	const lh_clb_t callbacks { .begin_request = &Server::staticBeginRequestHandler,
-		.log_message = &Server::staticLogMessageHandler };
+		.log_message = &Server::staticLogMessageHandler,
+		.init_ssl = &Server::staticInitSslHandler,
+		.websocket_connect = &Server::staticWebSocketConnectHandler,
+		.websocket_ready = &Server::staticWebSocketReadyHandler,
+		.websocket_data = &Server::staticWebSocketDataHandler,
+		.connection_close = &Server::staticConnectionCloseHandler };
 
 	// start the server 
-	_context = httplib_start(&callbacks, this, options);
+	_context = httplib_start(&callbacks, this, options.data());
 
 	// check if the serve has been initalized sucessfully
 	if (_context == nullptr)
@@ -197,14 +564,134 @@ auto Server::prepare() -> void
 		throw std::runtime_error(
 			"Could not initialize the web Service Server");
 	}
+
+	// Start sending changes to WebSocket clients
+	_webSockets.start(_context);
 }
 
 auto Server::logMessageHandler(const lh_con_t *connection, const char *message) -> int
 {
-	std::cout << message << std::endl;
+	// libhttp only reports errors through this callback
+	_logger.log(Logger::Severity::Error, message);
 	return 1;
 }
 
+auto Server::initSslHandler(void *sslContext) -> int
+{
+	try
+	{
+		_tlsSessions.configure(static_cast<SSL_CTX *>(sslContext));
+		if (_kernelTlsEnabled)
+		{
+			_kernelTls.configure(static_cast<SSL_CTX *>(sslContext));
+		}
+	}
+	catch (const std::exception &exception)
+	{
+		_logger.log(Logger::Severity::Error, exception.what());
+		return -1;
+	}
+
+	// Let libhttp load the certificate as usual
+	return 0;
+}
+
+auto Server::staticInitSslHandler(lh_ctx_t *context, void *sslContext, void *userData) -> int
+{
+	auto server = reinterpret_cast<Server *>(httplib_get_user_data(context));
+	return server->initSslHandler(sslContext);
+}
+
+auto Server::webSocketConnectHandler(const lh_con_t *connection) -> int
+{
+	const auto request = httplib_get_request_info(connection);
+
+	// Check if the client has the proper credentials
+	_metrics.beginRequest();
+	RequestContext context { ._receiveTime = std::chrono::system_clock::now() };
+	auto stageStart = std::chrono::steady_clock::now();
+	try
+	{
+		context._authenticationResult = _authentication->checkAuthentication(request, context);
+		context.recordStage(RequestStage::Authentication, stageStart);
+		if (_rateLimiter.enabled() && _rateLimiter.acquire(*request, context))
+		{
+			context._status = 429;
+		}
+		else
+		{
+			context._status = context._authenticationResult == AuthenticationResult::Success
+				? 101
+				: responseStatus(_authenticationResponses[std::size_t(context._authenticationResult)]);
+		}
+	}
+	catch (const std::exception &exception)
+	{
+		_logger.log(Logger::Severity::Error, exception.what());
+		context._status = 500;
+	}
+	context.recordStage(RequestStage::Request, stageStart);
+
+	// Record the request
+	_metrics.endRequest();
+	_metrics.record(context);
+	if (_accessLog)
+	{
+		_accessLog->log(*request, context);
+	}
+
+	return context._status == 101 ? 0 : 1;
+}
+
+auto Server::webSocketReadyHandler(lh_con_t *connection) -> void
+{
+	_webSockets.connect(connection);
+}
+
+auto Server::webSocketDataHandler(lh_con_t *connection, int bits, char *data, std::size_t size) -> int
+{
+	switch (bits & 0x0f)
+	{
+	case WEBSOCKET_OPCODE_BINARY:
+		return _webSockets.receive(connection, { data, size }) ? 1 : 0;
+	case WEBSOCKET_OPCODE_CONNECTION_CLOSE:
+		return 0;
+	default:
+		// Ignore control frames, but close connections that send text
+		return (bits & 0x08) != 0 ? 1 : 0;
+	}
+}
+
+auto Server::connectionCloseHandler(const lh_con_t *connection) -> void
+{
+	_webSockets.disconnect(connection);
+}
+
+auto Server::staticWebSocketConnectHandler(lh_ctx_t *context, const lh_con_t *connection) -> int
+{
+	auto server = reinterpret_cast<Server *>(httplib_get_user_data(context));
+	return server->webSocketConnectHandler(connection);
+}
+
+auto Server::staticWebSocketReadyHandler(lh_ctx_t *context, lh_con_t *connection) -> void
+{
+	auto server = reinterpret_cast<Server *>(httplib_get_user_data(context));
+	server->webSocketReadyHandler(connection);
+}
+
+auto Server::staticWebSocketDataHandler(lh_ctx_t *context, lh_con_t *connection, int bits, char *data, size_t size)
+	-> int
+{
+	auto server = reinterpret_cast<Server *>(httplib_get_user_data(context));
+	return server->webSocketDataHandler(connection, bits, data, size);
+}
+
+auto Server::staticConnectionCloseHandler(lh_ctx_t *context, const lh_con_t *connection) -> void
+{
+	auto server = reinterpret_cast<Server *>(httplib_get_user_data(context));
+	server->connectionCloseHandler(connection);
+}
+
 auto Server::staticLogMessageHandler(lh_ctx_t *context, const lh_con_t *connection, const char *message) -> int
 {
 	auto server = reinterpret_cast<Server *>(httplib_get_user_data(context));
@@ -218,66 +705,748 @@ auto Server::staticBeginRequestHandler(lh_ctx_t *context, lh_con_t *connection)
 }
 
 auto Server::beginRequestHandler(lh_con_t *connection) -> int
+{
+	// get the HTTP request Info
+	const auto request = httplib_get_request_info(connection);
+
+	// Let libhttp handle WebSocket handshakes, which are authenticated by webSocketConnectHandler()
+	if (isWebSocketRequest(connection, request))
+	{
+		return 0;
+	}
+
+	// Handle the request
+	_metrics.beginRequest();
+	RequestContext context { ._receiveTime = std::chrono::system_clock::now() };
+	const auto requestStart = std::chrono::steady_clock::now();
+	const auto response = handleRequest(connection, request, context);
+
+	// Write the response, unless it was streamed to the connection already
+	if (!response.empty())
+	{
+		context._status = responseStatus(response);
+		context._responseSize = response.size();
+
+		auto writeStart = std::chrono::steady_clock::now();
+		sendPreparedResponse(connection, response);
+		context.recordStage(RequestStage::Write, writeStart);
+	}
+	context.recordStage(RequestStage::Request, std::chrono::steady_clock::now() - requestStart);
+
+	// Record the request
+	_metrics.endRequest();
+	_metrics.record(context);
+	if (_accessLog)
+	{
+		_accessLog->log(*request, context);
+	}
+
+	return 1; // Mark request as processed
+}
+
+auto Server::handleRequest(lh_con_t *connection, const lh_rqi_t *request, RequestContext &context)
+	-> std::string_view
 {
 	using namespace std::literals;
 
 	try
 	{
-		// get the HTTP request Info
-		const auto request = httplib_get_request_info(connection);
+		// Serve the metrics without authentication, so that scraping them is cheap
+		if (!_metricsPath.empty() && request->uri == _metricsPath && request->request_method == "GET"sv)
+		{
+			return metricsResponse(connection);
+		}
 
 		// Check if the client has the proper credentials
-		_authentication->checkAuthentication(request);
+		auto stageStart = std::chrono::steady_clock::now();
+		context._authenticationResult = _authentication->checkAuthentication(request, context);
+		context.recordStage(RequestStage::Authentication, stageStart);
 
-		// validate for request Method
-		const std::string requestMethod { request->request_method };
-		
-		// check if it is a Post
-		if (requestMethod != "GET")
+		// Reject clients that exceeded their rate limit, whether they were authenticated or not, before doing any
+		// further work for them
+		if (_rateLimiter.enabled())
 		{
-			throw HttpError("405 Method Not Allowed", "only \"GET\" method is accepted");
+			if (const auto limit = _rateLimiter.acquire(*request, context))
+			{
+				return _rateLimitResponses[*limit];
+			}
 		}
 
-		// respond with successful messasge to client
-		sendResponse(connection, "200 OK", "Hello from Xentara!"sv);
+		if (context._authenticationResult != AuthenticationResult::Success)
+		{
+			return _authenticationResponses[std::size_t(context._authenticationResult)];
+		}
 
+		// Find out what was requested
+		const std::string_view method = request->request_method;
+		const std::string_view uri = request->uri;
+		std::string_view response = _greetingResponse;
+		if (method == "POST"sv && uri == kBatchPath)
+		{
+			response = batchResponse(connection, request, responseEncoding(connection), context);
+		}
+		else if (method == "PUT"sv && uri == kBatchPath)
+		{
+			response = writeResponse(connection, request);
+		}
+		else if (method != "GET"sv)
+		{
+			response = uri == kBatchPath ? _batchMethodNotAllowedResponse : _methodNotAllowedResponse;
+		}
+		else if (uri == kBatchPath)
+		{
+			response = attributeListResponse(connection);
+		}
+		else if (uri.starts_with(kDataPrefix))
+		{
+			response = dataResponse(connection, uri.substr(kDataPrefix.size()), responseEncoding(connection));
+		}
+		else if (uri == kEventsPath)
+		{
+			response = subscribe(connection, request, context);
+		}
+		else if (uri.starts_with(kGroupPrefix))
+		{
+			const auto group = _dataSnapshot.group(uri.substr(kGroupPrefix.size()));
+			response = group
+				? streamValues(connection, group->_attributes, responseEncoding(connection), group, context)
+				: _groupNotFoundResponse;
+		}
+
+		context.recordStage(RequestStage::Handling, stageStart);
+		return response;
 	}
 	catch (const HttpError &exception)
 	{
-		sendResponse(connection, exception.responseCode(), exception.responseData());
+		return dynamicResponse(exception.responseCode(), exception.responseData());
 	}
 	catch (const std::exception &exception)
 	{
-		sendResponse(connection, "507 Internal Server Error"sv, exception.what());
+		return dynamicResponse("507 Internal Server Error"sv, exception.what());
 	}
+}
 
-	return 1; // Mark request as processed
+auto Server::compressibleResponse(const lh_con_t *connection,
+	std::string_view body,
+	std::string_view extraHeaders,
+	std::string_view contentType) -> std::string_view
+{
+	// Send small bodies, and bodies for clients that do not accept compression, as they are
+	const auto coding = _compression.shouldCompress(body.size())
+		? _compression.negotiate(headerValue(connection, "Accept-Encoding"))
+		: ContentCoding::Identity;
+	if (coding == ContentCoding::Identity)
+	{
+		return dynamicResponse("200 OK"sv, body, extraHeaders, contentType);
+	}
+
+	// Compress the body into a buffer that is reused by this thread
+	thread_local std::string compressed;
+	compressed.clear();
+	_compression.compress(coding, body, compressed);
+	_compression.record(body.size(), compressed.size(), false);
+
+	return dynamicResponse("200 OK"sv, compressed, compressedHeaders(extraHeaders, coding), contentType);
+}
+
+auto Server::checkVersion(const lh_con_t *connection, std::uint64_t version, Encoding encoding, std::string &headers)
+	const -> std::string_view
+{
+	// The tag consists of the run of the server, the version, and the encoding. The tag is weak, because compressed and
+	// uncompressed bodies share it.
+	char versionText[24];
+	const auto versionEnd = std::to_chars(std::begin(versionText), std::end(versionText), version).ptr;
+	thread_local std::string tag;
+	tag.assign("\""sv)
+		.append(_instanceTag)
+		.append("-"sv)
+		.append(std::begin(versionText), versionEnd)
+		.append("-"sv)
+		.append(1, encodingTag(encoding))
+		.append("\""sv);
+
+	headers.assign(kVaryHeader).append("ETag: W/"sv).append(tag).append("\r\n"sv);
+
+	// Send the values unless the client has them already
+	if (!matchesEntityTag(headerValue(connection, "If-None-Match"), tag))
+	{
+		return {};
+	}
+
+	thread_local std::string response;
+	response.assign(_notModifiedStatus).append(headers).append("\r\n"sv);
+	return response;
+}
+
+auto Server::metricsResponse(const lh_con_t *connection) -> std::string_view
+{
+	// Format the metrics in a buffer that is reused by this thread
+	thread_local std::string metrics;
+	metrics.clear();
+	_metrics.format(metrics);
+
+	// Add the messages and records that were lost
+	Metrics::formatCounter(metrics, "log_messages_dropped_total"sv,
+		"Number of log messages dropped because a ring buffer was full."sv, _logger.droppedMessages());
+	if (_accessLog)
+	{
+		Metrics::formatCounter(metrics, "access_log_records_dropped_total"sv,
+			"Number of access log records dropped because a ring buffer was full."sv, _accessLog->droppedRecords());
+	}
+	_tlsSessions.formatMetrics(metrics);
+	_kernelTls.formatMetrics(metrics);
+	_webSockets.formatMetrics(metrics);
+	_writeQueue.formatMetrics(metrics);
+	_compression.formatMetrics(metrics);
+	_rateLimiter.formatMetrics(metrics);
+
+	return compressibleResponse(connection, metrics, kVaryEncodingHeader, "text/plain"sv);
+}
+
+auto Server::dataResponse(const lh_con_t *connection, std::string_view path, Encoding encoding) -> std::string_view
+{
+	// Find the attribute
+	const auto index = _dataSnapshot.find(path);
+	if (!index)
+	{
+		return _dataNotFoundResponse;
+	}
+
+	// Get the latest snapshot
+	const auto snapshot = _dataSnapshot.current();
+	if (!snapshot)
+	{
+		return _dataUnavailableResponse;
+	}
+
+	// Check whether the client has the value already, before doing anything with the value
+	thread_local std::string headers;
+	if (const auto notModified = checkVersion(connection, snapshot->_changes[*index], encoding, headers);
+		!notModified.empty())
+	{
+		return notModified;
+	}
+
+	// The response is built before the snapshot is released, so that the fragment cannot change in the meantime
+	return compressibleResponse(
+		connection, snapshot->fragments(encoding)[*index], headers, webService::contentType(encoding));
+}
+
+auto Server::attributeListResponse(const lh_con_t *connection) -> std::string_view
+{
+	// Use the compressed list if the client accepts it, and the list is large enough to be compressed
+	const auto coding = _compression.negotiate(headerValue(connection, "Accept-Encoding"));
+	if (coding == ContentCoding::Identity || _attributeListSizes[std::size_t(coding)] == 0)
+	{
+		return _attributeListResponses[std::size_t(ContentCoding::Identity)];
+	}
+
+	_compression.record(_attributeListSizes[std::size_t(ContentCoding::Identity)],
+		_attributeListSizes[std::size_t(coding)], true);
+	return _attributeListResponses[std::size_t(coding)];
+}
+
+auto Server::batchResponse(lh_con_t *connection, const lh_rqi_t *request, Encoding encoding, RequestContext &context)
+	-> std::string_view
+{
+	// Find the attributes, using a list that is reused by this thread
+	thread_local std::vector<std::size_t> indices;
+	thread_local std::string path;
+	indices.clear();
+
+	JsonReader reader(readBody(connection, request));
+	reader.beginArray();
+	while (reader.nextElement())
+	{
+		reader.readString(path);
+		const auto index = _dataSnapshot.find(path);
+		if (!index)
+		{
+			throw HttpError("404 Not Found"sv, utils::string::cat("unknown attribute \"", path, "\""));
+		}
+		indices.push_back(*index);
+	}
+	reader.finish();
+
+	return streamValues(connection, indices, encoding, nullptr, context);
 }
 
-auto Server::sendResponse(lh_con_t *connection,
-	std::string_view responseCode,
-	std::string_view responseData,
-	std::string_view extraHeaderFiels) -> void
+auto Server::streamValues(lh_con_t *connection,
+	std::span<const std::size_t> indices,
+	Encoding encoding,
+	const DataSnapshot::Group *group,
+	RequestContext &context) -> std::string_view
 {
-	// Make the data for responce
-	std::string response = utils::string::cat("HTTP/1.1 ",
-		responseCode,
-		"\r\n",
-		extraHeaderFiels,
-		"Content-Length: ",
-		responseData.size(),
-		"\r\n"
-		"Content-Type: text/plain\r\n\r\n");
+	// Get the latest snapshot
+	const auto snapshot = _dataSnapshot.current();
+	if (!snapshot)
+	{
+		return _dataUnavailableResponse;
+	}
+
+	// Check whether the client has the values of a group already, before doing anything with the values
+	thread_local std::string headers;
+	CompressedCache *cache = nullptr;
+	if (group)
+	{
+		const auto version = snapshot->_groupChanges[group->_index];
+		if (const auto notModified = checkVersion(connection, version, encoding, headers); !notModified.empty())
+		{
+			return notModified;
+		}
+		cache = &_groupCaches[group->_index];
+	}
+	else
+	{
+		headers.assign(kVaryHeader);
+	}
+	const auto &fragments = snapshot->fragments(encoding);
 
-	// If responce data is not empty add responce data in the end
-	if (!responseData.empty())
+	// JSON objects need braces and commas, while the binary encodings start the map with the number of entries
+	thread_local std::string start;
+	start.clear();
+	std::string_view separator;
+	std::string_view end;
+	switch (encoding)
 	{
-		response += responseData;
+	case Encoding::Cbor:
+		cbor::appendMapHeader(start, indices.size());
+		break;
+	case Encoding::MessagePack:
+		messagePack::appendMapHeader(start, indices.size());
+		break;
+	case Encoding::Json:
+		start = "{"sv;
+		separator = ","sv;
+		end = "}"sv;
+		break;
 	}
 
-	// Write the response. 
+	// Calculate the size of the body up front, so that the response does not need chunked encoding
+	std::size_t contentLength =
+		start.size() + end.size() + (indices.empty() ? 0 : indices.size() - 1) * separator.size();
+	for (auto index : indices)
+	{
+		contentLength += _dataSnapshot.memberName(index, encoding).size() + fragments[index].size();
+	}
+
+	// Writes the body to a response stream or a compressor
+	const auto appendValues = [&](auto &output) {
+		output.append(start);
+		bool first = true;
+		for (auto index : indices)
+		{
+			if (!std::exchange(first, false))
+			{
+				output.append(separator);
+			}
+			output.append(_dataSnapshot.memberName(index, encoding));
+			output.append(fragments[index]);
+		}
+		output.append(end);
+	};
+
+	thread_local std::string header;
+	ResponseStream stream(_context, connection);
+	const auto coding = _compression.shouldCompress(contentLength)
+		? _compression.negotiate(headerValue(connection, "Accept-Encoding"))
+		: ContentCoding::Identity;
+	if (coding == ContentCoding::Identity)
+	{
+		// Stream the values straight from the snapshot
+		serializeHeader(header, "200 OK"sv, contentLength, headers, webService::contentType(encoding));
+		stream.append(header);
+		appendValues(stream);
+	}
+	else
+	{
+		bool cached = true;
+		const auto compress = [&](std::string &output) {
+			Compressor compressor(coding, _compression.level(), output);
+			appendValues(compressor);
+			compressor.finish();
+			cached = false;
+		};
+
+		// The values of groups are compressed once for all clients, other values into a buffer of this thread
+		std::shared_ptr<const CompressedCache::Body> cachedBody;
+		thread_local std::string compressed;
+		std::string_view body;
+		if (cache)
+		{
+			cachedBody = cache->get(encoding, coding, snapshot->_cycle, compress);
+			body = cachedBody->_data;
+		}
+		else
+		{
+			compressed.clear();
+			compress(compressed);
+			body = compressed;
+		}
+		_compression.record(contentLength, body.size(), cached);
+
+		serializeHeader(header, "200 OK"sv, body.size(), compressedHeaders(headers, coding),
+			webService::contentType(encoding));
+		stream.append(header);
+		stream.append(body);
+	}
+	stream.flush();
+
+	context._status = 200;
+	context._responseSize = stream.size();
+	context.recordStage(RequestStage::Write, stream.writeTime());
+	return {};
+}
+
+auto Server::subscribe(lh_con_t *connection, const lh_rqi_t *request, RequestContext &context) -> std::string_view
+{
+	// Find the attributes, using a list that is reused by this thread
+	thread_local std::vector<std::size_t> indices;
+	thread_local std::string value;
+	indices.clear();
+
+	const std::string_view query = request->query_string ? request->query_string : "";
+	for (const auto parameter : std::views::split(query, '&'))
+	{
+		const std::string_view text(parameter.begin(), parameter.end());
+		const auto separator = text.find('=');
+		const auto name = text.substr(0, separator);
+		decodeQueryValue(separator == std::string_view::npos ? std::string_view() : text.substr(separator + 1), value);
+
+		if (name == "group"sv)
+		{
+			const auto group = _dataSnapshot.group(value);
+			if (!group)
+			{
+				return _groupNotFoundResponse;
+			}
+			indices.insert(indices.end(), group->_attributes.begin(), group->_attributes.end());
+		}
+		else if (name == "path"sv)
+		{
+			const auto index = _dataSnapshot.find(value);
+			if (!index)
+			{
+				throw HttpError("404 Not Found"sv, utils::string::cat("unknown attribute \"", value, "\""));
+			}
+			indices.push_back(*index);
+		}
+	}
+
+	if (indices.empty())
+	{
+		throw HttpError(
+			"400 Bad Request"sv, "no attributes selected: use the query parameters \"group\" or \"path\""sv);
+	}
+
+	return streamEvents(connection, indices, context);
+}
+
+auto Server::streamEvents(lh_con_t *connection, std::span<const std::size_t> indices, RequestContext &context)
+	-> std::string_view
+{
+	// Get the latest snapshot
+	auto snapshot = _dataSnapshot.current();
+	if (!snapshot)
+	{
+		return _dataUnavailableResponse;
+	}
+
+	// The subscription keeps this worker thread busy until the client disconnects, so limit the number of
+	// subscriptions to leave threads for other requests
+	if (_openSubscriptions.fetch_add(1, std::memory_order_relaxed) >= *_maxSubscriptions)
+	{
+		_openSubscriptions.fetch_sub(1, std::memory_order_relaxed);
+		return _tooManySubscriptionsResponse;
+	}
+	const SubscriptionSlot slot(_openSubscriptions);
+	_metrics.beginSubscription();
+	context._subscription = true;
+	context._status = 200;
+
+	// Send the header and all values
+	ResponseStream stream(_context, connection);
+	stream.append(_eventStreamHeader);
+	appendEvent(stream, "snapshot"sv, *snapshot, indices, 0);
+	stream.flush();
+
+	auto lastCycle = snapshot->_cycle;
+	auto lastWrite = std::chrono::steady_clock::now();
+	auto nextEvent = lastWrite + _eventInterval;
+	while (!stream.failed())
+	{
+		// Wait until the next event may be sent, and for a new snapshot
+		if (!_dataSnapshot.sleepUntil(nextEvent))
+		{
+			break;
+		}
+		snapshot = _dataSnapshot.waitForSnapshot(lastCycle, lastWrite + kEventKeepAliveInterval);
+		if (_dataSnapshot.stopped())
+		{
+			break;
+		}
+
+		// Send the values that changed in any of the cycles since the last event
+		const auto now = std::chrono::steady_clock::now();
+		if (snapshot && appendEvent(stream, "change"sv, *snapshot, indices, lastCycle))
+		{
+			stream.flush();
+			lastWrite = now;
+			nextEvent = now + _eventInterval;
+		}
+		else if (now - lastWrite >= kEventKeepAliveInterval)
+		{
+			stream.append(": keep-alive\n\n"sv);
+			stream.flush();
+			lastWrite = now;
+		}
+		if (snapshot)
+		{
+			lastCycle = snapshot->_cycle;
+		}
+	}
+
+	_metrics.endSubscription();
+	context._responseSize = stream.size();
+	context.recordStage(RequestStage::Write, stream.writeTime());
+	return {};
+}
+
+auto Server::appendEvent(ResponseStream &stream,
+	std::string_view type,
+	const DataSnapshot::Snapshot &snapshot,
+	std::span<const std::size_t> indices,
+	std::uint64_t changedAfter) -> bool
+{
+	bool first = true;
+	for (auto index : indices)
+	{
+		if (snapshot._changes[index] <= changedAfter)
+		{
+			continue;
+		}
+
+		// Start the event before the first value
+		if (std::exchange(first, false))
+		{
+			char cycle[24];
+			const auto cycleEnd = std::to_chars(std::begin(cycle), std::end(cycle), snapshot._cycle).ptr;
+			stream.append("id: "sv);
+			stream.append({ std::begin(cycle), cycleEnd });
+			stream.append("\nevent: "sv);
+			stream.append(type);
+			stream.append("\ndata: {"sv);
+		}
+		else
+		{
+			stream.append(","sv);
+		}
+		stream.append(_dataSnapshot.memberName(index));
+		stream.append(snapshot._fragments[index]);
+	}
+
+	if (first)
+	{
+		return false;
+	}
+
+	stream.append("}\n\n"sv);
+	_metrics.recordEvent();
+	return true;
+}
+
+auto Server::writeResponse(lh_con_t *connection, const lh_rqi_t *request) -> std::string_view
+{
+	std::vector<WriteQueue::Write> writes;
+	thread_local std::string path;
+	thread_local std::string text;
+
+	JsonReader reader(readBody(connection, request));
+	reader.beginObject();
+	while (reader.nextMember(path))
+	{
+		// Find the attribute
+		const auto index = _dataSnapshot.find(path);
+		if (!index)
+		{
+			throw HttpError("404 Not Found"sv, utils::string::cat("unknown attribute \"", path, "\""));
+		}
+		if (!_dataSnapshot.writable(*index))
+		{
+			throw HttpError("403 Forbidden"sv, utils::string::cat("attribute \"", path, "\" is not writable"));
+		}
+
+		// Convert the value to the type of the attribute, so that the write task does not have to
+		const auto invalidValue = [&] {
+			return HttpError("400 Bad Request"sv, utils::string::cat("invalid value for attribute \"", path, "\""));
+		};
+		const auto convertNumber = [&]<class Number>(Number value) {
+			const auto number = reader.readNumber();
+			const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+			if (error != std::errc() || end != number.data() + number.size())
+			{
+				throw invalidValue();
+			}
+			return value;
+		};
+		switch (_dataSnapshot.valueType(*index))
+		{
+		case DataSnapshot::ValueType::Boolean:
+			if (reader.nextKind() != JsonReader::Kind::Boolean)
+			{
+				throw invalidValue();
+			}
+			writes.push_back({ *index, reader.readBoolean() });
+			break;
+		case DataSnapshot::ValueType::Integer:
+			writes.push_back({ *index, convertNumber(std::int64_t(0)) });
+			break;
+		case DataSnapshot::ValueType::UnsignedInteger:
+			writes.push_back({ *index, convertNumber(std::uint64_t(0)) });
+			break;
+		case DataSnapshot::ValueType::FloatingPoint:
+			writes.push_back({ *index, convertNumber(0.0) });
+			break;
+		case DataSnapshot::ValueType::String:
+			if (reader.nextKind() != JsonReader::Kind::String)
+			{
+				throw invalidValue();
+			}
+			reader.readString(text);
+			writes.push_back({ *index, text });
+			break;
+		default:
+			throw HttpError("403 Forbidden"sv, utils::string::cat("attribute \"", path, "\" is not writable"));
+		}
+	}
+	reader.finish();
+
+	// Queue the writes for the write task
+	if (!writes.empty() && !_writeQueue.push(std::move(writes)))
+	{
+		return _writeQueueFullResponse;
+	}
+
+	return _writeAcceptedResponse;
+}
+
+auto Server::readBody(lh_con_t *connection, const lh_rqi_t *request) -> std::string_view
+{
+	// The size of the body must be known in advance
+	if (request->content_length < 0)
+	{
+		throw HttpError("411 Length Required"sv, "the request must have a Content-Length"sv);
+	}
+	if (request->content_length > kMaxRequestBodySize)
+	{
+		throw HttpError("413 Content Too Large"sv, "the request body is too large"sv);
+	}
+
+	// Read the body into a buffer that is reused by this thread
+	thread_local std::string body;
+	body.resize(std::size_t(request->content_length));
+	for (std::size_t received = 0; received < body.size();)
+	{
+		const auto count = httplib_read(_context, connection, body.data() + received, body.size() - received);
+		if (count <= 0)
+		{
+			throw HttpError("400 Bad Request"sv, "the request body is incomplete"sv);
+		}
+		received += std::size_t(count);
+	}
+
+	return body;
+}
+
+auto Server::responseStatus(std::string_view response) noexcept -> std::uint16_t
+{
+	constexpr auto kStatusStart = "HTTP/1.1 "sv.size();
+	std::uint16_t status = 0;
+	if (response.size() > kStatusStart)
+	{
+		std::from_chars(response.data() + kStatusStart, response.data() + response.size(), status);
+	}
+	return status;
+}
+
+auto Server::sendPreparedResponse(lh_con_t *connection, std::string_view response) -> void
+{
 	httplib_write(_context, connection, response.data(), response.size());
+}
+
+auto Server::prepareResponses() -> void
+{
+	serializeResponse(_greetingResponse, "200 OK"sv, "Hello from Xentara!"sv, {});
+	serializeResponse(_methodNotAllowedResponse, "405 Method Not Allowed"sv,
+		"only the \"GET\" method is accepted for this path"sv, "Allow: GET\r\n"sv);
+	serializeResponse(_batchMethodNotAllowedResponse, "405 Method Not Allowed"sv,
+		"only the \"GET\", \"POST\" and \"PUT\" methods are accepted for this path"sv, "Allow: GET, POST, PUT\r\n"sv);
+	serializeResponse(_dataNotFoundResponse, "404 Not Found"sv, "unknown attribute"sv, {});
+	serializeResponse(_writeAcceptedResponse, "202 Accepted"sv, "the writes will be applied in the next cycle"sv, {});
+	serializeResponse(_writeQueueFullResponse, "503 Service Unavailable"sv, "too many writes are waiting"sv, {});
 
+	// List the IDs of the attributes, for use with WebSockets
+	std::string attributeList = "{"s;
+	for (std::size_t index = 0; index < _dataSnapshot.size(); ++index)
+	{
+		if (index > 0)
+		{
+			attributeList.push_back(',');
+		}
+		attributeList.append(_dataSnapshot.memberName(index));
+		json::appendNumber(attributeList, std::uint64_t(index));
+	}
+	attributeList.push_back('}');
+
+	// Compress the list in advance for clients that accept it
+	_attributeListSizes[std::size_t(ContentCoding::Identity)] = attributeList.size();
+	serializeResponse(_attributeListResponses[std::size_t(ContentCoding::Identity)], "200 OK"sv, attributeList,
+		kVaryEncodingHeader, "application/json"sv);
+	if (_compression.shouldCompress(attributeList.size()))
+	{
+		for (auto coding : { ContentCoding::Gzip, ContentCoding::Deflate })
+		{
+			std::string compressed;
+			_compression.compress(coding, attributeList, compressed);
+			_attributeListSizes[std::size_t(coding)] = compressed.size();
+			serializeResponse(_attributeListResponses[std::size_t(coding)], "200 OK"sv, compressed,
+				compressedHeaders(kVaryEncodingHeader, coding), "application/json"sv);
+		}
+	}
+
+	_eventStreamHeader = "HTTP/1.1 200 OK\r\n"
+						 "Content-Type: text/event-stream\r\n"
+						 "Cache-Control: no-cache\r\n"
+						 "Connection: close\r\n\r\n"sv;
+	serializeResponse(_groupNotFoundResponse, "404 Not Found"sv, "unknown group"sv, {});
+	_notModifiedStatus = "HTTP/1.1 304 Not Modified\r\n"sv;
+	serializeResponse(_dataUnavailableResponse, "503 Service Unavailable"sv, "no data available yet"sv, {});
+	serializeResponse(_tooManySubscriptionsResponse, "503 Service Unavailable"sv, "too many event subscriptions"sv,
+		"Retry-After: 10\r\n"sv);
+
+	// Prepare a response for each rate limit, telling the client when it can try again
+	_rateLimitResponses.resize(_rateLimiter.limitCount());
+	for (std::size_t index = 0; index < _rateLimitResponses.size(); ++index)
+	{
+		char retryAfter[16];
+		const auto retryAfterEnd =
+			std::to_chars(std::begin(retryAfter), std::end(retryAfter), _rateLimiter.retryAfter(index)).ptr;
+		serializeResponse(_rateLimitResponses[index], "429 Too Many Requests"sv, "rate limit exceeded"sv,
+			"Retry-After: "s.append(std::begin(retryAfter), retryAfterEnd).append("\r\n"sv));
+	}
+
+	// Prepare a response for every way authentication can fail
+	for (std::size_t index = 0; index < kAuthenticationResultCount; ++index)
+	{
+		const auto result = AuthenticationResult(index);
+		if (result == AuthenticationResult::Success)
+		{
+			continue;
+		}
+
+		const auto &error = _authentication->errorResponse(result);
+		serializeResponse(_authenticationResponses[index], error.responseCode(), error.responseData(), {});
+	}
 }
 
 } // namespace xentara::samples::webService
\ No newline at end of file
@@ -6,13 +6,35 @@
 #include <xentara/plugin/EnableSharedFromThis.hpp>
 #include <xentara/process/Microservice.hpp>
 #include <xentara/process/MicroserviceClass.hpp>
+#include <xentara/process/Task.hpp>
 #include <xentara/utils/ios/toLocal.hpp>
 #include <xentara/utils/network/Types.hpp>
 
 #include "AbstractAuthenticationProvider.hpp"
+#include "AccessLog.hpp"
+#include "Compression.hpp"
+#include "ConnectionOptions.hpp"
+#include "DataSnapshot.hpp"
+#include "Encoding.hpp"
 #include "HttpError.hpp"
+#include "HttpResponse.hpp"
+#include "KernelTls.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "RateLimiter.hpp"
+#include "RequestContext.hpp"
+#include "ResponseStream.hpp"
+#include "TlsSessions.hpp"
+#include "WebSocketHub.hpp"
+#include "WriteQueue.hpp"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 
@@ -22,7 +44,7 @@ namespace xentara::samples::webService
 {
 
 // A class representing a web server for exchaning data.
-class Server final : public process::Microservice
+class Server final : public process::Microservice, public plugin::EnableSharedFromThis<Server>
 {
 public:
 	// The class object containing meta-information about this element type
@@ -53,6 +75,10 @@ public:
 		static Class _instance;
 	};
 
+	//  Resolves the "collect" task, which takes the snapshots of the data served by the server, and the "write" task,
+	// which applies the writes requested by clients
+	auto resolveTask(std::u16string_view name) -> std::shared_ptr<process::Task> final;
+
 protected:
 	//  loads the configuration from the json model file
 	auto loadConfig(const ConfigIntializer &initializer,
@@ -66,18 +92,162 @@ protected:
 	//  override of the cleanup.
 	auto cleanup() -> void final
 	{
+		// End the event subscriptions, so that their worker threads can exit, and stop sending to WebSocket clients
+		_dataSnapshot.stop();
+		_webSockets.stop();
 		httplib_stop(_context);
+
+		// Write any remaining log messages and access log records
+		_logger.stop();
+		if (_accessLog)
+		{
+			_accessLog->stop();
+		}
 	}
 
 private:
+	//  The task that takes the snapshots of the data served by the server
+	class CollectTask final : public process::Task
+	{
+	public:
+		//  Constructor
+		CollectTask(std::reference_wrapper<Server> server) : _server(server)
+		{
+		}
+
+		auto stages() const -> Stages final
+		{
+			return Stage::PreOperational | Stage::Operational;
+		}
+
+		auto preOperational(const process::ExecutionContext &context) -> Status final;
+
+		auto operational(const process::ExecutionContext &context) -> void final;
+
+	private:
+		//  The server
+		std::reference_wrapper<Server> _server;
+	};
+
+	//  The task that applies the writes requested by clients
+	class WriteTask final : public process::Task
+	{
+	public:
+		//  Constructor
+		WriteTask(std::reference_wrapper<Server> server) : _server(server)
+		{
+		}
+
+		auto stages() const -> Stages final
+		{
+			return Stage::Operational;
+		}
+
+		auto operational(const process::ExecutionContext &context) -> void final;
+
+	private:
+		//  The server
+		std::reference_wrapper<Server> _server;
+	};
+
 	//  Load the details for the authentication Provider
 	auto loadAuthenticationProvider(utils::json::decoder::Object &jsonObject) -> void;
 
-	// Sent HTTPs Responce
-	auto sendResponse(lh_con_t *connection,
-		std::string_view responseCode,
-		std::string_view responseData = {},
-		std::string_view extraHeaderFiels = {}) -> void;
+	//  Sends a complete response
+	auto sendPreparedResponse(lh_con_t *connection, std::string_view response) -> void;
+
+	//  Builds a successful response that is not prepared in advance, compressing the body if it is large enough and the
+	// client accepts it
+	//  extraHeaders the headers to send in addition to the content headers, including the Vary header
+	//  @return the complete response, which is valid until the next call from the same thread
+	auto compressibleResponse(const lh_con_t *connection,
+		std::string_view body,
+		std::string_view extraHeaders,
+		std::string_view contentType) -> std::string_view;
+
+	//  Checks whether the client already has a specific version of some values, using the If-None-Match header, and
+	// prepares the headers to send with the values otherwise. This does not look at the values themselves, so that
+	// clients polling for values that have not changed cost almost nothing.
+	//  version the number of the cycle in which the values last changed
+	//  headers receives the headers to send with the values, including the ETag and Vary headers
+	//  @return the complete 304 response if the client has the values, or an empty string if they must be sent
+	auto checkVersion(const lh_con_t *connection, std::uint64_t version, Encoding encoding, std::string &headers) const
+		-> std::string_view;
+
+	//  Builds the response to a request for the metrics
+	//  @return the complete response, which is valid until the next call from the same thread
+	auto metricsResponse(const lh_con_t *connection) -> std::string_view;
+
+	//  Builds the response to a request for the value of an attribute
+	//  path the path of the attribute, without the leading "/data/"
+	//  encoding the encoding the client asked for
+	//  @return the complete response, which is valid until the next call from the same thread
+	auto dataResponse(const lh_con_t *connection, std::string_view path, Encoding encoding) -> std::string_view;
+
+	//  Selects the prepared response listing the IDs of the attributes, compressed if the client accepts it
+	//  @return the complete response
+	auto attributeListResponse(const lh_con_t *connection) -> std::string_view;
+
+	//  Handles a request for the values of a list of attributes. The body of the request is a JSON array with the paths
+	// of the attributes.
+	//  @return the complete response to send, or an empty string if the response was already written
+	auto batchResponse(lh_con_t *connection, const lh_rqi_t *request, Encoding encoding, RequestContext &context)
+		-> std::string_view;
+
+	//  Writes the values of several attributes as a map whose keys are the paths of the attributes, using the encoding
+	// the client asked for. The response is streamed to the connection straight from the current snapshot. If the body
+	// is compressed, it is compressed into a buffer first, so that its size is known.
+	//  group the group the attributes are the members of, or nullptr for any other list of attributes. The values of
+	// groups are sent with an entity tag, and their compressed bodies are cached.
+	//  @return the complete response to send, or an empty string if the response was already written
+	auto streamValues(lh_con_t *connection,
+		std::span<const std::size_t> indices,
+		Encoding encoding,
+		const DataSnapshot::Group *group,
+		RequestContext &context) -> std::string_view;
+
+	//  Handles a request to subscribe to the changes of a group or a list of attributes. The attributes are selected
+	// using the query parameter "group", or one or more query parameters "path".
+	//  @return the complete response to send, or an empty string if the events were already written
+	auto subscribe(lh_con_t *connection, const lh_rqi_t *request, RequestContext &context) -> std::string_view;
+
+	//  Sends the values of several attributes as Server-Sent Events until the client disconnects or the server stops.
+	// The first event contains all values, and each following event the values that changed since the previous one.
+	//  @return the complete response to send, or an empty string if the events were already written
+	auto streamEvents(lh_con_t *connection, std::span<const std::size_t> indices, RequestContext &context)
+		-> std::string_view;
+
+	//  Appends an event with the values of the attributes that changed after a specific cycle
+	//  type the type of the event
+	//  changedAfter the number of the cycle after which the values must have changed, or 0 for all values
+	//  @return true if an event was appended, or false if none of the values had changed
+	auto appendEvent(ResponseStream &stream,
+		std::string_view type,
+		const DataSnapshot::Snapshot &snapshot,
+		std::span<const std::size_t> indices,
+		std::uint64_t changedAfter) -> bool;
+
+	//  Handles a request to write attributes. The body of the request is a JSON object whose member names are the paths
+	// of the attributes, and whose values are the values to write.
+	//  @return the complete response to send
+	auto writeResponse(lh_con_t *connection, const lh_rqi_t *request) -> std::string_view;
+
+	//  Reads the complete body of a request. The body is read into a buffer that is reused for all requests of the
+	// calling thread.
+	//  @return the body, which is valid until the next call from the same thread
+	auto readBody(lh_con_t *connection, const lh_rqi_t *request) -> std::string_view;
+
+	//  Gets the status code from a complete response, which starts with "HTTP/1.1 " and the code
+	//  @return the status code, or 0 if the response has no valid status line
+	static auto responseStatus(std::string_view response) noexcept -> std::uint16_t;
+
+	//  Handles a request
+	//  context receives information about the request for the access log and the metrics
+	//  @return the complete response to send
+	auto handleRequest(lh_con_t *connection, const lh_rqi_t *request, RequestContext &context) -> std::string_view;
+
+	//  Prepares the responses that never change, so that they can be sent without building them again
+	auto prepareResponses() -> void;
 
 	//  Message handler
 	auto logMessageHandler(const lh_con_t *connection, const char *message) -> int;
@@ -85,10 +255,48 @@ private:
 	//  handler for incoming client messages
 	auto beginRequestHandler(lh_con_t *connection) -> int;
 
+	//  Handler for the initialization of the OpenSSL context
+	auto initSslHandler(void *sslContext) -> int;
+
+	//  Handler for WebSocket handshakes, which authenticates the client
+	//  @return 0 to accept the connection, or 1 to close it
+	auto webSocketConnectHandler(const lh_con_t *connection) -> int;
+
+	//  Handler for WebSocket connections that are ready to use
+	auto webSocketReadyHandler(lh_con_t *connection) -> void;
+
+	//  Handler for messages from WebSocket clients
+	//  @return 1 to keep the connection open, or 0 to close it
+	auto webSocketDataHandler(lh_con_t *connection, int bits, char *data, std::size_t size) -> int;
+
+	//  Handler for connections that are being closed
+	auto connectionCloseHandler(const lh_con_t *connection) -> void;
+
 	//  Statis version of logMessageHandler
 	// Uses context's user data as the server to call logMessageHandler()
 	static auto staticLogMessageHandler(lh_ctx_t *context, const lh_con_t *connection, const char *message) -> int;
 
+	//  Statis version of initSslHandler
+	// Uses context's user data as the server to call initSslHandler()
+	static auto staticInitSslHandler(lh_ctx_t *context, void *sslContext, void *userData) -> int;
+
+	//  Statis version of webSocketConnectHandler
+	// Uses context's user data as the server to call webSocketConnectHandler()
+	static auto staticWebSocketConnectHandler(lh_ctx_t *context, const lh_con_t *connection) -> int;
+
+	//  Statis version of webSocketReadyHandler
+	// Uses context's user data as the server to call webSocketReadyHandler()
+	static auto staticWebSocketReadyHandler(lh_ctx_t *context, lh_con_t *connection) -> void;
+
+	//  Statis version of webSocketDataHandler
+	// Uses context's user data as the server to call webSocketDataHandler()
+	static auto staticWebSocketDataHandler(lh_ctx_t *context, lh_con_t *connection, int bits, char *data, size_t size)
+		-> int;
+
+	//  Statis version of connectionCloseHandler
+	// Uses context's user data as the server to call connectionCloseHandler()
+	static auto staticConnectionCloseHandler(lh_ctx_t *context, const lh_con_t *connection) -> void;
+
 	//  Statis version of beginRequestHandler
 	// Uses context's user data as the server to call beginRequestHandler()
 	static auto staticBeginRequestHandler(lh_ctx_t *context, lh_con_t *connection) -> int;
@@ -96,13 +304,120 @@ private:
 	//  The portNumber of the Server
 	utils::network::PortNumber _portNumber;
 
+	//  The logger for the messages from libhttp and the authentication. This is declared before the authentication
+	// provider, so that it is destroyed after the threads of the provider have stopped.
+	Logger _logger;
+
 	//  The authetication method for the Server
 	std::unique_ptr<AbstractAuthenticationProvider> _authentication;
 
 	//  Server Certificate for the Server
 	std::filesystem::path _serverCertificatePath;
 
+	//  The options for the worker threads and connections
+	ConnectionOptions _connectionOptions;
+
+	//  The configuration of TLS session resumption
+	TlsSessions _tlsSessions;
+
+	//  Whether the kernel should encrypt and decrypt TLS records
+	bool _kernelTlsEnabled { false };
+
+	//  The kernel TLS support, if enabled
+	KernelTls _kernelTls;
+
 	//  context
 	lh_ctx_t *_context { nullptr };
+
+	//  The access log, or nullptr if no access log is written
+	std::unique_ptr<AccessLog> _accessLog;
+
+	//  The statistics about the requests
+	Metrics _metrics;
+
+	//  The path the metrics are served on without authentication, or an empty string if the metrics are not served
+	std::string _metricsPath { "/metrics" };
+
+	//  The snapshots of the attributes served under /data/
+	DataSnapshot _dataSnapshot;
+
+	//  The task that takes the snapshots
+	CollectTask _collectTask { *this };
+
+	//  The task that applies the writes
+	WriteTask _writeTask { *this };
+
+	//  The writes waiting for the write task
+	WriteQueue _writeQueue;
+
+	//  The WebSocket clients
+	WebSocketHub _webSockets { _dataSnapshot };
+
+	//  The compression of responses
+	Compression _compression;
+
+	//  The rate limits of the clients
+	RateLimiter _rateLimiter;
+
+	//  The caches of the compressed values of each group, indexed by the index of the group
+	std::unique_ptr<CompressedCache[]> _groupCaches;
+
+	//  Identifies this run of the server in entity tags, so that tags from before a restart never match
+	std::string _instanceTag;
+
+	//  The minimum time between two events sent to the same subscriber
+	std::chrono::milliseconds _eventInterval { 0 };
+
+	//  The maximum number of open event subscriptions, or std::nullopt to use half the worker threads
+	std::optional<std::uint32_t> _maxSubscriptions;
+
+	//  The number of open event subscriptions, for enforcing _maxSubscriptions
+	std::atomic<std::uint32_t> _openSubscriptions { 0 };
+
+	//  The prepared response to an authenticated GET request
+	std::string _greetingResponse;
+
+	//  The prepared response to an authenticated request with a method other than GET
+	std::string _methodNotAllowedResponse;
+
+	//  The prepared response to an authenticated request to /data with a method other than GET, POST or PUT
+	std::string _batchMethodNotAllowedResponse;
+
+	//  The prepared response to a request for an attribute that is not served
+	std::string _dataNotFoundResponse;
+
+	//  The prepared response to a request whose writes were queued
+	std::string _writeAcceptedResponse;
+
+	//  The prepared response to a write request that was rejected because too many writes are waiting
+	std::string _writeQueueFullResponse;
+
+	//  The prepared responses listing the IDs of the attributes, indexed by the content coding
+	std::array<std::string, kContentCodingCount> _attributeListResponses;
+
+	//  The size of the list of attributes, and of its compressed forms, indexed by the content coding. The size is 0
+	// for content codings that are not used, because the list is too small.
+	std::array<std::size_t, kContentCodingCount> _attributeListSizes {};
+
+	//  The prepared status line of a response to a client that already has the current values
+	std::string _notModifiedStatus;
+
+	//  The prepared status line and headers of an event stream
+	std::string _eventStreamHeader;
+
+	//  The prepared response to a request for a group that does not exist
+	std::string _groupNotFoundResponse;
+
+	//  The prepared response to a request for an attribute before the first snapshot was taken
+	std::string _dataUnavailableResponse;
+
+	//  The prepared response to a subscription request while the maximum number of subscriptions is open
+	std::string _tooManySubscriptionsResponse;
+
+	//  The prepared responses to requests that failed authentication, indexed by the authentication result
+	std::array<std::string, kAuthenticationResultCount> _authenticationResponses;
+
+	//  The prepared responses to clients that exceeded their rate limit, indexed by the limit
+	std::vector<std::string> _rateLimitResponses;
 };
 } // namespace xentara::samples::webService
\ No newline at end of file
@@ -83,34 +83,36 @@ auto SimpleTokenVerification::loadConfig(utils::json::decoder::Object &jsonObjec
 	}
 }
 
-auto SimpleTokenVerification::initialize() -> void
+auto SimpleTokenVerification::initialize(Logger &logger) -> void
 {
 	// Read the key from the file
-	auto key = readFile(_keyFile);
+	_key = readFile(_keyFile);
 
-	// Store the Verifier
-	_verifier = _verifierFactory.get().create(key);
+	// Create the verifier for this thread right away, so that an invalid key is reported at startup
+	_verifiers.local() = _verifierFactory.get().create(_key);
 }
 
-auto SimpleTokenVerification::verify(const JwtToken &token) -> void
+auto SimpleTokenVerification::verify(const DecodedJwt &token) -> AuthenticationResult
 {
-	// error code of the verifier
-	std::error_code errorCode;
+	// Verify the signature
+	return verifySignature(verifier(), token);
+}
 
-	// Verify the token
-	_verifier->verify(token, errorCode);
+auto SimpleTokenVerification::precheck(const DecodedJwt &token) -> bool
+{
+	return token.algorithm() == verifier().algorithm();
+}
 
-	// Check if there is any error during the verification process
-	if (errorCode.value() != static_cast<int>(jwt::error::token_verification_error::ok))
+auto SimpleTokenVerification::verifier() -> const SignatureVerifier &
+{
+	// Create the verifier for this thread if necessary
+	auto &verifier = _verifiers.local();
+	if (!verifier)
 	{
-		// Ignore token expiration error
-		if (errorCode.value() != static_cast<int>(jwt::error::token_verification_error::token_expired))
-		{
-			throw std::runtime_error(errorCode.message());
-		}
+		verifier = _verifierFactory.get().create(_key);
 	}
 
-	return;
+	return *verifier;
 }
 
 } // namespace xentara::samples::webService
\ No newline at end of file
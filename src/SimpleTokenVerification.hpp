@@ -4,11 +4,11 @@
 #include <xentara/utils/json/decoder/Document.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
 
-#include "JwtCpp.hpp"
 #include "AbstractTokenVerification.hpp"
+#include "PerThread.hpp"
 #include "TokenVerifierFactory.hpp"
 
-#include <optional>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -28,20 +28,31 @@ public:
 	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void final;
 
 	// Override function of AbstractTokenVerification::initialize()
-	auto initialize() -> void final;
+	auto initialize(Logger &logger) -> void final;
 
 	// Override function of AbstractTokenVerification::verify(...)
-	auto verify(const JwtToken &token) -> void final;
+	auto verify(const DecodedJwt &token) -> AuthenticationResult final;
+
+	// Override function of AbstractTokenVerification::precheck(...). This function checks that the token uses the
+	// algorithm of the key
+	auto precheck(const DecodedJwt &token) -> bool final;
 
 private:
+	//  Gets the verifier for the calling thread, creating it if necessary
+	auto verifier() -> const SignatureVerifier &;
+
 	//  Path to the keyFile
 	std::filesystem::path _keyFile;
 
 	//  The factory the create the verifier
 	std::reference_wrapper<const TokenVerifierFactory> _verifierFactory;
 
-	//  the verifier
-	std::optional<JwtVerifier> _verifier;
+	//  The key read from the key file
+	std::string _key;
+
+	//  The verifiers for each worker thread. Each thread gets its own verifier with its own copy of the key, so that
+	// the threads do not share any cryptographic state.
+	PerThread<std::unique_ptr<SignatureVerifier>> _verifiers;
 };
 
 } // namespace xentara::samples::webService
@@ -0,0 +1,35 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace xentara::samples::webService
+{
+
+//  A hash for strings that also accepts string views, so that unordered containers with string keys can be searched
+// using a string view without creating a temporary string.
+struct StringHash
+{
+	//  Marks the hash as transparent
+	using is_transparent = void;
+
+	//  Calculates the hash
+	auto operator()(std::string_view string) const noexcept -> std::size_t
+	{
+		return std::hash<std::string_view> {}(string);
+	}
+};
+
+//  An unordered set of strings that can be searched using string views
+using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+
+//  An unordered map with string keys that can be searched using string views
+template <class Value>
+using StringMap = std::unordered_map<std::string, Value, StringHash, std::equal_to<>>;
+
+} // namespace xentara::samples::webService
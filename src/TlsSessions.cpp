@@ -0,0 +1,288 @@
+// Copyright (c) embedded ocean GmbH
+
+#include <xentara/config/Errors.hpp>
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include "TlsSessions.hpp"
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  The context for the sessions of this server. Sessions are only resumed by servers with the same context.
+	constexpr std::string_view kSessionIdContext = "xentara-web-service"sv;
+
+	//  The name of the digest used for the HMAC of session tickets
+	char kTicketDigest[] = "SHA256";
+} // namespace
+
+TlsSessions::TicketKey::~TicketKey()
+{
+	OPENSSL_cleanse(_encryptionKey.data(), _encryptionKey.size());
+	OPENSSL_cleanse(_hmacKey.data(), _hmacKey.size());
+}
+
+auto TlsSessions::loadConfig(utils::json::decoder::Object &jsonObject) -> void
+{
+	// Go through all parameters
+	for (auto &&[key, value] : jsonObject)
+	{
+		if (key == u8"cacheSize")
+		{
+			// The size of the session cache is a number, and 0 disables the cache
+			_cacheSize = value.asNumber<std::size_t>();
+		}
+		else if (key == u8"lifetime")
+		{
+			// The lifetime is a number of seconds
+			_lifetime = std::chrono::seconds(value.asNumber<std::uint32_t>());
+
+			// The lifetime must not be 0
+			if (_lifetime.count() == 0)
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error("lifetime of the TLS sessions of the Web Service Server must not be 0"));
+			}
+		}
+		else if (key == u8"tickets")
+		{
+			_tickets = value.asBool();
+		}
+		else if (key == u8"ticketKeyRotation")
+		{
+			// The rotation interval is a number of seconds
+			_ticketKeyRotation = std::chrono::seconds(value.asNumber<std::uint32_t>());
+
+			// The interval must not be 0
+			if (_ticketKeyRotation.count() == 0)
+			{
+				utils::json::decoder::throwWithLocation(value,
+					std::runtime_error(
+						"ticketKeyRotation of the TLS sessions of the Web Service Server must not be 0"));
+			}
+		}
+		else
+		{
+			config::throwUnknownParameterError(key);
+		}
+	}
+}
+
+auto TlsSessions::configure(SSL_CTX *context) -> void
+{
+	_context = context;
+
+	// Let OpenSSL find this object from within the ticket callback
+	if (!SSL_CTX_set_ex_data(context, dataIndex(), this))
+	{
+		throw std::runtime_error("could not configure TLS sessions of the Web Service Server");
+	}
+
+	// Only resume sessions created by this server
+	SSL_CTX_set_session_id_context(context, reinterpret_cast<const unsigned char *>(kSessionIdContext.data()),
+		unsigned(kSessionIdContext.size()));
+	SSL_CTX_set_timeout(context, long(_lifetime.count()));
+
+	// Configure the session cache, which is shared by all connections of the context
+	if (_cacheSize > 0)
+	{
+		SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(context, long(_cacheSize));
+	}
+	else
+	{
+		SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+	}
+
+	// Configure the session tickets
+	if (_tickets)
+	{
+		SSL_CTX_clear_options(context, SSL_OP_NO_TICKET);
+		SSL_CTX_set_tlsext_ticket_key_evp_cb(context, &TlsSessions::staticTicketKeyCallback);
+	}
+	else
+	{
+		SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+	}
+}
+
+auto TlsSessions::formatMetrics(std::string &text) const -> void
+{
+	if (!_context)
+	{
+		return;
+	}
+
+	Metrics::formatCounter(text, "tls_handshakes_total"sv, "Number of completed TLS handshakes."sv,
+		std::uint64_t(SSL_CTX_sess_accept_good(_context)));
+	Metrics::formatCounter(text, "tls_session_cache_hits_total"sv,
+		"Number of TLS sessions resumed, as counted by OpenSSL."sv, std::uint64_t(SSL_CTX_sess_hits(_context)));
+	Metrics::formatCounter(text, "tls_session_cache_misses_total"sv,
+		"Number of session IDs sent by clients that were not found in the session cache."sv,
+		std::uint64_t(SSL_CTX_sess_misses(_context)));
+	Metrics::formatCounter(text, "tls_session_cache_timeouts_total"sv,
+		"Number of sessions offered by clients that had expired."sv, std::uint64_t(SSL_CTX_sess_timeouts(_context)));
+	Metrics::formatCounter(text, "tls_tickets_issued_total"sv, "Number of TLS session tickets issued."sv,
+		_ticketsIssued.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "tls_ticket_resumptions_total"sv,
+		"Number of TLS session tickets accepted for resuming a session."sv,
+		_ticketResumptions.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "tls_ticket_unknown_keys_total"sv,
+		"Number of TLS session tickets rejected because their key was no longer known."sv,
+		_unknownTicketKeys.load(std::memory_order_relaxed));
+}
+
+auto TlsSessions::ticketKeys() -> std::shared_ptr<const TicketKeys>
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	// Use the current keys if the current key is not due for replacement
+	auto keys = _ticketKeys.load(std::memory_order_acquire);
+	if (keys && now < keys->_rotationTime)
+	{
+		return keys;
+	}
+
+	// Make sure no other thread replaced the key in the meantime
+	std::scoped_lock lock(_rotationMutex);
+	keys = _ticketKeys.load(std::memory_order_acquire);
+	if (keys && now < keys->_rotationTime)
+	{
+		return keys;
+	}
+
+	// Generate a new key
+	auto newKey = std::make_shared<TicketKey>();
+	if (RAND_bytes(newKey->_name.data(), int(newKey->_name.size())) != 1 ||
+		RAND_bytes(newKey->_encryptionKey.data(), int(newKey->_encryptionKey.size())) != 1 ||
+		RAND_bytes(newKey->_hmacKey.data(), int(newKey->_hmacKey.size())) != 1)
+	{
+		return keys;
+	}
+
+	auto newKeys = std::make_shared<TicketKeys>();
+	newKeys->_keys.push_back(std::move(newKey));
+	newKeys->_rotationTime = now + _ticketKeyRotation;
+
+	// Keep the old keys as long as tickets encrypted with them can still be used. The keys are shared between the
+	// sets, so the retire time of the previous current key can be set here without affecting readers of the old set.
+	if (keys)
+	{
+		for (auto &&key : keys->_keys)
+		{
+			if (key->_retireTime == std::chrono::steady_clock::time_point::max())
+			{
+				key->_retireTime = now;
+			}
+			if (now < key->_retireTime + _lifetime)
+			{
+				newKeys->_keys.push_back(key);
+			}
+		}
+	}
+
+	_ticketKeys.store(newKeys, std::memory_order_release);
+	return newKeys;
+}
+
+auto TlsSessions::handleTicket(unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipherContext,
+	EVP_MAC_CTX *macContext, bool encrypt) -> int
+{
+	const auto keys = ticketKeys();
+	if (!keys || keys->_keys.empty())
+	{
+		return -1;
+	}
+
+	// Find the key
+	const TicketKey *key = nullptr;
+	if (encrypt)
+	{
+		// New tickets are always encrypted with the current key, using a random initialization vector
+		key = keys->_keys.front().get();
+		std::memcpy(keyName, key->_name.data(), key->_name.size());
+		if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1)
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		// Find the key the ticket was encrypted with
+		const auto found = std::ranges::find_if(keys->_keys, [&](const auto &candidate) {
+			return std::memcmp(keyName, candidate->_name.data(), candidate->_name.size()) == 0;
+		});
+		if (found == keys->_keys.end())
+		{
+			_unknownTicketKeys.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+		key = found->get();
+	}
+
+	// Set up the HMAC
+	OSSL_PARAM parameters[] = {
+		OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, const_cast<unsigned char *>(key->_hmacKey.data()),
+			key->_hmacKey.size()),
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, kTicketDigest, 0), OSSL_PARAM_construct_end()
+	};
+	if (!EVP_MAC_CTX_set_params(macContext, parameters))
+	{
+		return -1;
+	}
+
+	// Set up the cipher
+	if (encrypt)
+	{
+		if (!EVP_EncryptInit_ex(cipherContext, EVP_aes_256_cbc(), nullptr, key->_encryptionKey.data(), iv))
+		{
+			return -1;
+		}
+
+		_ticketsIssued.fetch_add(1, std::memory_order_relaxed);
+		return 1;
+	}
+
+	if (!EVP_DecryptInit_ex(cipherContext, EVP_aes_256_cbc(), nullptr, key->_encryptionKey.data(), iv))
+	{
+		return -1;
+	}
+
+	// Ask the client to replace tickets encrypted with an old key
+	_ticketResumptions.fetch_add(1, std::memory_order_relaxed);
+	return key == keys->_keys.front().get() ? 1 : 2;
+}
+
+auto TlsSessions::staticTicketKeyCallback(SSL *connection, unsigned char *keyName, unsigned char *iv,
+	EVP_CIPHER_CTX *cipherContext, EVP_MAC_CTX *macContext, int encrypt) -> int
+{
+	auto sessions = static_cast<TlsSessions *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(connection), dataIndex()));
+	if (!sessions)
+	{
+		return -1;
+	}
+
+	return sessions->handleTicket(keyName, iv, cipherContext, macContext, encrypt != 0);
+}
+
+auto TlsSessions::dataIndex() -> int
+{
+	static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+	return index;
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,122 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/json/decoder/Document.hpp>
+#include <xentara/utils/json/decoder/Errors.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+
+namespace xentara::samples::webService
+{
+
+//  Configures TLS session resumption for the HTTPS listener, so that clients that reconnect often need not do a full
+// handshake every time.
+//
+// Sessions are kept in the session cache of the OpenSSL context, which is shared by all worker threads. In addition,
+// clients can resume sessions using stateless session tickets. The tickets are encrypted with keys that are generated
+// at random and replaced regularly. Old keys are kept for the lifetime of a session, so that tickets issued shortly
+// before a key was replaced can still be used.
+class TlsSessions
+{
+public:
+	//  Loads the configuration from the JSON Object
+	//  jsonObject the object from the json file
+	auto loadConfig(utils::json::decoder::Object &jsonObject) -> void;
+
+	//  Configures the session cache and the session tickets of an OpenSSL context. This is called by libhttp once the
+	// context was created.
+	auto configure(SSL_CTX *context) -> void;
+
+	//  Writes the resumption counters in the Prometheus text format
+	//  text the string to append the counters to
+	auto formatMetrics(std::string &text) const -> void;
+
+private:
+	//  A key for encrypting session tickets
+	struct TicketKey
+	{
+		//  Destructor. This erases the key material.
+		~TicketKey();
+
+		//  The name of the key, which is stored in the ticket to find the key again
+		std::array<unsigned char, 16> _name;
+
+		//  The key for encrypting the ticket
+		std::array<unsigned char, 32> _encryptionKey;
+
+		//  The key for the HMAC of the ticket
+		std::array<unsigned char, 32> _hmacKey;
+
+		//  The time the key was replaced by a newer key, or the maximum time if it is the current key
+		std::chrono::steady_clock::time_point _retireTime { std::chrono::steady_clock::time_point::max() };
+	};
+
+	//  The ticket keys in use
+	struct TicketKeys
+	{
+		//  The keys, starting with the current key. Older keys are only used for decrypting tickets.
+		std::vector<std::shared_ptr<TicketKey>> _keys;
+
+		//  The time the current key must be replaced
+		std::chrono::steady_clock::time_point _rotationTime;
+	};
+
+	//  Gets the ticket keys, replacing the current key first if it is due
+	auto ticketKeys() -> std::shared_ptr<const TicketKeys>;
+
+	//  Handles a session ticket for OpenSSL
+	//  @return the result for OpenSSL: 1 if the ticket was handled, 2 if the ticket is valid but should be renewed,
+	// 0 if the ticket key is unknown, and -1 on error
+	auto handleTicket(unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipherContext,
+		EVP_MAC_CTX *macContext, bool encrypt) -> int;
+
+	//  The callback for session tickets that is registered with OpenSSL
+	static auto staticTicketKeyCallback(SSL *connection, unsigned char *keyName, unsigned char *iv,
+		EVP_CIPHER_CTX *cipherContext, EVP_MAC_CTX *macContext, int encrypt) -> int;
+
+	//  Gets the index of the OpenSSL context data that points to this object
+	static auto dataIndex() -> int;
+
+	//  The maximum number of sessions in the session cache, or 0 to disable the cache
+	std::size_t _cacheSize { 20480 };
+
+	//  How long a session can be resumed
+	std::chrono::seconds _lifetime { 3600 };
+
+	//  Whether session tickets are used
+	bool _tickets { true };
+
+	//  How often the ticket key is replaced
+	std::chrono::seconds _ticketKeyRotation { 3600 };
+
+	//  The OpenSSL context, once it was configured
+	SSL_CTX *_context { nullptr };
+
+	//  The current ticket keys
+	std::atomic<std::shared_ptr<const TicketKeys>> _ticketKeys;
+
+	//  Makes sure only one thread replaces the ticket key
+	std::mutex _rotationMutex;
+
+	//  The number of session tickets issued
+	std::atomic<std::uint64_t> _ticketsIssued { 0 };
+
+	//  The number of sessions resumed using a ticket
+	std::atomic<std::uint64_t> _ticketResumptions { 0 };
+
+	//  The number of tickets that were rejected because their key was no longer known
+	std::atomic<std::uint64_t> _unknownTicketKeys { 0 };
+};
+
+} // namespace xentara::samples::webService
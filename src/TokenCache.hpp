@@ -0,0 +1,151 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace xentara::samples::webService
+{
+
+//  A bounded cache for bearer tokens. The entries are keyed by a hash of the raw token, and are spread over several
+// shards with their own lock, so that worker threads looking up different tokens do not contend with each other.
+// Every entry has an expiry time, given in seconds since the Unix epoch, after which it is no longer returned.
+template <class Value>
+class TokenCache
+{
+public:
+	//  Constructor
+	//  capacity the maximum number of entries in the whole cache
+	explicit TokenCache(std::size_t capacity) : _shardCapacity((capacity + kShardCount - 1) / kShardCount)
+	{
+	}
+
+	//  Looks up a token
+	//  token the raw encoded token
+	//  now the current time in seconds since the Unix epoch
+	//  @return the cached value, or std::nullopt if the token is not in the cache or its entry has expired
+	auto find(std::string_view token, std::int64_t now) -> std::optional<Value>
+	{
+		const auto hash = std::hash<std::string_view> {}(token);
+		auto &shard = shardFor(hash);
+
+		std::scoped_lock lock(shard._mutex);
+
+		// Find the entry
+		const auto entry = shard._entries.find(hash);
+		if (entry == shard._entries.end())
+		{
+			return std::nullopt;
+		}
+
+		// Remove the entry if it expired
+		if (now > entry->second._expiry)
+		{
+			shard._entries.erase(entry);
+			return std::nullopt;
+		}
+
+		// The hash is only used as a key, so we must make sure that it really is the same token
+		if (entry->second._token != token)
+		{
+			return std::nullopt;
+		}
+
+		return entry->second._value;
+	}
+
+	//  Adds a token to the cache, replacing any entry that has the same hash
+	//  token the raw encoded token
+	//  value the value to store for the token
+	//  expiry the time after which the entry is no longer valid, in seconds since the Unix epoch
+	//  now the current time in seconds since the Unix epoch
+	auto insert(std::string_view token, Value value, std::int64_t expiry, std::int64_t now) -> void
+	{
+		const auto hash = std::hash<std::string_view> {}(token);
+		auto &shard = shardFor(hash);
+
+		std::scoped_lock lock(shard._mutex);
+
+		// Make room if the shard is full
+		if (shard._entries.size() >= _shardCapacity && !shard._entries.contains(hash))
+		{
+			evict(shard, now);
+		}
+
+		shard._entries.insert_or_assign(hash, Entry { std::string(token), expiry, std::move(value) });
+	}
+
+	//  Removes all entries
+	auto clear() -> void
+	{
+		for (auto &&shard : _shards)
+		{
+			std::scoped_lock lock(shard._mutex);
+			shard._entries.clear();
+		}
+	}
+
+private:
+	//  A single cache entry
+	struct Entry
+	{
+		//  The raw token, used to detect hash collisions
+		std::string _token;
+
+		//  The expiry time in seconds since the Unix epoch
+		std::int64_t _expiry;
+
+		//  The cached value
+		Value _value;
+	};
+
+	//  A shard of the cache with its own lock
+	struct Shard
+	{
+		//  The lock protecting the entries
+		std::mutex _mutex;
+
+		//  The entries, keyed by the hash of the token
+		std::unordered_map<std::size_t, Entry> _entries;
+	};
+
+	//  Gets the shard for a hash
+	auto shardFor(std::size_t hash) -> Shard &
+	{
+		// Use the upper bits, because the lower bits are used by the unordered map
+		return _shards[(hash >> (sizeof(std::size_t) * 8 - kShardBits)) % kShardCount];
+	}
+
+	//  Removes expired entries from a full shard, or an arbitrary entry if none have expired.
+	//  The shard must already be locked
+	auto evict(Shard &shard, std::int64_t now) -> void
+	{
+		std::erase_if(shard._entries, [now](const auto &entry) { return now > entry.second._expiry; });
+
+		if (shard._entries.size() >= _shardCapacity && !shard._entries.empty())
+		{
+			shard._entries.erase(shard._entries.begin());
+		}
+	}
+
+	//  The number of bits used to select the shard
+	static constexpr std::size_t kShardBits = 4;
+
+	//  The number of shards
+	static constexpr std::size_t kShardCount = std::size_t(1) << kShardBits;
+
+	//  The maximum number of entries in each shard
+	std::size_t _shardCapacity;
+
+	//  The shards
+	std::array<Shard, kShardCount> _shards;
+};
+
+} // namespace xentara::samples::webService
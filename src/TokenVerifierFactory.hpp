@@ -1,11 +1,12 @@
 // Copyright (c) embedded ocean GmbH
 #pragma once
 
-#include "AbstractTokenVerification.hpp"
 #include "JwtCpp.hpp"
 
+#include <memory>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <unordered_map>
 
 #ifdef _MSC_VER
@@ -31,6 +32,27 @@
 namespace xentara::samples::webService
 {
 
+//  Verifies token signatures using a specific algorithm and key
+class SignatureVerifier
+{
+public:
+	//  virtual destructor
+	virtual ~SignatureVerifier() = 0;
+
+	//  Gets the name of the algorithm, as it appears in the "alg" field of the token header
+	virtual auto algorithm() const -> std::string_view = 0;
+
+	//  Verifies a signature
+	//  data the data that was signed
+	//  signature the decoded signature
+	//  errorCode receives the error if the signature is invalid
+	virtual auto verify(const std::string &data, const std::string &signature, std::error_code &errorCode) const
+		-> void = 0;
+};
+
+//   SignatureVerifier deconstructor
+inline SignatureVerifier::~SignatureVerifier() = default;
+
 //  Generates Verification verifies for signature algorithms
 class TokenVerifierFactory
 {
@@ -39,7 +61,7 @@ public:
 	virtual ~TokenVerifierFactory() = 0;
 
 	//  Pure virtual function for creating the verifier.
-	virtual auto create(const std::string &key) const -> JwtVerifier = 0;
+	virtual auto create(const std::string &key) const -> std::unique_ptr<SignatureVerifier> = 0;
 
 	//  This function creates the TokenVerifierFactrory
 	static auto factory(std::string_view algorithmName) -> const TokenVerifierFactory *;
@@ -55,15 +77,45 @@ inline TokenVerifierFactory ::~TokenVerifierFactory() = default;
 //  It is used to pass any type of verifiers as TokenVerifierFactory class
 namespace
 {
+	template <class Algorithm>
+	class ConcreteSignatureVerifier final : public SignatureVerifier
+	{
+	public:
+		//  Constructor
+		ConcreteSignatureVerifier(const std::string &key) : _algorithm(key), _name(_algorithm.name())
+		{
+		}
+
+		//  Implementation of the virtual algorithm function
+		auto algorithm() const -> std::string_view override
+		{
+			return _name;
+		}
+
+		//  Implementation of the virtual verify function
+		auto verify(const std::string &data, const std::string &signature, std::error_code &errorCode) const
+			-> void override
+		{
+			_algorithm.verify(data, signature, errorCode);
+		}
+
+	private:
+		//  The jwt-cpp algorithm, which holds the key
+		Algorithm _algorithm;
+
+		//  The name of the algorithm
+		std::string _name;
+	};
+
 	template <class Algorithm>
 	class ConcreteTokenVerifierFactory final : public TokenVerifierFactory
 	{
 	public:
 		//  Implementation of the virtual create function for creating verifiers
-		auto create(const std::string &key) const -> JwtVerifier override
+		auto create(const std::string &key) const -> std::unique_ptr<SignatureVerifier> override
 		{
-			//create verifier and add an algorithm available for checking.
-			return jwt::verify().allow_algorithm(Algorithm(key));
+			// create verifier for the algorithm
+			return std::make_unique<ConcreteSignatureVerifier<Algorithm>>(key);
 		}
 	};
 
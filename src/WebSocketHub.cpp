@@ -0,0 +1,443 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "WebSocketHub.hpp"
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+namespace
+{
+	//  The commands sent by clients
+	enum class Command : std::uint8_t
+	{
+		Subscribe = 0x01,
+		Unsubscribe = 0x02
+	};
+
+	//  The type of a message with all subscribed values
+	constexpr std::uint8_t kAllValues = 0x80;
+
+	//  The type of a message with the values that changed
+	constexpr std::uint8_t kChangedValues = 0x81;
+
+	//  The longest time the publisher waits for a snapshot before checking whether it should stop
+	constexpr std::chrono::seconds kPublisherTimeout { 1 };
+
+	//  Appends an unsigned integer in little endian byte order
+	template <class Value>
+	auto appendLittleEndian(std::string &message, Value value) -> void
+	{
+		for (std::size_t index = 0; index < sizeof(Value); ++index)
+		{
+			message.push_back(char(value & 0xff));
+			value >>= 8;
+		}
+	}
+} // namespace
+
+auto WebSocketHub::start(const lh_ctx_t *context) -> void
+{
+	_context = context;
+	for (auto &&sender : _senders)
+	{
+		sender = std::jthread([this](std::stop_token stopToken) { runSender(stopToken); });
+	}
+	_publisher = std::jthread([this](std::stop_token stopToken) { runPublisher(stopToken); });
+}
+
+auto WebSocketHub::stop() -> void
+{
+	if (_publisher.joinable())
+	{
+		_publisher.request_stop();
+		_publisher.join();
+	}
+	for (auto &&sender : _senders)
+	{
+		if (sender.joinable())
+		{
+			sender.request_stop();
+			sender.join();
+		}
+	}
+}
+
+auto WebSocketHub::connect(lh_con_t *connection) -> void
+{
+	auto client = std::make_shared<Client>();
+	client->_connection = connection;
+
+	std::scoped_lock lock(_mutex);
+	_clients.insert_or_assign(connection, std::move(client));
+	_connectedClients.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto WebSocketHub::disconnect(const lh_con_t *connection) -> void
+{
+	std::shared_ptr<Client> client;
+	{
+		std::scoped_lock lock(_mutex);
+
+		// Ignore connections that are not WebSocket clients
+		const auto found = _clients.find(connection);
+		if (found == _clients.end())
+		{
+			return;
+		}
+		client = std::move(found->second);
+		_clients.erase(found);
+		_connectedClients.fetch_sub(1, std::memory_order_relaxed);
+
+		// Remove the client from its subscription
+		changeSubscription(*client, {});
+
+		std::scoped_lock clientLock(client->_mutex);
+		client->_closed = true;
+		client->_messages.clear();
+	}
+
+	// Wait for any message that is being written, because the connection is destroyed once this returns
+	std::scoped_lock writeLock(client->_writeMutex);
+}
+
+auto WebSocketHub::receive(lh_con_t *connection, std::span<const char> message) -> bool
+{
+	// The message consists of a command and any number of IDs
+	if (message.empty() || (message.size() - 1) % sizeof(std::uint32_t) != 0)
+	{
+		return false;
+	}
+	const auto command = Command(message[0]);
+	if (command != Command::Subscribe && command != Command::Unsubscribe)
+	{
+		return false;
+	}
+
+	// Decode the IDs
+	std::vector<std::uint32_t> ids;
+	ids.reserve((message.size() - 1) / sizeof(std::uint32_t));
+	for (auto position = message.begin() + 1; position != message.end(); position += sizeof(std::uint32_t))
+	{
+		std::uint32_t id = 0;
+		for (std::size_t index = 0; index < sizeof(std::uint32_t); ++index)
+		{
+			id |= std::uint32_t(static_cast<unsigned char>(position[index])) << (index * 8);
+		}
+
+		// Unknown IDs are a protocol error
+		if (id >= _snapshot.size())
+		{
+			return false;
+		}
+		ids.push_back(id);
+	}
+	std::ranges::sort(ids);
+
+	std::scoped_lock lock(_mutex);
+	const auto found = _clients.find(connection);
+	if (found == _clients.end())
+	{
+		return false;
+	}
+	const auto &client = found->second;
+
+	// Combine the IDs with the current subscription
+	static const std::vector<std::uint32_t> kNoIds;
+	std::vector<std::uint32_t> subscribed;
+	const auto &current = client->_subscription ? client->_subscription->_ids : kNoIds;
+	if (command == Command::Subscribe)
+	{
+		std::ranges::set_union(current, ids, std::back_inserter(subscribed));
+	}
+	else
+	{
+		std::ranges::set_difference(current, ids, std::back_inserter(subscribed));
+	}
+	subscribed.erase(std::unique(subscribed.begin(), subscribed.end()), subscribed.end());
+
+	// Send the client all values of the new subscription
+	changeSubscription(*client, std::move(subscribed));
+	resync(client);
+	return true;
+}
+
+auto WebSocketHub::changeSubscription(Client &client, std::vector<std::uint32_t> ids) -> void
+{
+	// Leave the old subscription, and remove it if it has no more clients
+	if (auto old = std::exchange(client._subscription, nullptr))
+	{
+		std::erase(old->_clients, &client);
+		if (old->_clients.empty())
+		{
+			_subscriptions.erase(old->_ids);
+		}
+	}
+
+	if (ids.empty())
+	{
+		return;
+	}
+
+	// Join the subscription with the same IDs, or create one
+	auto &subscription = _subscriptions[ids];
+	if (!subscription)
+	{
+		subscription = std::make_unique<Subscription>();
+		subscription->_ids = std::move(ids);
+	}
+	subscription->_clients.push_back(&client);
+	client._subscription = subscription.get();
+}
+
+auto WebSocketHub::publish(const DataSnapshot::Snapshot &snapshot, std::uint64_t changedAfter) -> void
+{
+	std::scoped_lock lock(_mutex);
+	for (auto &&[ids, subscription] : _subscriptions)
+	{
+		// Encode the changes once for all clients of the subscription
+		const auto message = encode(kChangedValues, snapshot, ids, changedAfter);
+		if (!message)
+		{
+			continue;
+		}
+
+		for (auto client : subscription->_clients)
+		{
+			if (enqueue(*client, message))
+			{
+				schedule(_clients.at(client->_connection));
+			}
+		}
+	}
+}
+
+auto WebSocketHub::enqueue(Client &client, const Message &message) -> bool
+{
+	std::scoped_lock lock(client._mutex);
+	if (client._closed)
+	{
+		return false;
+	}
+
+	// If the client can't keep up, discard its messages and send it all values once it can take them
+	if (client._resync || client._messages.size() >= kMaxQueuedMessages)
+	{
+		if (!client._resync)
+		{
+			_overflows.fetch_add(1, std::memory_order_relaxed);
+		}
+		client._messages.clear();
+		client._resync = true;
+	}
+	else
+	{
+		client._messages.push_back(message);
+	}
+
+	return !std::exchange(client._scheduled, true);
+}
+
+auto WebSocketHub::resync(const std::shared_ptr<Client> &client) -> void
+{
+	{
+		std::scoped_lock lock(client->_mutex);
+		client->_messages.clear();
+		client->_resync = true;
+		if (std::exchange(client->_scheduled, true))
+		{
+			return;
+		}
+	}
+
+	schedule(client);
+}
+
+auto WebSocketHub::scheduleWaiting() -> void
+{
+	std::scoped_lock lock(_mutex);
+	for (auto &&[connection, client] : _clients)
+	{
+		std::scoped_lock clientLock(client->_mutex);
+		if (client->_resync && !client->_closed && !std::exchange(client->_scheduled, true))
+		{
+			schedule(client);
+		}
+	}
+}
+
+auto WebSocketHub::schedule(std::shared_ptr<Client> client) -> void
+{
+	{
+		std::scoped_lock lock(_readyMutex);
+		_readyClients.push_back(std::move(client));
+	}
+	_readyCondition.notify_one();
+}
+
+auto WebSocketHub::send(Client &client) -> void
+{
+	std::scoped_lock writeLock(client._writeMutex);
+	while (true)
+	{
+		// Get the next message
+		Message message;
+		bool resync = false;
+		{
+			std::scoped_lock lock(client._mutex);
+			if (client._closed || (!client._resync && client._messages.empty()))
+			{
+				client._scheduled = false;
+				return;
+			}
+			if (std::exchange(client._resync, false))
+			{
+				// The message with all values replaces any changes that were queued
+				client._messages.clear();
+				resync = true;
+			}
+			else
+			{
+				message = std::move(client._messages.front());
+				client._messages.pop_front();
+			}
+		}
+
+		// Encode all values of the subscription for this client only
+		if (resync)
+		{
+			auto snapshot = _snapshot.current();
+			if (!snapshot)
+			{
+				// There are no values yet, so keep the client waiting for all values until the first snapshot is
+				// published. The snapshot is checked again with the lock held, so that the publisher cannot miss the
+				// client between the check and the client being marked.
+				std::scoped_lock lock(client._mutex);
+				snapshot = _snapshot.current();
+				if (!snapshot)
+				{
+					client._resync = true;
+					client._scheduled = false;
+					return;
+				}
+			}
+
+			std::scoped_lock lock(_mutex);
+			if (!client._subscription)
+			{
+				continue;
+			}
+			message = encode(kAllValues, *snapshot, client._subscription->_ids, 0);
+		}
+
+		// Write the message
+		if (httplib_websocket_write(
+				_context, client._connection, WEBSOCKET_OPCODE_BINARY, message->data(), message->size()) <= 0)
+		{
+			std::scoped_lock lock(client._mutex);
+			client._closed = true;
+			client._scheduled = false;
+			client._messages.clear();
+			return;
+		}
+		_sentMessages.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+auto WebSocketHub::encode(std::uint8_t type,
+	const DataSnapshot::Snapshot &snapshot,
+	std::span<const std::uint32_t> ids,
+	std::uint64_t changedAfter) -> Message
+{
+	std::shared_ptr<std::string> message;
+	for (auto id : ids)
+	{
+		if (snapshot._changes[id] <= changedAfter)
+		{
+			continue;
+		}
+
+		// Start the message before the first value
+		if (!message)
+		{
+			message = std::make_shared<std::string>();
+			message->push_back(char(type));
+			appendLittleEndian(*message, snapshot._cycle);
+		}
+
+		const auto &fragment = snapshot._fragments[id];
+		appendLittleEndian(*message, id);
+		appendLittleEndian(*message, std::uint32_t(fragment.size()));
+		message->append(fragment);
+	}
+
+	return message;
+}
+
+auto WebSocketHub::runPublisher(std::stop_token stopToken) -> void
+{
+	std::uint64_t lastCycle = 0;
+	while (!stopToken.stop_requested())
+	{
+		const auto snapshot =
+			_snapshot.waitForSnapshot(lastCycle, std::chrono::steady_clock::now() + kPublisherTimeout);
+		if (!snapshot)
+		{
+			if (_snapshot.stopped())
+			{
+				return;
+			}
+			continue;
+		}
+
+		// Clients get all values when they subscribe, so there is nothing to publish for the first snapshot. Clients
+		// that subscribed before it are still waiting for their values, though.
+		if (lastCycle != 0)
+		{
+			publish(*snapshot, lastCycle);
+		}
+		else
+		{
+			scheduleWaiting();
+		}
+		lastCycle = snapshot->_cycle;
+	}
+}
+
+auto WebSocketHub::runSender(std::stop_token stopToken) -> void
+{
+	while (true)
+	{
+		// Wait for a client with waiting messages
+		std::shared_ptr<Client> client;
+		{
+			std::unique_lock lock(_readyMutex);
+			if (!_readyCondition.wait(lock, stopToken, [&] { return !_readyClients.empty(); }))
+			{
+				return;
+			}
+			client = std::move(_readyClients.front());
+			_readyClients.pop_front();
+		}
+
+		send(*client);
+	}
+}
+
+auto WebSocketHub::formatMetrics(std::string &text) const -> void
+{
+	Metrics::formatGauge(text, "websocket_clients"sv, "Number of connected WebSocket clients."sv,
+		_connectedClients.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "websocket_messages_total"sv, "Number of messages sent to WebSocket clients."sv,
+		_sentMessages.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "websocket_overflows_total"sv,
+		"Number of times a WebSocket client could not keep up and had its queued messages replaced by all values."sv,
+		_overflows.load(std::memory_order_relaxed));
+}
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,214 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "DataSnapshot.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <libhttp.h>
+
+namespace xentara::samples::webService
+{
+
+//  Sends the changes of attributes to WebSocket clients using a compact binary protocol.
+//
+// All numbers are little endian. Clients send binary messages consisting of a one byte command followed by any number
+// of 32 bit attribute IDs, which are the indices listed by GET /data:
+//
+// - 0x01 subscribes to the attributes
+// - 0x02 unsubscribes from the attributes
+//
+// The server sends binary messages consisting of a one byte type, the 64 bit number of the cycle, and a record for each
+// value. Each record consists of the 32 bit attribute ID, the 32 bit size of the value, and the value as JSON text:
+//
+// - 0x80 contains all subscribed values. This is sent after each change of the subscription, and if the client could
+//   not keep up with the changes.
+// - 0x81 contains the subscribed values that changed since the previous message.
+//
+// Clients with the same set of attributes share a subscription. The changes for a subscription are encoded once per
+// cycle by a single thread, and the same message is queued for all of its clients. The messages are written by a small
+// pool of sender threads, so that a client that is slow to receive only holds up one sender thread. If a client has
+// too many messages queued, its queue is discarded, and the client gets all values again once it catches up, so that
+// slow clients do not use more and more memory.
+class WebSocketHub
+{
+public:
+	//  Constructor
+	//  snapshot the snapshots the values are taken from
+	WebSocketHub(DataSnapshot &snapshot) : _snapshot(snapshot)
+	{
+	}
+
+	//  Destructor. This stops the threads.
+	~WebSocketHub()
+	{
+		stop();
+	}
+
+	//  Starts the threads
+	//  context the libhttp context used to write the messages
+	auto start(const lh_ctx_t *context) -> void;
+
+	//  Stops the threads. Clients stay connected, but no more messages are sent.
+	auto stop() -> void;
+
+	//  Adds a client whose WebSocket handshake is complete
+	auto connect(lh_con_t *connection) -> void;
+
+	//  Removes a client whose connection is being closed. This waits for a message that is being written to the client.
+	// Connections that are not WebSocket clients are ignored.
+	auto disconnect(const lh_con_t *connection) -> void;
+
+	//  Handles a message from a client
+	//  @return true if the message was valid, or false if the connection must be closed
+	auto receive(lh_con_t *connection, std::span<const char> message) -> bool;
+
+	//  Writes the metrics about the clients in the Prometheus text format
+	//  text the string to append the metrics to
+	auto formatMetrics(std::string &text) const -> void;
+
+	//  The number of messages that can be queued for a client before the client must get all values again
+	static constexpr std::size_t kMaxQueuedMessages = 64;
+
+	//  The number of threads that write the messages to the clients
+	static constexpr std::size_t kSenderThreads = 2;
+
+private:
+	//  A message that is shared by all clients of a subscription
+	using Message = std::shared_ptr<const std::string>;
+
+	struct Client;
+
+	//  A set of attributes, with the clients that subscribed to exactly this set
+	struct Subscription
+	{
+		//  The sorted IDs of the attributes
+		std::vector<std::uint32_t> _ids;
+
+		//  The clients
+		std::vector<Client *> _clients;
+	};
+
+	//  A connected client
+	struct Client
+	{
+		//  The connection
+		lh_con_t *_connection;
+
+		//  The subscription of the client, or nullptr if the client has no subscription or is disconnected. This is
+		// protected by the mutex of the hub.
+		Subscription *_subscription { nullptr };
+
+		//  Protects the members below
+		std::mutex _mutex;
+
+		//  The messages waiting to be written. This never holds more than kMaxQueuedMessages messages.
+		std::deque<Message> _messages;
+
+		//  Whether the client must get all values
+		bool _resync { false };
+
+		//  Whether the client is in the queue of clients to write to, or being written to
+		bool _scheduled { false };
+
+		//  Whether the client was disconnected, or writing to it failed
+		bool _closed { false };
+
+		//  Held while writing to the client, so that the connection can't be closed at the same time
+		std::mutex _writeMutex;
+	};
+
+	//  Encodes and queues the changes for all subscriptions
+	//  changedAfter the number of the cycle after which the values must have changed
+	auto publish(const DataSnapshot::Snapshot &snapshot, std::uint64_t changedAfter) -> void;
+
+	//  Queues a message for a client, or marks the client for all values if its queue is full
+	//  @return whether the client needs to be scheduled
+	auto enqueue(Client &client, const Message &message) -> bool;
+
+	//  Marks a client as needing all values, and schedules it
+	auto resync(const std::shared_ptr<Client> &client) -> void;
+
+	//  Schedules the clients that are waiting for all values because they subscribed before the first snapshot
+	auto scheduleWaiting() -> void;
+
+	//  Adds a client to the queue of clients to write to
+	auto schedule(std::shared_ptr<Client> client) -> void;
+
+	//  Writes all waiting messages to a client
+	auto send(Client &client) -> void;
+
+	//  Encodes a message with the values of a subscription
+	//  type the type of the message
+	//  changedAfter the number of the cycle after which the values must have changed, or 0 for all values
+	//  @return the message, or nullptr if none of the values had changed
+	static auto encode(std::uint8_t type,
+		const DataSnapshot::Snapshot &snapshot,
+		std::span<const std::uint32_t> ids,
+		std::uint64_t changedAfter) -> Message;
+
+	//  Changes the subscription of a client. This must be called with the mutex locked.
+	auto changeSubscription(Client &client, std::vector<std::uint32_t> ids) -> void;
+
+	//  Waits for new snapshots and publishes their changes
+	auto runPublisher(std::stop_token stopToken) -> void;
+
+	//  Writes messages to clients that have messages waiting
+	auto runSender(std::stop_token stopToken) -> void;
+
+	//  The snapshots
+	DataSnapshot &_snapshot;
+
+	//  The libhttp context
+	const lh_ctx_t *_context { nullptr };
+
+	//  Protects the clients and subscriptions
+	std::mutex _mutex;
+
+	//  The clients by their connection
+	std::unordered_map<const lh_con_t *, std::shared_ptr<Client>> _clients;
+
+	//  The subscriptions by their sorted IDs
+	std::map<std::vector<std::uint32_t>, std::unique_ptr<Subscription>> _subscriptions;
+
+	//  Protects the queue of clients to write to
+	std::mutex _readyMutex;
+
+	//  Signalled when a client was added to the queue
+	std::condition_variable_any _readyCondition;
+
+	//  The clients that have messages waiting
+	std::deque<std::shared_ptr<Client>> _readyClients;
+
+	//  The number of connected clients
+	std::atomic<std::uint64_t> _connectedClients { 0 };
+
+	//  The number of messages written
+	std::atomic<std::uint64_t> _sentMessages { 0 };
+
+	//  The number of times a client had to get all values because it could not keep up
+	std::atomic<std::uint64_t> _overflows { 0 };
+
+	//  The threads that write the messages
+	std::array<std::jthread, kSenderThreads> _senders;
+
+	//  The thread that publishes the changes. This must be the last member, so that it is stopped before anything it
+	// uses is destroyed.
+	std::jthread _publisher;
+};
+
+} // namespace xentara::samples::webService
@@ -0,0 +1,108 @@
+// Copyright (c) embedded ocean GmbH
+
+#include "WriteQueue.hpp"
+#include "Metrics.hpp"
+
+#include <memory>
+#include <utility>
+
+namespace xentara::samples::webService
+{
+using namespace std::literals;
+
+WriteQueue::~WriteQueue()
+{
+	for (auto batch = _head.exchange(nullptr); batch;)
+	{
+		std::unique_ptr<Batch> current(batch);
+		batch = current->_next;
+	}
+}
+
+auto WriteQueue::push(std::vector<Write> writes) -> bool
+{
+	const auto count = writes.size();
+	_requestedWrites.fetch_add(count, std::memory_order_relaxed);
+
+	// Reject the writes if the Xentara task does not keep up
+	if (_queuedWrites.fetch_add(count, std::memory_order_relaxed) + count > kMaxQueuedWrites)
+	{
+		_queuedWrites.fetch_sub(count, std::memory_order_relaxed);
+		_rejectedRequests.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Put the batch at the head of the list
+	auto batch = new Batch { ._writes = std::move(writes), ._next = _head.load(std::memory_order_relaxed) };
+	while (!_head.compare_exchange_weak(batch->_next, batch, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+
+	return true;
+}
+
+auto WriteQueue::apply(const DataSnapshot &snapshot) -> void
+{
+	// Take all batches at once. The list starts with the newest batch, so reverse it to get the order of the requests.
+	std::unique_ptr<Batch> batches;
+	for (auto batch = _head.exchange(nullptr, std::memory_order_acquire); batch;)
+	{
+		auto next = std::exchange(batch->_next, batches.release());
+		batches.reset(batch);
+		batch = next;
+	}
+	if (!batches)
+	{
+		return;
+	}
+
+	// Find the last write for each attribute
+	_lastWrites.resize(snapshot.size());
+	std::size_t count = 0;
+	for (auto batch = batches.get(); batch; batch = batch->_next)
+	{
+		for (auto &&write : batch->_writes)
+		{
+			if (!_lastWrites[write._index])
+			{
+				_writtenAttributes.push_back(write._index);
+			}
+			_lastWrites[write._index] = &write;
+		}
+		count += batch->_writes.size();
+	}
+
+	// Write each attribute once
+	for (auto index : _writtenAttributes)
+	{
+		const auto &handle = snapshot.writeHandle(index);
+		const auto error =
+			std::visit([&](const auto &value) { return handle.write(value); }, _lastWrites[index]->_value);
+		(error ? _failedWrites : _appliedWrites).fetch_add(1, std::memory_order_relaxed);
+		_lastWrites[index] = nullptr;
+	}
+	_writtenAttributes.clear();
+
+	// Free the batches. This is done iteratively, so that a long list does not use up the stack.
+	while (batches)
+	{
+		batches.reset(std::exchange(batches->_next, nullptr));
+	}
+	_queuedWrites.fetch_sub(count, std::memory_order_relaxed);
+}
+
+auto WriteQueue::formatMetrics(std::string &text) const -> void
+{
+	Metrics::formatCounter(text, "writes_requested_total"sv, "Number of attribute writes requested by clients."sv,
+		_requestedWrites.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "writes_applied_total"sv,
+		"Number of attribute writes applied to the data model, after combining writes to the same attribute."sv,
+		_appliedWrites.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "writes_failed_total"sv, "Number of attribute writes the data model rejected."sv,
+		_failedWrites.load(std::memory_order_relaxed));
+	Metrics::formatCounter(text, "write_requests_rejected_total"sv,
+		"Number of write requests rejected because too many writes were waiting."sv,
+		_rejectedRequests.load(std::memory_order_relaxed));
+}
+
+} // namespace xentara::samples::webService
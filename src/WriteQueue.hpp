@@ -0,0 +1,94 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "DataSnapshot.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace xentara::samples::webService
+{
+
+//  Collects the writes requested by clients, and applies them to the data model once per Xentara cycle.
+//
+// The worker threads push the writes of each request as a single batch onto a lock-free list, so that they never wait
+// for the Xentara task. The Xentara task takes all batches at once, and writes each attribute only once, using the
+// value of the last write, so that a burst of writes to the same attributes results in a single write per attribute
+// and cycle.
+class WriteQueue
+{
+public:
+	//  A value to write, already converted to the type of the attribute
+	using Value = std::variant<bool, std::int64_t, std::uint64_t, double, std::string>;
+
+	//  A single write
+	struct Write
+	{
+		//  The index of the attribute
+		std::size_t _index;
+
+		//  The value
+		Value _value;
+	};
+
+	//  Destructor. This discards any writes that were never applied.
+	~WriteQueue();
+
+	//  Queues the writes of a request. This never blocks.
+	//  @return true if the writes were queued, or false if too many writes are waiting already
+	auto push(std::vector<Write> writes) -> bool;
+
+	//  Applies all queued writes. This must only be called by the Xentara task.
+	//  snapshot the snapshot holding the write handles of the attributes
+	auto apply(const DataSnapshot &snapshot) -> void;
+
+	//  Writes the metrics about the writes in the Prometheus text format
+	//  text the string to append the metrics to
+	auto formatMetrics(std::string &text) const -> void;
+
+	//  The maximum number of writes waiting to be applied
+	static constexpr std::size_t kMaxQueuedWrites = 100'000;
+
+private:
+	//  The writes of a single request
+	struct Batch
+	{
+		//  The writes, in the order of the request
+		std::vector<Write> _writes;
+
+		//  The batch queued before this one
+		Batch *_next { nullptr };
+	};
+
+	//  The batch that was queued last, or nullptr if there are none
+	std::atomic<Batch *> _head { nullptr };
+
+	//  The number of writes waiting to be applied
+	std::atomic<std::size_t> _queuedWrites { 0 };
+
+	//  The last write for each attribute. This is only used while applying the writes, and is kept so that it does not
+	// need to be allocated each cycle.
+	std::vector<const Write *> _lastWrites;
+
+	//  The attributes that have a write, in the order of their first write
+	std::vector<std::size_t> _writtenAttributes;
+
+	//  The number of writes that were requested
+	std::atomic<std::uint64_t> _requestedWrites { 0 };
+
+	//  The number of writes that were applied to the data model
+	std::atomic<std::uint64_t> _appliedWrites { 0 };
+
+	//  The number of writes that failed
+	std::atomic<std::uint64_t> _failedWrites { 0 };
+
+	//  The number of requests that were rejected because too many writes were waiting
+	std::atomic<std::uint64_t> _rejectedRequests { 0 };
+};
+
+} // namespace xentara::samples::webService
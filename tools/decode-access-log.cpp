@@ -0,0 +1,103 @@
+// Copyright (c) embedded ocean GmbH
+
+// Converts a binary access log written by the web service into text. Each record is printed on a line with the fields
+// separated by tabs:
+//
+// timestamp  method  URI  status  authentication result  subject  response size  authentication time  handling time
+// write time
+//
+// The timestamp is printed in UTC in ISO 8601 format, and the times are in nanoseconds.
+
+#include "AccessLogRecord.hpp"
+#include "AuthenticationResult.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace xentara::samples::webService;
+
+namespace
+{
+	//  Prints a timestamp in nanoseconds since the Unix epoch
+	auto printTimestamp(std::ostream &stream, std::uint64_t timestamp) -> void
+	{
+		const auto seconds = std::time_t(timestamp / 1'000'000'000);
+		std::tm time {};
+#ifdef _WIN32
+		gmtime_s(&time, &seconds);
+#else
+		gmtime_r(&seconds, &time);
+#endif
+		char text[64];
+		const auto size = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &time);
+		char fraction[16];
+		std::snprintf(fraction, sizeof(fraction), ".%09lluZ", static_cast<unsigned long long>(timestamp % 1'000'000'000));
+		stream.write(text, std::streamsize(size)) << fraction;
+	}
+
+	//  Decodes a single file
+	//  @return false if the file could not be decoded
+	auto decode(const char *path) -> bool
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			std::cerr << path << ": could not open file\n";
+			return false;
+		}
+
+		// Check the header
+		AccessLogHeader header;
+		if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header._magic != AccessLogHeader::kMagic)
+		{
+			std::cerr << path << ": not an access log\n";
+			return false;
+		}
+		if (header._version != AccessLogHeader::kVersion || header._recordSize < sizeof(AccessLogRecord))
+		{
+			std::cerr << path << ": unsupported access log version " << header._version << "\n";
+			return false;
+		}
+
+		// Print the records. Later versions may add fields at the end of each record, which are skipped.
+		std::vector<char> buffer(header._recordSize);
+		while (file.read(buffer.data(), std::streamsize(buffer.size())))
+		{
+			AccessLogRecord record;
+			std::memcpy(&record, buffer.data(), sizeof(record));
+
+			printTimestamp(std::cout, record._timestamp);
+			std::cout << '\t' << recordField(record._method) << '\t' << recordField(record._uri) << '\t'
+					  << record._status << '\t'
+					  << authenticationResultName(AuthenticationResult(record._authenticationResult)) << '\t'
+					  << recordField(record._subject) << '\t' << record._responseSize << '\t'
+					  << record._authenticationTime << '\t' << record._handlingTime << '\t' << record._writeTime
+					  << '\n';
+		}
+
+		// A partial record at the end means the file was being written, which is not an error
+		return true;
+	}
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <access log file>...\n";
+		return 2;
+	}
+
+	bool success = true;
+	for (int i = 1; i < argc; ++i)
+	{
+		success = decode(argv[i]) && success;
+	}
+
+	return success ? 0 : 1;
+}